@@ -0,0 +1,219 @@
+#ifndef BATCH_H
+#define BATCH_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+/* =================== Lote =================== */
+/* Vários scripts (ou um script contra várias entradas) rodando num pool de
+   threads. Cada tarefa tem a sua Interp e o seu arquivo de saída; o erro fica
+   na própria tarefa e quem chamou reporta na ordem depois do pool_wait.
+   batch_run_sliced roda o mesmo lote numa thread só, em fatias (sched.h). */
+typedef struct {
+    const char* script;     // carregado pela tarefa se shared == NULL
+    const Program* shared;  // programa já pronto, só lido
+    const char* in_path;    // NULL: entrada vazia
+    const char* out_path;
+    ExecMode mode;
+    int cache;              // usa/grava o .smc do script
+    int64_t fuel;           // orçamento de voltas de loop; < 0: sem limite
+    int rc;                 // 0 ok, 1 erro do script, 2 arquivo não abriu
+    Error err;
+    const char* phase;
+    const char* bad_path;   // com rc == 2
+    int bad_errno;          // errno de quando bad_path falhou
+    // entre batch_job_start e batch_job_finish
+    Unit unit;
+    const Program* prog;
+    Interp* I;
+    int in_fd, out_fd;
+} BatchJob;
+
+/* carrega o script e abre os arquivos; 0 se já falhou (rc preenchido) */
+static int batch_job_start(BatchJob* J) {
+    J->rc = 0; J->phase = "runtime"; J->bad_path = NULL; J->bad_errno = 0;
+    J->I = NULL; J->in_fd = J->out_fd = -1;
+    clear_error(&J->err);
+    J->prog = J->shared;
+    if (!J->prog) {
+        if (!unit_load(&J->unit, J->script, J->mode, J->cache, &J->err, &J->phase)) {
+            J->rc = J->err.kind ? 1 : 2;
+            if (J->rc == 2) { J->bad_path = J->script; J->bad_errno = errno; }
+            return 0;
+        }
+        J->prog = &J->unit.prog;
+    }
+    J->in_fd = J->in_path ? open(J->in_path, O_RDONLY) : -1;
+    J->out_fd = open(J->out_path, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    if (J->in_path && J->in_fd < 0) { J->rc = 2; J->bad_path = J->in_path; return 0; }
+    if (J->out_fd < 0)              { J->rc = 2; J->bad_path = J->out_path; return 0; }
+    J->I = (Interp*)malloc(sizeof(Interp)); // Io tem 128K de buffers: fora da pilha da thread
+    interp_init(J->I, J->out_fd, J->in_fd, 0);
+    J->I->budget = J->fuel;
+    return 1;
+}
+
+static void batch_job_finish(BatchJob* J) {
+    if (J->I) {
+        if (J->I->err.kind) { J->err = J->I->err; J->rc = 1; }
+        interp_free(J->I);
+        free(J->I);
+        J->I = NULL;
+    }
+    if (J->in_fd >= 0) close(J->in_fd);
+    if (J->out_fd >= 0) close(J->out_fd);
+    if (!J->shared) unit_free(&J->unit);
+}
+
+static void batch_job_run(void* arg, int i) {
+    BatchJob* J = &((BatchJob*)arg)[i];
+    if (batch_job_start(J)) program_run(J->prog, J->I);
+    batch_job_finish(J);
+}
+
+static void batch_run(BatchJob* jobs, int n, int nthreads) {
+    Pool P;
+    pool_init(&P, nthreads < n ? nthreads : n);
+    pool_for(&P, n, batch_job_run, jobs);
+    pool_free(&P);
+}
+
+/* todas as tarefas numa thread, slice voltas de loop por vez */
+static void batch_run_sliced(BatchJob* jobs, int n, int64_t slice) {
+    Sched S;
+    sched_init(&S, slice);
+    for (int i=0;i<n;i++) if (batch_job_start(&jobs[i])) sched_add(&S, jobs[i].prog, jobs[i].I);
+    sched_run(&S);
+    for (int i=0;i<n;i++) batch_job_finish(&jobs[i]);
+    sched_free(&S);
+}
+
+/* =================== Compilação em lote =================== */
+/* sun --compile: lex, parse e compilação de muitos fontes no pool (pool_for),
+   sem rodar nenhum. O artefato é o .smc de cada um (cache.h); um .smc em dia
+   só é conferido. Cada tarefa tem o seu Unit (fonte, símbolos, árvore, erro)
+   e escreve o diagnóstico pronto, com o caminho, no próprio CompileJob: nada é
+   dividido entre threads e quem chamou imprime na ordem depois do pool. */
+typedef struct {
+    const char* path;
+    int rc;         // 0 ok, 1 erro no fonte, 2 fonte não abriu ou .smc não gravou
+    int fresh;      // o .smc já estava em dia
+    char* diag;     // com rc != 0
+} CompileJob;
+
+static char* compile_diag(const char* fmt, ...) {
+    char buf[1200];
+    va_list ap; va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n > (int)sizeof(buf) - 1) n = (int)sizeof(buf) - 1;
+    char* d = (char*)malloc((size_t)n + 1);
+    memcpy(d, buf, (size_t)n + 1);
+    return d;
+}
+
+static void compile_job_run(void* arg, int i) {
+    CompileJob* J = &((CompileJob*)arg)[i];
+    Unit U;
+    Error err;
+    const char* phase = "";
+    J->rc = 0; J->fresh = 0; J->diag = NULL;
+    if (!unit_load(&U, J->path, EXEC_BYTECODE, 1, &err, &phase)) {
+        J->rc = err.kind ? 1 : 2;
+        if (err.kind) J->diag = compile_diag("%s: [%s error] line %d, col %d: %s\n", J->path, phase, err.line, err.col, err.msg);
+        else J->diag = compile_diag("%s: cannot open '%s'%s\n", J->path, J->path, source_open_why(errno));
+    }
+    else if (U.smc.mem) J->fresh = 1;
+    else if (!U.saved) { J->rc = 2; J->diag = compile_diag("%s: cannot write the .smc\n", J->path); }
+    unit_free(&U);
+}
+
+static void compile_run(CompileJob* jobs, int n, int nthreads) {
+    Pool P;
+    pool_init(&P, nthreads < n ? nthreads : n);
+    pool_for(&P, n, compile_job_run, jobs);
+    pool_free(&P);
+}
+
+/* ---- caminhos ---- */
+/* Os fontes de um argumento de --compile: diretório (todo *.sm dentro, em
+   ordem de nome; links simbólicos ficam de fora), @lista (um caminho por linha,
+   linhas vazias e '#' ignoradas) ou o próprio arquivo. */
+typedef struct { char** v; int n, cap; } PathList;
+
+static void paths_add(PathList* L, const char* a, const char* b) {
+    if (L->n == L->cap) {
+        L->cap = L->cap ? L->cap*2 : 256;
+        L->v = (char**)realloc(L->v, sizeof(char*) * L->cap);
+    }
+    size_t la = strlen(a), lb = b ? strlen(b) : 0;
+    char* p = (char*)malloc(la + lb + 2);
+    memcpy(p, a, la);
+    if (b) { p[la] = '/'; memcpy(p + la + 1, b, lb + 1); }
+    else p[la] = 0;
+    L->v[L->n++] = p;
+}
+
+static void paths_free(PathList* L) {
+    for (int i=0;i<L->n;i++) free(L->v[i]);
+    free(L->v);
+    memset(L, 0, sizeof(*L));
+}
+
+static int paths_cmp(const void* a, const void* b) { return strcmp(*(char* const*)a, *(char* const*)b); }
+
+/* 0 se dir não abriu */
+static int paths_walk(PathList* L, const char* dir) {
+    DIR* d = opendir(dir);
+    if (!d) return 0;
+    PathList here = { NULL, 0, 0 };
+    struct dirent* e;
+    while ((e = readdir(d))) {
+        const char* nm = e->d_name;
+        if (nm[0] == '.' && (!nm[1] || (nm[1] == '.' && !nm[2]))) continue;
+        paths_add(&here, dir, nm);
+        struct stat st;
+        size_t n = strlen(nm);
+        int keep = lstat(here.v[here.n-1], &st) == 0 && (S_ISDIR(st.st_mode)
+                || (S_ISREG(st.st_mode) && n > 3 && memcmp(nm + n - 3, ".sm", 3)==0));
+        if (!keep) free(here.v[--here.n]);
+    }
+    closedir(d);
+    qsort(here.v, (size_t)here.n, sizeof(char*), paths_cmp);
+    for (int i=0;i<here.n;i++) {
+        struct stat st;
+        if (lstat(here.v[i], &st) == 0 && S_ISDIR(st.st_mode)) paths_walk(L, here.v[i]);
+        else paths_add(L, here.v[i], NULL);
+    }
+    paths_free(&here);
+    return 1;
+}
+
+/* 0 se o argumento (ou a lista) não abriu */
+static int paths_gather(PathList* L, const char* arg) {
+    struct stat st;
+    if (arg[0] != '@') {
+        if (stat(arg, &st) == 0 && S_ISDIR(st.st_mode)) return paths_walk(L, arg);
+        paths_add(L, arg, NULL); // não abrir fica para a tarefa reportar
+        return 1;
+    }
+    FILE* f = fopen(arg + 1, "r");
+    if (!f) return 0;
+    char line[4096];
+    while (fgets(line, sizeof(line), f)) {
+        size_t n = strlen(line);
+        while (n && ch_ws((unsigned char)line[n-1])) line[--n] = 0;
+        if (!n || line[0] == '#') continue;
+        if (stat(line, &st) == 0 && S_ISDIR(st.st_mode)) paths_walk(L, line);
+        else paths_add(L, line, NULL);
+    }
+    fclose(f);
+    return 1;
+}
+
+#endif
@@ -0,0 +1,374 @@
+/* Benchmarks do front-end e dos executores sobre cargas geradas.
+
+     cc -O2 -pthread bench.c -o sun-bench
+     ./sun-bench [--quick] [--out results.tsv] [--baseline old.tsv] [carga...]
+
+   Cada carga passa por lex (lex_all), parse (parse_program), prepare (dobra,
+   resolve e compila) e execução no walker (tree), no bytecode (vm) e com JIT
+   (jit). Por fase sai ns/op (uma passada inteira), itens/s (tokens no lex, nós
+   nos outros dois), alocações por passada e o pico de RSS do processo até ali.
+   --out grava o mesmo em TSV; --baseline lê um TSV anterior e mostra a variação
+   de ns/op ao lado. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/resource.h>
+
+/* conta as alocações dos headers: as macros valem para tudo incluído abaixo */
+static uint64_t g_allocs;
+static void* bench_malloc(size_t n)            { g_allocs++; return malloc(n); }
+static void* bench_calloc(size_t n, size_t m)  { g_allocs++; return calloc(n, m); }
+static void* bench_realloc(void* p, size_t n)  { g_allocs++; return realloc(p, n); }
+#define malloc(n)     bench_malloc(n)
+#define calloc(n, m)  bench_calloc(n, m)
+#define realloc(p, n) bench_realloc(p, n)
+
+#include "lexer.h"
+#include "io.h"
+#include "parser.h"
+#include "opt.h"
+#include "vec.h"
+#include "vm.h"
+#include "compiler.h"
+#include "jit.h"
+#include "cache.h"
+#include "prof.h"
+#include "exec.h"
+
+/* =================== Geração das cargas =================== */
+typedef struct { char* p; size_t len, cap; } Gen;
+
+static void gen(Gen* G, const char* fmt, ...) {
+    va_list ap;
+    for (;;) {
+        va_start(ap, fmt);
+        int n = vsnprintf(G->p + G->len, G->cap - G->len, fmt, ap);
+        va_end(ap);
+        if (G->len + (size_t)n < G->cap) { G->len += (size_t)n; return; }
+        G->cap = G->cap ? G->cap*2 : 1 << 16;
+        while (G->cap <= G->len + (size_t)n) G->cap *= 2;
+        G->p = (char*)realloc(G->p, G->cap);
+    }
+}
+
+/* expressões aninhadas: (x + (x - (x < ( ... 1)))) */
+static void gen_nest(Gen* G, int scale) {
+    static const char* ops[] = { "+", "-", "<", "+" };
+    gen(G, "x = 1; i = 0;\nloop (i < %d) {\n", 20 * scale);
+    for (int s=0; s<50; s++) {
+        gen(G, "    x = ");
+        for (int d=0; d<100; d++) gen(G, "(x %s ", ops[(d + s) & 3]);
+        gen(G, "1");
+        for (int d=0; d<100; d++) gen(G, ")");
+        gen(G, ";\n");
+    }
+    gen(G, "    i = i + 1;\n}\noutput(x);\n");
+}
+
+/* loops só de ints */
+static void gen_intloop(Gen* G, int scale) {
+    gen(G, "i = 0; s = 0;\n"
+           "loop (i < %d) {\n"
+           "    j = 0;\n"
+           "    loop (j < 1000) { s = s + j * 2 - i; j = j + 1; }\n"
+           "    i = i + 1;\n"
+           "}\n"
+           "output(s);\n", 100 * scale);
+}
+
+/* concatenação crescendo uma string */
+static void gen_concat(Gen* G, int scale) {
+    gen(G, "s = \"\"; t = \"\"; i = 0;\n"
+           "loop (i < %d) {\n"
+           "    s = s + \"ab\" + i;\n"
+           "    if (i / 10 * 10 == i) { t = t + s; t = \"\"; }\n"
+           "    i = i + 1;\n"
+           "}\n"
+           "output(\"done\");\n", 5000 * scale);
+}
+
+/* milhares de variáveis distintas */
+static void gen_manyvars(Gen* G, int scale) {
+    int n = 4000;
+    gen(G, "r = 0;\nloop (r < %d) {\n", scale);
+    for (int v=0; v<n; v++) gen(G, "    v%d = %d + r;\n", v, v);
+    for (int v=0; v<n; v+=8)
+        gen(G, "    t = v%d + v%d + v%d + v%d + v%d + v%d + v%d + v%d;\n", v, v+1, v+2, v+3, v+4, v+5, v+6, v+7);
+    gen(G, "    r = r + 1;\n}\noutput(t);\n");
+}
+
+/* fonte grande e plano: volume para o lexer e o parser */
+static void gen_huge(Gen* G, int scale) {
+    gen(G, "a = 1; b = 2; c = \"s\";\n");
+    for (int i=0; i<20000 * scale; i++) {
+        switch (i & 3) {
+            case 0: gen(G, "a%d = a * %d + b - %d;\n", i & 255, i, i & 15); break;
+            case 1: gen(G, "if (a > %d) { b = b + 1; } else { b = b - 1; }\n", i); break;
+            case 2: gen(G, "c%d = c + \"x%d\";\n", i & 63, i); break;
+            default: gen(G, "a = (a + %d) / 3;\n", i); break;
+        }
+    }
+    gen(G, "output(a, b);\n");
+}
+
+/* saída pesada (vai para /dev/null) */
+static void gen_print(Gen* G, int scale) {
+    gen(G, "i = 0;\nloop (i < %d) { output(i, \"x\", i * 2); i = i + 1; }\n", 20000 * scale);
+}
+
+/* roteamento: caminho -> código por um mapa de 64 rotas */
+static void gen_route(Gen* G, int scale) {
+    gen(G, "paths = {");
+    for (int r=0; r<64; r++) gen(G, "%s%d: \"/r%d\"", r ? ", " : "", r, r * 7);
+    gen(G, "};\nroute = {");
+    for (int r=0; r<64; r++) gen(G, "%s\"/r%d\": %d", r ? ", " : "", r * 7, r + 1);
+    gen(G, "};\ni = 0; t = 0;\n"
+           "loop (i < %d) { p = paths[i - i / 64 * 64]; t = t + get(route, p, 0); i = i + 1; }\n"
+           "output(t);\n", 20000 * scale);
+}
+
+/* chamadas curtas: o custo de entrar e sair de uma função, com e sem tail call */
+static void gen_calls(Gen* G, int scale) {
+    gen(G, "func inc(x) { return x + 1; }\n"
+           "func count(n, acc) { if (n == 0) { return acc; } return count(n - 1, acc + 1); }\n"
+           "i = 0; s = 0;\n"
+           "loop (i < %d) { s = inc(s); i = i + 1; }\n"
+           "output(s + count(%d, 0));\n", 20000 * scale, 20000 * scale);
+}
+
+typedef struct { const char* name; void (*fn)(Gen*, int); } Workload;
+
+static const Workload g_workloads[] = {
+    { "nest",     gen_nest },
+    { "intloop",  gen_intloop },
+    { "concat",   gen_concat },
+    { "manyvars", gen_manyvars },
+    { "huge",     gen_huge },
+    { "print",    gen_print },
+    { "route",    gen_route },
+    { "calls",    gen_calls },
+};
+
+/* =================== Medição =================== */
+typedef struct {
+    char workload[32], phase[16];
+    uint64_t iters;
+    double ns_op, items_s, allocs_op;
+    long rss_kb;
+} Result;
+
+typedef struct { Result* r; int n, cap; } Results;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static long peak_rss_kb(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+static double g_budget_ns = 3e8; // tempo mínimo por fase
+
+static void result_add(Results* R, const char* w, const char* phase, uint64_t iters, double ns, uint64_t items, uint64_t allocs) {
+    if (R->n >= R->cap) {
+        R->cap = R->cap ? R->cap*2 : 64;
+        R->r = (Result*)realloc(R->r, sizeof(Result) * R->cap);
+    }
+    Result* r = &R->r[R->n++];
+    snprintf(r->workload, sizeof(r->workload), "%s", w);
+    snprintf(r->phase, sizeof(r->phase), "%s", phase);
+    r->iters = iters;
+    r->ns_op = ns / (double)iters;
+    r->items_s = items ? (double)items * 1e9 / r->ns_op : 0;
+    r->allocs_op = (double)allocs / (double)iters;
+    r->rss_kb = peak_rss_kb();
+}
+
+/* lex + parse de S; program_prepare fica com quem chama */
+typedef struct { SymTab syms; Ast ast; Program prog; NodeId root; } BenchProg;
+
+static int bench_parse(BenchProg* B, Source* S) {
+    Error err; clear_error(&err);
+    symtab_init(&B->syms);
+    TokenVec toks = { NULL, 0, 0, NULL, &B->syms };
+    lex_all(S, &toks, &err);
+    ast_init(&B->ast, S, &B->syms);
+    Parser P = { toks.data, 0, toks.count, &B->ast, &err, 0, 0, 0 };
+    B->root = err.kind ? 0 : parse_program(&P);
+    tokvec_free(&toks);
+    if (!B->root || err.kind) { print_error_and_flush(&err, "bench"); return 0; }
+    chunk_init(&B->prog.chunk);
+    return 1;
+}
+
+static void bench_prog_free(BenchProg* B) {
+    program_free(&B->prog);
+    ast_free(&B->ast);
+    symtab_free(&B->syms);
+}
+
+static void bench_workload(Results* R, const Workload* W, int scale, int null_fd) {
+    Gen G = { NULL, 0, 0 };
+    W->fn(&G, scale);
+    Source S; source_from_string(&S, G.p);
+    double t0, t; uint64_t it, a0;
+
+    // lex
+    uint64_t ntoks = 0;
+    a0 = g_allocs; t0 = now_ns(); it = 0;
+    do {
+        SymTab syms; symtab_init(&syms);
+        TokenVec toks = { NULL, 0, 0, NULL, &syms };
+        Error err; clear_error(&err);
+        lex_all(&S, &toks, &err);
+        ntoks = (uint64_t)toks.count;
+        tokvec_free(&toks); symtab_free(&syms);
+        it++; t = now_ns() - t0;
+    } while (t < g_budget_ns);
+    result_add(R, W->name, "lex", it, t, ntoks, g_allocs - a0);
+
+    // parse (tokens prontos; o SymTab é o do lex)
+    SymTab syms; symtab_init(&syms);
+    TokenVec toks = { NULL, 0, 0, NULL, &syms };
+    Error err; clear_error(&err);
+    lex_all(&S, &toks, &err);
+    uint64_t nnodes = 0;
+    a0 = g_allocs; t0 = now_ns(); it = 0;
+    do {
+        Ast A; ast_init(&A, &S, &syms);
+        Parser P = { toks.data, 0, toks.count, &A, &err, 0, 0, 0 };
+        parse_program(&P);
+        nnodes = A.count;
+        ast_free(&A);
+        it++; t = now_ns() - t0;
+    } while (t < g_budget_ns);
+    result_add(R, W->name, "parse", it, t, nnodes, g_allocs - a0);
+    tokvec_free(&toks); symtab_free(&syms);
+
+    // prepare: cada passada precisa de uma árvore nova (a dobra reescreve)
+    double tp = 0; uint64_t ap = 0; it = 0;
+    do {
+        BenchProg B;
+        if (!bench_parse(&B, &S)) break;
+        a0 = g_allocs; t0 = now_ns();
+        program_prepare(&B.prog, &B.ast, B.root, EXEC_INTERP, NULL);
+        tp += now_ns() - t0; ap += g_allocs - a0;
+        bench_prog_free(&B);
+        it++;
+    } while (tp < g_budget_ns);
+    if (it) result_add(R, W->name, "prepare", it, tp, nnodes, ap);
+
+    // execução
+    static const struct { const char* phase; ExecMode mode; } engines[] = {
+        { "tree", EXEC_TREE }, { "vm", EXEC_INTERP }, { "jit", EXEC_BYTECODE },
+    };
+    for (size_t e=0; e<sizeof(engines)/sizeof(engines[0]); e++) {
+        BenchProg B;
+        if (!bench_parse(&B, &S)) break;
+        program_prepare(&B.prog, &B.ast, B.root, engines[e].mode, NULL);
+        Interp* I = (Interp*)malloc(sizeof(Interp));
+        a0 = g_allocs; t0 = now_ns(); it = 0;
+        do {
+            interp_init(I, null_fd, -1, 0);
+            program_run(&B.prog, I);
+            if (I->err.kind) { fprintf(stderr, "%s/%s: ", W->name, engines[e].phase); print_error_and_flush(&I->err, "runtime"); }
+            interp_free(I);
+            it++; t = now_ns() - t0;
+        } while (t < g_budget_ns && !I->err.kind);
+        result_add(R, W->name, engines[e].phase, it, t, 0, g_allocs - a0);
+        free(I);
+        bench_prog_free(&B);
+    }
+    source_close(&S);
+    free(G.p);
+}
+
+/* =================== Relatório =================== */
+/* ns/op do baseline para (carga, fase), ou 0 */
+static double baseline_ns(const Results* B, const Result* r) {
+    for (int i=0; i<B->n; i++)
+        if (!strcmp(B->r[i].workload, r->workload) && !strcmp(B->r[i].phase, r->phase)) return B->r[i].ns_op;
+    return 0;
+}
+
+static int results_read(Results* R, const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#') continue;
+        Result r; unsigned long long iters;
+        if (sscanf(line, "%31s %15s %llu %lf %lf %lf %ld", r.workload, r.phase, &iters,
+                   &r.ns_op, &r.items_s, &r.allocs_op, &r.rss_kb) != 7) continue;
+        r.iters = iters;
+        if (R->n >= R->cap) { R->cap = R->cap ? R->cap*2 : 64; R->r = (Result*)realloc(R->r, sizeof(Result) * R->cap); }
+        R->r[R->n++] = r;
+    }
+    fclose(f);
+    return 1;
+}
+
+static void results_write(const Results* R, FILE* f) {
+    fprintf(f, "# workload\tphase\titers\tns_op\titems_s\tallocs_op\tpeak_rss_kb\n");
+    for (int i=0; i<R->n; i++) {
+        const Result* r = &R->r[i];
+        fprintf(f, "%s\t%s\t%llu\t%.1f\t%.1f\t%.1f\t%ld\n", r->workload, r->phase,
+                (unsigned long long)r->iters, r->ns_op, r->items_s, r->allocs_op, r->rss_kb);
+    }
+}
+
+static void results_print(const Results* R, const Results* base) {
+    printf("%-9s %-8s %7s %14s %14s %12s %10s%s\n", "workload", "phase", "iters", "ns/op", "items/s",
+           "allocs/op", "rss_kb", base ? "   vs base" : "");
+    for (int i=0; i<R->n; i++) {
+        const Result* r = &R->r[i];
+        printf("%-9s %-8s %7llu %14.0f ", r->workload, r->phase, (unsigned long long)r->iters, r->ns_op);
+        if (r->items_s > 0) printf("%14.0f", r->items_s); else printf("%14s", "-");
+        printf(" %12.1f %10ld", r->allocs_op, r->rss_kb);
+        double b = base ? baseline_ns(base, r) : 0;
+        if (b > 0) printf("   %+7.1f%%", 100.0 * (r->ns_op - b) / b);
+        putchar('\n');
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* out = NULL;
+    const char* base_path = NULL;
+    const char** only = (const char**)malloc(sizeof(char*) * argc);
+    int nonly = 0, scale = 10;
+    for (int i=1;i<argc;i++) {
+        if (strcmp(argv[i], "--quick")==0) { scale = 1; g_budget_ns = 5e7; }
+        else if (strcmp(argv[i], "--out")==0 && i+1 < argc) out = argv[++i];
+        else if (strcmp(argv[i], "--baseline")==0 && i+1 < argc) base_path = argv[++i];
+        else if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: %s [--quick] [--out results.tsv] [--baseline old.tsv] [workload...]\n", argv[0]);
+            return 2;
+        }
+        else only[nonly++] = argv[i];
+    }
+    Results base = { NULL, 0, 0 };
+    if (base_path && !results_read(&base, base_path)) { fprintf(stderr, "cannot open '%s'\n", base_path); return 2; }
+    int null_fd = open("/dev/null", O_WRONLY);
+
+    Results R = { NULL, 0, 0 };
+    for (size_t w=0; w<sizeof(g_workloads)/sizeof(g_workloads[0]); w++) {
+        int want = !nonly;
+        for (int i=0;i<nonly;i++) if (!strcmp(only[i], g_workloads[w].name)) want = 1;
+        if (want) bench_workload(&R, &g_workloads[w], scale, null_fd);
+    }
+    results_print(&R, base_path ? &base : NULL);
+    if (out) {
+        FILE* f = fopen(out, "w");
+        if (!f) { fprintf(stderr, "cannot open '%s'\n", out); return 2; }
+        results_write(&R, f);
+        fclose(f);
+    }
+    close(null_fd);
+    free(R.r); free(base.r); free((void*)only);
+    return 0;
+}
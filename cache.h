@@ -0,0 +1,350 @@
+#ifndef CACHE_H
+#define CACHE_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* =================== Cache .smc =================== */
+/* Programa já compilado ao lado do fonte (x.sm -> x.smc). O arquivo é mapeado e
+   executado no lugar: code, pos, loops, trechos de comandos, funções, nomes das
+   variáveis, índice de linhas e os literais (gravados já como Str imortais) são
+   usados direto do mapa; só a tabela de constantes (Value guarda ponteiro) é
+   montada na carga.
+   Vale enquanto tamanho e hash do fonte baterem com o cabeçalho. O formato é
+   da máquina que o gravou (endianness, layout de Str): mudou o bytecode ou o
+   layout, sobe SMC_VERSION. */
+#define SMC_MAGIC   0x434E5553u  // "SUNC"
+#define SMC_VERSION 3
+
+typedef struct {
+    uint32_t magic, version;
+    uint32_t nops;       // BC_HALT+1
+    uint32_t abi;        // sizeof(Str) | sizeof(Value) << 8
+    uint64_t src_hash;
+    uint32_t src_len, file_len;
+    uint32_t ncode, nconsts, nloops, nstmts, max_stack, nsyms, nlines, names_len;
+    uint32_t nfuncs, nlsyms, max_locals, max_fstack;
+    uint32_t off_code, off_pos, off_loops, off_stmts, off_consts, off_symoff, off_names, off_lines;
+    uint32_t off_funcs, off_lsyms;
+} SmcHeader;
+
+typedef struct { uint32_t type, val; } SmcConst; // V_STRING: val é o offset do Str no arquivo
+
+/* um .smc carregado: o mapa e as constantes montadas sobre ele */
+typedef struct { void* mem; size_t len; Value* consts; } SmcMap;
+
+static uint32_t smc_abi(void) { return (uint32_t)sizeof(Str) | (uint32_t)sizeof(Value) << 8; }
+
+/* FNV-1a de 64 bits sobre o fonte */
+static uint64_t smc_hash(const Source* S) {
+    uint64_t h = 14695981039346656037ull;
+    for (uint32_t i=0;i<S->len;i++) { h ^= (unsigned char)S->data[i]; h *= 1099511628211ull; }
+    return h;
+}
+
+/* x.sm -> x.smc, outro nome -> nome.smc; 0 se não cabe */
+static int smc_path(char* out, size_t cap, const char* path) {
+    size_t n = strlen(path);
+    int sm = n >= 3 && memcmp(path + n - 3, ".sm", 3)==0;
+    return snprintf(out, cap, sm ? "%sc" : "%s.smc", path) < (int)cap;
+}
+
+/* ---- gravação ---- */
+typedef struct { char* p; uint32_t len, cap; } SmcBuf;
+
+/* reserva n bytes alinhados a 8 (zerados se p == NULL); devolve o offset */
+static uint32_t smc_put(SmcBuf* B, const void* p, uint32_t n) {
+    uint32_t off = (B->len + 7) & ~7u;
+    while (off + n > B->cap) {
+        B->cap = B->cap ? B->cap*2 : 4096;
+        B->p = (char*)realloc(B->p, B->cap);
+    }
+    memset(B->p + B->len, 0, off - B->len);
+    if (p) memcpy(B->p + off, p, n); else memset(B->p + off, 0, n);
+    B->len = off + n;
+    return off;
+}
+
+/* Grava o cache de C (e dos nomes em T) para o fonte S; 0 se não gravou. Quem
+   roda ignora a falha, o cache é só um atalho (sun --compile a reporta).
+   Arquivo temporário + rename, então leitores (ou outra thread do lote
+   gravando o mesmo) nunca veem um .smc pela metade. */
+static int smc_save(const char* path, const Source* S, const Chunk* C, const SymTab* T) {
+    if (!S->lines) return 0; // program_prepare já montou o índice
+    if (C->nsrcs) return 0;  // código de outro fonte (só na REPL)
+    SmcBuf B = { NULL, 0, 0 };
+    SmcHeader h;
+    memset(&h, 0, sizeof(h));
+    smc_put(&B, NULL, sizeof(h));
+    h.magic = SMC_MAGIC; h.version = SMC_VERSION; h.nops = BC_HALT+1; h.abi = smc_abi();
+    h.src_hash = smc_hash(S); h.src_len = S->len;
+    h.ncode = (uint32_t)C->count; h.nconsts = (uint32_t)C->nconsts; h.nloops = (uint32_t)C->nloops;
+    h.nstmts = (uint32_t)C->nstmts;
+    h.max_stack = (uint32_t)C->max_stack;
+    h.nsyms = T->count; h.names_len = T->names_len; h.nlines = S->nlines;
+    h.nfuncs = (uint32_t)C->nfuncs; h.nlsyms = (uint32_t)C->nlsyms;
+    h.max_locals = (uint32_t)C->max_locals; h.max_fstack = (uint32_t)C->max_fstack;
+    h.off_code  = smc_put(&B, C->code,  sizeof(int32_t)*C->count);
+    h.off_pos   = smc_put(&B, C->pos,   sizeof(uint32_t)*C->count);
+    h.off_loops = smc_put(&B, C->loops, sizeof(LoopInfo)*C->nloops);
+    h.off_stmts = smc_put(&B, C->stmts, sizeof(StmtInfo)*C->nstmts);
+    h.off_funcs = smc_put(&B, C->funcs, sizeof(FuncProto)*C->nfuncs);
+    h.off_lsyms = smc_put(&B, C->lsyms, sizeof(int32_t)*C->nlsyms);
+    h.off_symoff = smc_put(&B, T->off,  sizeof(uint32_t)*T->count);
+    h.off_names = smc_put(&B, T->names, T->names_len);
+    h.off_lines = smc_put(&B, S->lines, sizeof(uint32_t)*S->nlines);
+    h.off_consts = smc_put(&B, NULL, sizeof(SmcConst)*C->nconsts);
+    for (int i=0;i<C->nconsts;i++) {
+        SmcConst k = { (uint32_t)C->consts[i].type, 0 };
+        if (C->consts[i].type == V_STRING) {
+            const Str* s = C->consts[i].s;
+            k.val = smc_put(&B, NULL, (uint32_t)(sizeof(Str) + s->len + 1));
+            Str* d = (Str*)(B.p + k.val);
+            d->refs = -1; d->len = d->cap = s->len; d->hash = s->hash;
+            memcpy(d->data, s->data, s->len + 1);
+        } else k.val = (uint32_t)C->consts[i].i;
+        memcpy(B.p + h.off_consts + sizeof(SmcConst)*i, &k, sizeof(k));
+    }
+    h.file_len = B.len;
+    memcpy(B.p, &h, sizeof(h));
+
+    size_t n = strlen(path);
+    char* tmp = (char*)malloc(n + 8);
+    memcpy(tmp, path, n); memcpy(tmp + n, ".XXXXXX", 8);
+    int fd = mkstemp(tmp), ok = 0;
+    if (fd >= 0) {
+        ok = 1;
+        for (uint32_t w = 0; ok && w < B.len; ) {
+            ssize_t r = write(fd, B.p + w, B.len - w);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) ok = 0; else w += (uint32_t)r;
+        }
+        fchmod(fd, 0644);
+        close(fd);
+        if (!ok || rename(tmp, path) != 0) { unlink(tmp); ok = 0; }
+    }
+    free(tmp); free(B.p);
+    return ok;
+}
+
+/* ---- carga ---- */
+static int smc_fits(const SmcHeader* h, uint32_t off, uint64_t bytes) {
+    return (off & 7) == 0 && off <= h->file_len && bytes <= h->file_len - off;
+}
+
+/* Um trecho de código [start, end) (o programa ou uma função) vindo do arquivo:
+   percorre o que é alcançável a partir de start conferindo opcode, operandos,
+   alvos de salto e a altura da pilha (igual em toda junção, nunca negativa nem
+   acima de max_stack). nslots limita os slots (globais no programa, locais na
+   função). depth[] é -1 onde ainda não passou; map[] é o BC_MAP_NEW do mapa
+   literal mais alto ainda na pilha (-1: nenhum; o de baixo é map[] do próprio
+   BC_MAP_NEW): o BC_MAP_PUT exige um deles logo abaixo de chave e valor, a VM
+   não confere o tipo ali. */
+static int smc_verify_code(const SmcHeader* h, const int32_t* code, const LoopInfo* loops, const FuncProto* funcs, int32_t* depth, int32_t* map,
+                           int32_t start, int32_t end, int fn, int32_t nslots, int32_t max_stack) {
+    const int32_t nb = (int32_t)(sizeof(g_builtins)/sizeof(g_builtins[0]));
+    int32_t* work = (int32_t*)malloc(sizeof(int32_t) * (size_t)(end - start));
+    int nwork = 0, ok = 1;
+    depth[start] = 0; map[start] = -1; work[nwork++] = start;
+    while (ok && nwork) {
+        int32_t pc = work[--nwork], d = depth[pc], m = map[pc], op = code[pc], w, pop = 0, push = 0, jump = 0, next = 1, jumps = 0;
+        const int32_t* a = code + pc + 1;
+        switch (op) {
+            case BC_POP: case BC_NEG: case BC_POS: case BC_NOT: case BC_BOOL: case BC_NEWLINE:
+            case BC_ADD: case BC_SUB: case BC_MUL: case BC_DIV: case BC_INDEX: case BC_MAP_PUT:
+            case BC_EQ: case BC_NE: case BC_LT: case BC_LE: case BC_GT: case BC_GE:
+            case BC_RET: case BC_HALT: w = 1; break;
+            case BC_INCR: case BC_ADD_TO: case BC_CALL: case BC_CALL_MUT: w = 3; break;
+            case BC_JF_EQ_VK: case BC_JF_NE_VK: case BC_JF_LT_VK: case BC_JF_LE_VK: case BC_JF_GT_VK: case BC_JF_GE_VK:
+            case BC_CALL_F: case BC_TAIL_F: w = 4; break;
+            default: w = op >= 0 && op < BC_RET ? 2 : 0; break; // os _II só aparecem na cópia da VM
+        }
+        if (!w || w > end - pc) { ok = 0; break; }
+        switch (op) {
+            case BC_INT: push = 1; break;
+            case BC_CONST: ok = (uint32_t)a[0] < h->nconsts; push = 1; break;
+            case BC_LOAD: case BC_STORE: case BC_INPUT: case BC_CHECK_DEF: case BC_SET_INDEX: case BC_INCR:
+                ok = a[0] >= 0 && a[0] < nslots;
+                pop = op==BC_STORE ? 1 : op==BC_SET_INDEX ? 2 : 0; push = op==BC_LOAD;
+                break;
+            case BC_LOAD_G: ok = fn && (uint32_t)a[0] < h->nsyms; push = 1; break;
+            case BC_POP: pop = 1; break;
+            case BC_NEG: case BC_POS: case BC_NOT: case BC_BOOL: pop = push = 1; break;
+            case BC_ADD: case BC_SUB: case BC_MUL: case BC_DIV: case BC_INDEX:
+            case BC_EQ: case BC_NE: case BC_LT: case BC_LE: case BC_GT: case BC_GE: pop = 2; push = 1; break;
+            case BC_NEWLINE: break;
+            case BC_PRINT: pop = 1; break;
+            case BC_JUMP: jump = a[0]; jumps = 1; next = 0; break;
+            case BC_JUMP_IF_FALSE: case BC_JUMP_IF_TRUE: jump = a[0]; jumps = 1; pop = 1; break;
+            case BC_JF_EQ: case BC_JF_NE: case BC_JF_LT: case BC_JF_LE: case BC_JF_GT: case BC_JF_GE: jump = a[0]; jumps = 1; pop = 2; break;
+            case BC_JF_EQ_VK: case BC_JF_NE_VK: case BC_JF_LT_VK: case BC_JF_LE_VK: case BC_JF_GT_VK: case BC_JF_GE_VK:
+                ok = a[0] >= 0 && a[0] < nslots; jump = a[2]; jumps = 1; break;
+            case BC_LOOP_INIT: ok = (uint32_t)a[0] < h->nloops; break;
+            case BC_LOOP_CHECK: ok = (uint32_t)a[0] < h->nloops && loops[a[0]].top == pc && loops[a[0]].end < end; break;
+            case BC_ADD_TO: ok = a[0] >= 0 && a[0] < nslots && a[1] >= 1; pop = a[1]; break;
+            case BC_CALL: ok = a[0] >= 0 && a[0] < nb && !g_builtins[a[0]].mutates && a[1] == g_builtins[a[0]].nargs; pop = a[1]; push = 1; break;
+            case BC_CALL_MUT: ok = a[0] >= 0 && a[0] < nb && g_builtins[a[0]].mutates && g_builtins[a[0]].nargs == 2
+                                && a[1] >= 0 && a[1] < nslots; pop = push = 1; break;
+            case BC_MAP_NEW: ok = a[0] >= 0 && (uint32_t)a[0] <= h->ncode; push = 1; break;
+            case BC_MAP_PUT: {
+                int32_t q = m;
+                while (q >= 0 && depth[q] > d - 3) q = map[q]; // o valor pode ser um mapa literal
+                ok = q >= 0 && depth[q] == d - 3; pop = 2;
+                break;
+            }
+            case BC_CALL_F: case BC_TAIL_F:
+                ok = a[0] >= -1 && a[0] < (int32_t)h->nfuncs && (uint32_t)a[1] < h->nsyms && a[2] >= 0 && a[2] <= FUNC_MAX_ARGS;
+                pop = ok && a[0] >= 0 && a[2] == funcs[a[0]].nparams ? a[2] : 0; // nome ou aridade errados: args não compilados
+                push = 1;
+                if (op == BC_TAIL_F) { ok = ok && fn && a[0] >= 0 && d == pop; next = 0; }
+                break;
+            case BC_RET: ok = fn && d == 1; pop = 1; next = 0; break;
+            case BC_HALT: ok = !fn; next = 0; break;
+        }
+        if (!ok || pop > d || d - pop + push > max_stack) { ok = 0; break; }
+        d -= pop;
+        while (m >= 0 && depth[m] >= d) m = map[m]; // o mapa saiu da pilha
+        if (op == BC_MAP_NEW) m = pc;
+        d += push;
+        int32_t succ[2]; int ns = 0;
+        if (next) succ[ns++] = pc + w;
+        if (jumps) succ[ns++] = jump;
+        for (int i=0; ok && i<ns; i++) {
+            int32_t s = succ[i];
+            if (s < start || s >= end) ok = 0;
+            else if (depth[s] < 0) { depth[s] = d; map[s] = m; work[nwork++] = s; }
+            else ok = depth[s] == d && map[s] == m;
+        }
+    }
+    free(work);
+    return ok;
+}
+
+/* Confere tudo o que a VM, o JIT, o profiler e as mensagens de erro leem do
+   arquivo sem checar: um .smc corrompido (ou gravado por outro binário com o
+   mesmo formato) cai para a compilação em vez de ler fora dos arrays. */
+static int smc_verify(const SmcHeader* h, const char* base) {
+    const int32_t* code = (const int32_t*)(base + h->off_code);
+    const uint32_t* pos = (const uint32_t*)(base + h->off_pos);
+    const LoopInfo* loops = (const LoopInfo*)(base + h->off_loops);
+    const StmtInfo* stmts = (const StmtInfo*)(base + h->off_stmts);
+    const FuncProto* funcs = (const FuncProto*)(base + h->off_funcs);
+    const int32_t* lsyms = (const int32_t*)(base + h->off_lsyms);
+    const uint32_t* symoff = (const uint32_t*)(base + h->off_symoff);
+    const uint32_t* lines = (const uint32_t*)(base + h->off_lines);
+    const char* names = base + h->off_names;
+    if (h->ncode > INT32_MAX / 2 || h->nsyms > INT32_MAX || h->max_stack > h->ncode || h->max_fstack > h->ncode
+        || h->max_locals > h->nlsyms) return 0;
+
+    // nomes: todo offset dentro de names, e names termina em '\0'
+    if (h->nsyms && (h->names_len == 0 || names[h->names_len-1] != 0)) return 0;
+    for (uint32_t i=0;i<h->nsyms;i++) if (symoff[i] >= h->names_len) return 0;
+    for (uint32_t i=0;i<h->nlsyms;i++) if ((uint32_t)lsyms[i] >= h->nsyms) return 0;
+    // posições e índice de linhas dentro do fonte
+    for (uint32_t i=0;i<h->ncode;i++) if (pos[i] > h->src_len) return 0;
+    if (lines[0] != 0) return 0;
+    for (uint32_t i=1;i<h->nlines;i++) if (lines[i] < lines[i-1] || lines[i] > h->src_len) return 0;
+    for (uint32_t i=0;i<h->nstmts;i++)
+        if (stmts[i].top < 0 || stmts[i].top > stmts[i].end || (uint32_t)stmts[i].end > h->ncode || stmts[i].pos > h->src_len) return 0;
+    for (uint32_t i=0;i<h->nloops;i++)
+        if (loops[i].top < 0 || loops[i].top >= loops[i].end || (uint32_t)loops[i].end > h->ncode) return 0;
+    // funções: em ordem depois do programa, quadros dentro dos máximos
+    for (uint32_t f=0;f<h->nfuncs;f++) {
+        const FuncProto* fn = &funcs[f];
+        if (fn->entry <= (f ? funcs[f-1].entry : 0) || (uint32_t)fn->entry >= h->ncode
+            || fn->nparams < 0 || fn->nparams > FUNC_MAX_ARGS || fn->nlocals < fn->nparams
+            || (uint32_t)fn->nlocals > h->max_locals || fn->locals < 0 || (uint64_t)fn->locals + (uint32_t)fn->nlocals > h->nlsyms
+            || fn->max_stack < 0 || (uint32_t)fn->max_stack > h->max_fstack || (uint32_t)fn->sym >= h->nsyms) return 0;
+    }
+
+    int32_t* depth = (int32_t*)malloc(sizeof(int32_t) * h->ncode * 2), *map = depth + h->ncode;
+    for (uint32_t i=0;i<h->ncode;i++) depth[i] = -1;
+    int32_t end = h->nfuncs ? funcs[0].entry : (int32_t)h->ncode;
+    int ok = smc_verify_code(h, code, loops, funcs, depth, map, 0, end, 0, (int32_t)h->nsyms, (int32_t)h->max_stack);
+    for (uint32_t f=0; ok && f<h->nfuncs; f++) {
+        end = f+1 < h->nfuncs ? funcs[f+1].entry : (int32_t)h->ncode;
+        ok = smc_verify_code(h, code, loops, funcs, depth, map, funcs[f].entry, end, 1, funcs[f].nlocals, funcs[f].max_stack);
+    }
+    free(depth);
+    return ok;
+}
+
+/* Mapeia path e, se ele corresponde ao fonte S, preenche C, T e o índice de
+   linhas de S apontando para dentro do mapa. 0 se não existe, está velho ou
+   não passa em smc_verify. */
+static int smc_load(SmcMap* M, const char* path, Source* S, Chunk* C, SymTab* T) {
+    memset(M, 0, sizeof(*M));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(SmcHeader)) { close(fd); return 0; }
+    void* mem = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) return 0;
+    const char* base = (const char*)mem;
+    const SmcHeader* h = (const SmcHeader*)mem;
+    int ok = h->magic == SMC_MAGIC && h->version == SMC_VERSION && h->nops == BC_HALT+1
+          && h->abi == smc_abi() && h->file_len == (uint64_t)st.st_size && h->src_len == S->len
+          && h->ncode > 0 && h->nlines > 0
+          && smc_fits(h, h->off_code,   4ull*h->ncode)   && smc_fits(h, h->off_pos,   4ull*h->ncode)
+          && smc_fits(h, h->off_loops,  sizeof(LoopInfo)*(uint64_t)h->nloops)
+          && smc_fits(h, h->off_stmts,  sizeof(StmtInfo)*(uint64_t)h->nstmts)
+          && smc_fits(h, h->off_funcs,  sizeof(FuncProto)*(uint64_t)h->nfuncs)
+          && smc_fits(h, h->off_lsyms,  4ull*h->nlsyms)
+          && smc_fits(h, h->off_symoff, 4ull*h->nsyms)   && smc_fits(h, h->off_names, h->names_len)
+          && smc_fits(h, h->off_lines,  4ull*h->nlines)
+          && smc_fits(h, h->off_consts, sizeof(SmcConst)*(uint64_t)h->nconsts)
+          && h->src_hash == smc_hash(S) && smc_verify(h, base);
+    if (!ok) { munmap(mem, (size_t)st.st_size); return 0; }
+
+    M->mem = mem; M->len = (size_t)st.st_size;
+    M->consts = (Value*)malloc(sizeof(Value) * (h->nconsts + 1));
+    const SmcConst* k = (const SmcConst*)(base + h->off_consts);
+    for (uint32_t i=0;i<h->nconsts;i++) {
+        if (k[i].type == V_INT) { M->consts[i] = V_int((int32_t)k[i].val); continue; }
+        const Str* s = (const Str*)(base + k[i].val);
+        // literal tem de ser imortal (refs < 0): o mapa é só leitura
+        if (k[i].type != V_STRING || !smc_fits(h, k[i].val, sizeof(Str)) || s->refs >= 0 || s->len < 0
+            || !smc_fits(h, k[i].val, sizeof(Str) + (uint64_t)s->len + 1)) {
+            free(M->consts); munmap(mem, M->len);
+            memset(M, 0, sizeof(*M));
+            return 0;
+        }
+        M->consts[i] = V_sobj((Str*)s);
+    }
+
+    // o mapa é só leitura: os casts tiram o const, mas nada aqui é escrito
+    chunk_init(C);
+    C->code = (int32_t*)(base + h->off_code);  C->count = (int)h->ncode;
+    C->pos  = (uint32_t*)(base + h->off_pos);
+    C->loops = (LoopInfo*)(base + h->off_loops); C->nloops = (int)h->nloops;
+    C->stmts = (StmtInfo*)(base + h->off_stmts); C->nstmts = (int)h->nstmts;
+    C->funcs = (FuncProto*)(base + h->off_funcs); C->nfuncs = (int)h->nfuncs;
+    C->lsyms = (int32_t*)(base + h->off_lsyms); C->nlsyms = (int)h->nlsyms;
+    C->max_locals = (int)h->max_locals; C->max_fstack = (int)h->max_fstack;
+    C->consts = M->consts; C->nconsts = (int)h->nconsts;
+    C->max_stack = (int)h->max_stack;
+    C->src = S;
+    symtab_init(T);
+    T->names = (char*)(base + h->off_names); T->names_len = h->names_len;
+    T->off = (uint32_t*)(base + h->off_symoff); T->count = h->nsyms;
+    S->lines = (uint32_t*)(base + h->off_lines); S->nlines = h->nlines;
+    return 1;
+}
+
+/* desfaz smc_load; o índice de linhas de S apontava para o mapa */
+static void smc_unmap(SmcMap* M, Source* S) {
+    if (!M->mem) return;
+    S->lines = NULL; S->nlines = 0;
+    munmap(M->mem, M->len);
+    free(M->consts);
+    memset(M, 0, sizeof(*M));
+}
+
+#endif
@@ -0,0 +1,469 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/* =================== Bytecode =================== */
+/* Cada instrução é um opcode de 32 bits seguido dos seus operandos (também 32 bits).
+   Os saltos usam índices absolutos dentro de code[]. Mudou a codificação de
+   alguma instrução? Suba SMC_VERSION (cache.h) para descartar os .smc antigos. */
+typedef enum {
+    BC_INT,            // imm        -> empilha V_int(imm)
+    BC_CONST,          // k          -> empilha consts[k]
+    BC_LOAD,           // slot       -> empilha g_vars[slot]
+    BC_STORE,          // slot       -> desempilha para g_vars[slot]
+    BC_POP,
+    BC_NEG, BC_POS, BC_NOT, BC_BOOL,
+    BC_ADD, BC_SUB, BC_MUL, BC_DIV,
+    BC_EQ, BC_NE, BC_LT, BC_LE, BC_GT, BC_GE,
+    BC_JUMP,           // alvo
+    BC_JUMP_IF_FALSE,  // alvo (desempilha)
+    BC_JUMP_IF_TRUE,   // alvo (desempilha)
+    BC_PRINT,          // first      -> desempilha e imprime (com ' ' se !first)
+    BC_NEWLINE,
+    BC_INPUT,          // slot
+    BC_LOOP_INIT,      // g          -> entrada do loop g (não faz nada)
+    BC_LOOP_CHECK,     // g          -> gasta uma volta de combustível
+    /* superinstruções (mesma semântica da sequência que substituem) */
+    BC_JF_EQ, BC_JF_NE, BC_JF_LT, BC_JF_LE, BC_JF_GT, BC_JF_GE,             // alvo: desempilha b, a; salta se !(a op b)
+    BC_JF_EQ_VK, BC_JF_NE_VK, BC_JF_LT_VK, BC_JF_LE_VK, BC_JF_GT_VK, BC_JF_GE_VK, // slot imm alvo: salta se !(var op imm)
+    BC_INCR,           // slot imm   -> var = var + imm
+    BC_CHECK_DEF,      // slot       -> erro se a variável não está definida
+    BC_ADD_TO,         // slot k     -> desempilha k valores; var = var + x1 + ... + xk (string cresce no lugar)
+    BC_INDEX,          //            -> desempilha i, a; empilha a[i]
+    BC_SET_INDEX,      // slot       -> desempilha x, i; var[i] = x
+    BC_CALL,           // b n        -> desempilha n argumentos; empilha b(args) (Builtin)
+    BC_CALL_MUT,       // b slot     -> desempilha 1 argumento; b(var, arg) muda a variável no lugar
+    BC_MAP_NEW,        // n          -> empilha um mapa vazio com lugar para n chaves
+    BC_MAP_PUT,        //            -> desempilha x, k; m[k] = x no mapa que fica no topo
+    BC_LOAD_G,         // slot       -> empilha a variável global (dentro de função)
+    BC_CALL_F,         // f sym n    -> desempilha n argumentos; chama funcs[f] (f < 0: não existe)
+    BC_TAIL_F,         // f sym n    -> return funcs[f](args) no quadro atual
+    BC_RET,            //            -> desempilha o valor e volta a quem chamou
+    /* formas int/int: o compilador nunca emite; o vm_run reescreve o op genérico
+       na sua cópia do código quando vê dois ints (ver exec.h) */
+    BC_ADD_II, BC_SUB_II, BC_MUL_II, BC_DIV_II,
+    BC_EQ_II, BC_NE_II, BC_LT_II, BC_LE_II, BC_GT_II, BC_GE_II,
+    BC_HALT
+} BcOp;
+
+/* trecho de código de um loop: top = BC_LOOP_CHECK, end = primeira instrução depois do loop */
+typedef struct { int32_t top, end; } LoopInfo;
+
+/* trecho de um comando: [top, end), aninhados em ordem de top (o de fora antes);
+   kind é o NodeType. Só o profiler (prof.h) usa. */
+typedef struct { int32_t top, end; uint32_t pos; int32_t kind; } StmtInfo;
+
+/* Função compilada: o código dela vem depois do BC_HALT do programa. No quadro,
+   os slots são locais (parâmetros primeiro); lsyms[locals + i] é o símbolo do
+   slot i, para as mensagens de erro. */
+typedef struct { int32_t entry, nparams, nlocals, locals, max_stack, sym; } FuncProto;
+
+/* código a partir de top veio de outro fonte (funções de entradas anteriores da REPL) */
+typedef struct { int32_t top; Source* src; } ChunkSrc;
+
+typedef struct {
+    int32_t* code; int count, cap;
+    uint32_t* pos;                   // offset no fonte por palavra de código
+    Source* src;
+    Value* consts; int nconsts, cconsts;
+    LoopInfo* loops; int nloops, cloops;
+    StmtInfo* stmts; int nstmts, cstmts;
+    int max_stack;                   // do programa
+    FuncProto* funcs; int nfuncs;
+    int32_t* lsyms; int nlsyms;
+    int max_locals, max_fstack;      // maiores entre as funções
+    ChunkSrc* srcs; int nsrcs;
+} Chunk;
+
+static void chunk_init(Chunk* C) { memset(C, 0, sizeof(*C)); }
+
+static void chunk_free(Chunk* C) {
+    free(C->code); free(C->pos);
+    free(C->consts);
+    free(C->loops);
+    free(C->stmts);
+    free(C->funcs); free(C->lsyms);
+    free(C->srcs);
+    chunk_init(C);
+}
+
+/* fonte da palavra at (só nos caminhos de erro) */
+static Source* chunk_src(const Chunk* C, int32_t at) {
+    Source* S = C->src;
+    for (int i=0;i<C->nsrcs && C->srcs[i].top <= at;i++) S = C->srcs[i].src;
+    return S;
+}
+
+/* =================== Compilador =================== */
+typedef struct {
+    Chunk* C;
+    const Ast* A;
+    int depth;      // profundidade atual da pilha de operandos
+    int max_depth;  // do código sendo compilado (programa ou função)
+    uint32_t pos;   // posição do nó sendo compilado
+    const FuncTab* funcs;
+    int32_t* fidx;  // por símbolo: índice em C->funcs, ou -1
+} Compiler;
+
+static int emit_word(Compiler* K, int32_t w) {
+    Chunk* C = K->C;
+    if (C->count >= C->cap) {
+        C->cap = C->cap ? C->cap*2 : 256;
+        C->code = (int32_t*)realloc(C->code, sizeof(int32_t)*C->cap);
+        C->pos  = (uint32_t*)realloc(C->pos, sizeof(uint32_t)*C->cap);
+    }
+    C->code[C->count] = w;
+    C->pos[C->count]  = K->pos;
+    return C->count++;
+}
+
+static void stack_effect(Compiler* K, int delta) {
+    K->depth += delta;
+    if (K->depth > K->max_depth) K->max_depth = K->depth;
+}
+
+static void emit_op(Compiler* K, BcOp op, int delta) { emit_word(K, op); stack_effect(K, delta); }
+static void emit_op1(Compiler* K, BcOp op, int32_t a, int delta) { emit_word(K, op); emit_word(K, a); stack_effect(K, delta); }
+
+/* emite um salto com alvo a preencher; devolve a posição do operando */
+static int emit_jump(Compiler* K, BcOp op, int delta) {
+    emit_word(K, op);
+    int at = emit_word(K, -1);
+    stack_effect(K, delta);
+    return at;
+}
+static void patch_jump(Compiler* K, int at) { K->C->code[at] = K->C->count; }
+
+static int add_const(Compiler* K, Value v) {
+    Chunk* C = K->C;
+    for (int i=0;i<C->nconsts;i++)
+        if (C->consts[i].type==v.type && C->consts[i].s==v.s) return i; // literais internados
+    if (C->nconsts >= C->cconsts) {
+        C->cconsts = C->cconsts ? C->cconsts*2 : 16;
+        C->consts = (Value*)realloc(C->consts, sizeof(Value)*C->cconsts);
+    }
+    C->consts[C->nconsts] = v;
+    return C->nconsts++;
+}
+
+static void compile_expr(Compiler* K, NodeId id);
+static void compile_stmts(Compiler* K, NodeId id);
+
+/* f(args), ou em tail BC_TAIL_F; 1 se emitiu o BC_TAIL_F. Com nome ou aridade
+   errados os argumentos não são avaliados (como no walker): o BC_CALL_F
+   reporta o erro na chamada. */
+static int compile_fcall(Compiler* K, const Node* n, int tail) {
+    int32_t f = func_lookup(K->funcs, n->lit) ? K->fidx[n->lit] : -1;
+    int ok = f >= 0 && K->C->funcs[f].nparams == n->op, nargs = 0;
+    if (ok) for (NodeId a = n->extra; a; a = K->A->nodes[a].next, nargs++) compile_expr(K, a);
+    K->pos = n->pos;
+    tail = tail && ok;
+    emit_word(K, tail ? BC_TAIL_F : BC_CALL_F);
+    emit_word(K, f);
+    emit_word(K, (int32_t)n->lit);
+    emit_word(K, n->op);
+    stack_effect(K, 1 - nargs);
+    return tail;
+}
+
+static void compile_expr(Compiler* K, NodeId id) {
+    const Node* n = &K->A->nodes[id];
+    K->pos = n->pos;
+    switch ((NodeType)n->type) {
+        case N_INT:    emit_op1(K, BC_INT, n->ival, +1); return;
+        case N_STRING: emit_op1(K, BC_CONST, add_const(K, V_sobj(K->A->strs[n->slot])), +1); return;
+        case N_VAR:    emit_op1(K, BC_LOAD, n->slot, +1); return;
+        case N_GLOBAL: emit_op1(K, BC_LOAD_G, n->slot, +1); return;
+        case N_FCALL:  compile_fcall(K, n, 0); return;
+        case N_UNARY:
+            compile_expr(K, n->left);
+            K->pos = n->pos;
+            switch ((OpType)n->op) {
+                case OP_NOT:   emit_op(K, BC_NOT, 0); break;
+                case OP_MINUS: emit_op(K, BC_NEG, 0); break;
+                case OP_PLUS:  emit_op(K, BC_POS, 0); break;
+                default: break;
+            }
+            return;
+        case N_BINARY: {
+            // curto-circuito: resultado normalizado para 0/1 como no eval
+            if (n->op==OP_AND || n->op==OP_OR) {
+                compile_expr(K, n->left);
+                K->pos = n->pos;
+                int short_j = emit_jump(K, n->op==OP_AND ? BC_JUMP_IF_FALSE : BC_JUMP_IF_TRUE, -1);
+                compile_expr(K, n->right);
+                K->pos = n->pos;
+                emit_op(K, BC_BOOL, 0);
+                int end_j = emit_jump(K, BC_JUMP, -1);
+                patch_jump(K, short_j);
+                emit_op1(K, BC_INT, n->op==OP_OR, +1);
+                patch_jump(K, end_j);
+                return;
+            }
+            compile_expr(K, n->left);
+            compile_expr(K, n->right);
+            K->pos = n->pos;
+            BcOp op = BC_ADD;
+            switch ((OpType)n->op) {
+                case OP_PLUS:  op=BC_ADD; break; case OP_MINUS: op=BC_SUB; break;
+                case OP_MUL:   op=BC_MUL; break; case OP_DIV:   op=BC_DIV; break;
+                case OP_EQ:    op=BC_EQ;  break; case OP_NE:    op=BC_NE;  break;
+                case OP_LT:    op=BC_LT;  break; case OP_LE:    op=BC_LE;  break;
+                case OP_GT:    op=BC_GT;  break; case OP_GE:    op=BC_GE;  break;
+                default: break;
+            }
+            emit_op(K, op, -1);
+            return;
+        }
+        case N_INDEX:
+            compile_expr(K, n->left);
+            compile_expr(K, n->right);
+            K->pos = n->pos;
+            emit_op(K, BC_INDEX, -1);
+            return;
+        case N_CALL: {
+            NodeId a = n->extra;
+            int32_t slot = -1, nargs = 0;
+            if (g_builtins[n->op].mutates) { slot = K->A->nodes[a].slot; a = K->A->nodes[a].next; }
+            for (; a; a = K->A->nodes[a].next, nargs++) compile_expr(K, a);
+            K->pos = n->pos;
+            emit_word(K, slot >= 0 ? BC_CALL_MUT : BC_CALL);
+            emit_word(K, n->op);
+            emit_word(K, slot >= 0 ? slot : nargs);
+            stack_effect(K, 1 - nargs);
+            return;
+        }
+        case N_MAP:
+            emit_op1(K, BC_MAP_NEW, n->ival, +1);
+            for (NodeId k = n->extra; k; k = K->A->nodes[K->A->nodes[k].next].next) {
+                compile_expr(K, k);
+                compile_expr(K, K->A->nodes[k].next);
+                K->pos = K->A->nodes[k].pos; // erro de chave aponta para ela
+                emit_op(K, BC_MAP_PUT, -2);
+            }
+            return;
+        default:
+            // statements em posição de expressão (não gerados pelo parser)
+            compile_stmts(K, id);
+            emit_op1(K, BC_INT, 0, +1);
+            return;
+    }
+}
+
+/* Condição de if/loop seguida do salto para o caso falso. Comparações viram um
+   único compara-e-salta; `var op int` nem passa pela pilha. No _VK a palavra do
+   opcode carrega a posição da comparação e a do slot a da variável, para os
+   erros saírem onde o walker os reporta. */
+static int compile_cond_jump(Compiler* K, NodeId cond) {
+    const Node* c = &K->A->nodes[cond];
+    if (c->type != N_BINARY || c->op < OP_EQ || c->op > OP_GE) {
+        compile_expr(K, cond);
+        return emit_jump(K, BC_JUMP_IF_FALSE, -1);
+    }
+    const Node* l = &K->A->nodes[c->left];
+    const Node* r = &K->A->nodes[c->right];
+    if (l->type == N_VAR && r->type == N_INT) {
+        K->pos = c->pos;
+        emit_word(K, BC_JF_EQ_VK + (c->op - OP_EQ));
+        K->pos = l->pos;
+        emit_word(K, l->slot);
+        K->pos = c->pos;
+        emit_word(K, r->ival);
+        return emit_word(K, -1);
+    }
+    compile_expr(K, c->left);
+    compile_expr(K, c->right);
+    K->pos = c->pos;
+    return emit_jump(K, (BcOp)(BC_JF_EQ + (c->op - OP_EQ)), -2);
+}
+
+static void compile_stmt_body(Compiler* K, NodeId id) {
+    const Node* n = &K->A->nodes[id];
+    K->pos = n->pos;
+    switch ((NodeType)n->type) {
+        case N_ASSIGN: {
+            NodeId ops[APPEND_MAX]; uint32_t vpos;
+            int k = append_operands(K->A, n, ops, &vpos);
+            if (k == 1 && K->A->nodes[ops[0]].type == N_INT) { // var = var + int
+                emit_word(K, BC_INCR);
+                K->pos = vpos; // "not defined" sai na variável
+                emit_word(K, n->slot);
+                emit_word(K, K->A->nodes[ops[0]].ival);
+                return;
+            }
+            if (k) {
+                // o walker confere a variável antes de avaliar os operandos: se algum pode falhar, confere antes
+                int lits = 1;
+                for (int i=0;i<k;i++) { uint8_t t = K->A->nodes[ops[i]].type; if (t != N_INT && t != N_STRING) lits = 0; }
+                if (!lits) {
+                    emit_word(K, BC_CHECK_DEF);
+                    K->pos = vpos;
+                    emit_word(K, n->slot);
+                }
+                for (int i=0;i<k;i++) compile_expr(K, ops[i]);
+                K->pos = n->pos;
+                emit_word(K, BC_ADD_TO);
+                K->pos = vpos;
+                emit_word(K, n->slot);
+                emit_word(K, k);
+                stack_effect(K, -k);
+                return;
+            }
+            compile_expr(K, n->left);
+            K->pos = n->pos;
+            emit_op1(K, BC_STORE, n->slot, -1);
+            return;
+        }
+        case N_PRINT: {
+            int first = 1;
+            for (NodeId a = n->extra; a; a = K->A->nodes[a].next) {
+                compile_expr(K, a);
+                K->pos = n->pos;
+                emit_op1(K, BC_PRINT, first, -1);
+                first = 0;
+            }
+            emit_op(K, BC_NEWLINE, 0);
+            return;
+        }
+        case N_INPUT:
+            emit_op1(K, BC_INPUT, n->slot, 0);
+            return;
+        case N_SET_INDEX:
+            compile_expr(K, n->left);
+            compile_expr(K, n->right);
+            K->pos = n->pos;
+            emit_op1(K, BC_SET_INDEX, n->slot, -2);
+            return;
+        case N_IF: {
+            int else_j = compile_cond_jump(K, n->left);
+            K->pos = n->pos;
+            compile_stmts(K, n->extra);
+            if (n->right) {
+                int end_j = emit_jump(K, BC_JUMP, 0);
+                patch_jump(K, else_j);
+                compile_stmts(K, n->right);
+                patch_jump(K, end_j);
+            } else {
+                patch_jump(K, else_j);
+            }
+            return;
+        }
+        case N_WHILE: {
+            Chunk* C = K->C;
+            if (C->nloops >= C->cloops) {
+                C->cloops = C->cloops ? C->cloops*2 : 8;
+                C->loops = (LoopInfo*)realloc(C->loops, sizeof(LoopInfo)*C->cloops);
+            }
+            int g = C->nloops++;
+            emit_op1(K, BC_LOOP_INIT, g, 0);
+            int top = C->count;
+            emit_op1(K, BC_LOOP_CHECK, g, 0);
+            int exit_j = compile_cond_jump(K, n->left);
+            compile_stmts(K, n->extra);
+            K->pos = n->pos;
+            emit_op1(K, BC_JUMP, top, 0);
+            patch_jump(K, exit_j);
+            C->loops[g].top = top;
+            C->loops[g].end = C->count;
+            return;
+        }
+        case N_BLOCK:
+            compile_stmts(K, id);
+            return;
+        case N_RETURN: {
+            const Node* c = &K->A->nodes[n->left];
+            if (n->left && c->type == N_FCALL) { if (compile_fcall(K, c, 1)) return; }
+            else if (n->left) compile_expr(K, n->left);
+            else emit_op1(K, BC_INT, 0, +1);
+            K->pos = n->pos;
+            emit_op(K, BC_RET, -1);
+            return;
+        }
+        case N_FUNC: return; // o código vem depois do programa (compile_program)
+        default:
+            // expressão solta: avalia e descarta
+            compile_expr(K, id);
+            emit_op(K, BC_POP, -1);
+            return;
+    }
+}
+
+/* compila um comando anotando o trecho dele em C->stmts */
+static void compile_stmt(Compiler* K, NodeId id) {
+    const Node* n = &K->A->nodes[id];
+    if (n->type == N_BLOCK) { compile_stmts(K, id); return; }
+    if (n->type == N_FUNC) return;
+    Chunk* C = K->C;
+    if (C->nstmts >= C->cstmts) {
+        C->cstmts = C->cstmts ? C->cstmts*2 : 32;
+        C->stmts = (StmtInfo*)realloc(C->stmts, sizeof(StmtInfo)*C->cstmts);
+    }
+    int s = C->nstmts++;
+    C->stmts[s].top = C->count; C->stmts[s].pos = n->pos; C->stmts[s].kind = n->type;
+    compile_stmt_body(K, id);
+    C->stmts[s].end = C->count;
+}
+
+/* mesma forma de percorrer que exec_block */
+static void compile_stmts(Compiler* K, NodeId id) {
+    if (!id) return;
+    if (K->A->nodes[id].type != N_BLOCK) { compile_stmt(K, id); return; }
+    for (NodeId cur = K->A->nodes[id].extra; cur; cur = K->A->nodes[cur].next)
+        compile_stmt(K, cur);
+}
+
+/* Espera a árvore já resolvida (resolve). Depois do BC_HALT vem o corpo de
+   cada função de funcs, em ordem de símbolo, terminando num return 0 implícito;
+   as que vêm de outra Ast marcam o fonte delas em C->srcs. */
+static void compile_program(const Ast* A, NodeId prog, const FuncTab* funcs, Chunk* out) {
+    chunk_init(out);
+    out->src = A->src;
+    Compiler K = { out, A, 0, 0, 0, funcs, NULL };
+    if (funcs->cap) {
+        K.fidx = (int32_t*)malloc(sizeof(int32_t)*funcs->cap);
+        for (uint32_t s=0;s<funcs->cap;s++) {
+            K.fidx[s] = funcs->by_sym[s].A ? out->nfuncs++ : -1;
+            if (funcs->by_sym[s].A) out->nlsyms += funcs->by_sym[s].fn->nlocals;
+        }
+        out->funcs = (FuncProto*)calloc(out->nfuncs + 1, sizeof(FuncProto));
+        out->lsyms = (int32_t*)malloc(sizeof(int32_t)*(out->nlsyms + 1));
+        int f = 0, l = 0;
+        for (uint32_t s=0;s<funcs->cap;s++) {
+            const AstFunc* fn = funcs->by_sym[s].fn;
+            if (!funcs->by_sym[s].A) continue;
+            FuncProto* P = &out->funcs[f++];
+            P->nparams = fn->nparams; P->nlocals = fn->nlocals; P->sym = (int32_t)s;
+            P->locals = l;
+            for (int i=0;i<fn->nlocals;i++) out->lsyms[l++] = (int32_t)fn->locals[i];
+            if (fn->nlocals > out->max_locals) out->max_locals = fn->nlocals;
+        }
+    }
+    compile_stmts(&K, prog);
+    emit_op(&K, BC_HALT, 0);
+    out->max_stack = K.max_depth;
+    Source* cur = out->src;
+    for (int f=0;f<out->nfuncs;f++) {
+        FuncProto* P = &out->funcs[f];
+        const FuncRef* r = &funcs->by_sym[P->sym];
+        if (r->A->src != cur) {
+            out->srcs = (ChunkSrc*)realloc(out->srcs, sizeof(ChunkSrc)*(out->nsrcs + 1));
+            out->srcs[out->nsrcs].top = out->count;
+            out->srcs[out->nsrcs++].src = cur = r->A->src;
+        }
+        NodeId body = r->A->nodes[r->fn->node].extra;
+        K.A = r->A; K.depth = K.max_depth = 0;
+        P->entry = out->count;
+        compile_stmts(&K, body);
+        K.pos = r->A->nodes[body].pos;
+        emit_op1(&K, BC_INT, 0, +1);
+        emit_op(&K, BC_RET, -1);
+        P->max_stack = K.max_depth;
+        if (P->max_stack > out->max_fstack) out->max_fstack = P->max_stack;
+    }
+    free(K.fidx);
+}
+
+#endif
@@ -0,0 +1,580 @@
+#ifndef EXEC_H
+#define EXEC_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/* =================== Execução do bytecode =================== */
+/* Mesma semântica de eval/exec_block, mas sobre o código linear do Chunk.
+   O primeiro erro interrompe a execução (I->err, como no walker).
+   A pilha guarda referências próprias; as constantes são literais internados.
+
+   Com GCC/Clang o despacho é threaded (computed goto): cada handler salta
+   direto para o próximo, e cada salto indireto tem seu próprio histórico no
+   preditor. Compilar com -DSUN_SWITCH_DISPATCH volta para o switch, para
+   comparar os dois.
+
+   Com I->prof o despacho threaded usa uma segunda tabela que leva todo opcode
+   ao stub L_PROF (conta e segue para o handler de verdade); a tabela normal não
+   muda, então sem profiler não há custo. No switch é um teste por instrução.
+
+   Combustível: cada BC_LOOP_CHECK gasta uma volta de um contador local. Quando
+   ele zera, sem I->yield puxa a próxima fatia do orçamento e segue; com yield
+   o vm_run guarda ip, pilha e JIT num VmFrame (I->frame) e devolve RUN_YIELD,
+   e a próxima chamada continua do mesmo BC_LOOP_CHECK. input() sem linha
+   pronta faz o mesmo com RUN_WAIT.
+
+   Quickening: cada execução roda numa cópia própria do código (o Chunk continua
+   só lido e compartilhado). Um BC_ADD/SUB/MUL/DIV ou comparação que vê dois ints
+   se reescreve na forma _II, que testa os tipos e opera direto nos slots da
+   pilha; se o teste falha ela volta a ser o op genérico e é reexecutada.
+
+   Funções: os quadros (Var) ficam em sequência numa pilha de locais alocada
+   uma vez por execução para CALL_MAX chamadas, e a pilha de operandos tem
+   lugar para CALL_MAX corpos; chamar não aloca nada. BC_CALL_F passa os
+   argumentos do topo da pilha para o quadro novo e guarda o retorno num
+   VmCall; BC_TAIL_F troca o quadro atual pelo da função chamada. Cada chamada
+   gasta uma unidade de combustível, como uma volta de loop. */
+
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(SUN_SWITCH_DISPATCH)
+#define VM_THREADED 1
+#endif
+
+#define VM_ERR_POS(C, ip) chunk_src(C, (int32_t)((ip)-code-1)), (C)->pos[(ip)-code-1]
+#define VM_ERR_AT(C, w)   chunk_src(C, (int32_t)((w)-code)), (C)->pos[(w)-code]
+
+#ifdef VM_THREADED
+#  define VM_DISPATCH  VM_NEXT;
+#  define VM_CASE(op)  L_##op:
+#  define VM_NEXT      goto *dispatch[*ip++]
+#else
+#  define VM_DISPATCH  for (;;) switch ((BcOp)(prof ? vm_prof_op(prof, code, ip++) : *ip++))
+#  define VM_CASE(op)  case op:
+#  define VM_NEXT      break
+#endif
+
+/* compara-e-salta: caminho rápido int/int inline, o resto passa por cmp_any */
+#define VM_JF_CMP(OP, REL) \
+    VM_CASE(OP) { \
+        Value b = sp[-1], a = sp[-2]; \
+        sp -= 2; \
+        int t; \
+        if (a.type==V_INT && b.type==V_INT) t = a.i REL b.i; \
+        else { \
+            Value r = cmp_any(E, VM_ERR_POS(C, ip), a, b, (OpType)(OP_EQ + (OP - BC_JF_EQ))); \
+            val_release(a); val_release(b); \
+            if (E->kind) goto done; \
+            t = r.i; \
+        } \
+        ip = t ? ip + 1 : code + *ip; \
+        VM_NEXT; \
+    }
+
+#define VM_JF_CMP_VK(OP, REL) \
+    VM_CASE(OP) { \
+        Var* v = &vars[ip[0]]; \
+        if (!v->defined) { set_error_at(E, ERR_RUNTIME, VM_ERR_AT(C, ip), "var '%s' not defined", v->name); goto done; } \
+        int t; \
+        if (v->val.type==V_INT) t = v->val.i REL ip[1]; \
+        else { set_error_at(E, ERR_RUNTIME, VM_ERR_POS(C, ip), "incompatibles"); goto done; } \
+        ip = t ? ip + 3 : code + ip[2]; \
+        VM_NEXT; \
+    }
+
+/* troca a instrução em ip[-1] por OP. O código do Chunk (às vezes o .smc
+   mapeado só para leitura) é copiado na primeira troca, então uma execução
+   sem quickening roda direto dele; ip e os retornos pendentes passam para a cópia */
+#define VM_QUICKEN(OP) do { \
+        if (code == C->code) { \
+            code = vm_code_copy(C, calls, ncalls); \
+            ip = code + (ip - C->code); \
+        } \
+        ip[-1] = (OP); \
+    } while (0)
+
+/* forma quickened: dois ints (e ok) opera no lugar; senão volta ao genérico e o reexecuta.
+   Só existe na cópia, então a volta escreve direto */
+#define VM_II(OP, GEN, OK, EXPR) \
+    VM_CASE(OP) \
+        if (sp[-1].type==V_INT && sp[-2].type==V_INT && (OK)) { sp[-2].i = (EXPR); sp--; VM_NEXT; } \
+        *--ip = GEN; \
+        if (prof) prof_redispatch(prof, (int32_t)(ip - code)); \
+        VM_NEXT;
+
+#ifndef VM_THREADED
+static int32_t vm_prof_op(Prof* P, const int32_t* code, const int32_t* at) {
+    prof_tick(P, (int32_t)(at - code));
+    return *at;
+}
+#endif
+
+typedef enum { RUN_DONE, RUN_YIELD, RUN_WAIT } RunStatus;
+
+/* uma chamada em andamento: fn é a chamada, ret e vars são de quem chamou */
+typedef struct { int32_t* ret; Var* vars; const FuncProto* fn; } VmCall;
+
+/* vm_run suspenso: tudo que não cabe na Interp */
+typedef struct VmFrame {
+    int32_t* code;  // C->code até o primeiro quickening; depois a cópia reescrita (VM_QUICKEN)
+    int32_t ip;
+    Value* stack; int depth;
+    int waited;     // o input() em ip já mostrou o prompt
+    Var* locals;    // quadros das funções; [locals, ltop) em uso
+    Var* vars;      // quadro atual (NULL: o programa, I->vars)
+    Var* ltop;
+    VmCall* calls; int ncalls;
+#ifdef SUN_JIT
+    Jit jit; int has_jit;
+#endif
+} VmFrame;
+
+static int32_t* vm_code_copy(const Chunk* C, VmCall* calls, int ncalls) {
+    int32_t* code = (int32_t*)malloc(sizeof(int32_t) * (C->count + 1));
+    memcpy(code, C->code, sizeof(int32_t) * C->count);
+    for (int i=0;i<ncalls;i++) calls[i].ret = code + (calls[i].ret - C->code);
+    return code;
+}
+
+/* O Chunk só é lido: várias threads podem rodá-lo, cada uma com sua Interp.
+   use_jit: com SUN_JIT, loops quentes só de ints passam para código nativo (jit.h).
+   RUN_YIELD/RUN_WAIT só com I->yield; chamar de novo com o mesmo Chunk retoma. */
+static RunStatus vm_run(Interp* I, const Chunk* C, int use_jit) {
+    VmFrame* F = I->frame;
+    if (!F) {
+        F = (VmFrame*)calloc(1, sizeof(VmFrame));
+        F->code = C->code;
+        int fstack = C->nfuncs ? CALL_MAX * C->max_fstack : 0;
+        F->stack = (Value*)malloc(sizeof(Value) * (C->max_stack + fstack + 1));
+        if (C->nfuncs) {
+            F->locals = (Var*)malloc(sizeof(Var) * ((size_t)CALL_MAX * C->max_locals + 1));
+            F->calls = (VmCall*)malloc(sizeof(VmCall) * CALL_MAX);
+        }
+        F->ltop = F->locals;
+    }
+    I->frame = NULL;
+    Value* stack = F->stack;
+    Value* sp = stack + F->depth;
+    Var* globals = I->vars; // interp_reserve já criou todos os slots
+    Var* vars = F->vars ? F->vars : globals;
+    Var* ltop = F->ltop;
+    VmCall* calls = F->calls;
+    int ncalls = F->ncalls;
+    int nvars = ncalls ? calls[ncalls-1].fn->nlocals : I->nvars;
+    Error* E = &I->err;
+    int32_t* code = F->code;
+    int32_t* ip = code + F->ip;
+    int waited = F->waited;
+    int64_t fuel = I->fuel;
+    RunStatus st = RUN_DONE;
+    Prof* prof = I->prof;
+    if (prof) { use_jit = 0; prof_start(prof); }
+#ifdef SUN_JIT
+    Jit* jit = NULL;
+    if (use_jit && !F->has_jit) { jit_init(&F->jit, C); F->has_jit = 1; }
+    if (F->has_jit) jit = &F->jit;
+#else
+    (void)use_jit;
+#endif
+
+#ifdef VM_THREADED
+    /* na ordem de BcOp */
+    static void* const labels[] = {
+        &&L_BC_INT, &&L_BC_CONST, &&L_BC_LOAD, &&L_BC_STORE, &&L_BC_POP,
+        &&L_BC_NEG, &&L_BC_POS, &&L_BC_NOT, &&L_BC_BOOL,
+        &&L_BC_ADD, &&L_BC_SUB, &&L_BC_MUL, &&L_BC_DIV,
+        &&L_BC_EQ, &&L_BC_NE, &&L_BC_LT, &&L_BC_LE, &&L_BC_GT, &&L_BC_GE,
+        &&L_BC_JUMP, &&L_BC_JUMP_IF_FALSE, &&L_BC_JUMP_IF_TRUE,
+        &&L_BC_PRINT, &&L_BC_NEWLINE, &&L_BC_INPUT,
+        &&L_BC_LOOP_INIT, &&L_BC_LOOP_CHECK,
+        &&L_BC_JF_EQ, &&L_BC_JF_NE, &&L_BC_JF_LT, &&L_BC_JF_LE, &&L_BC_JF_GT, &&L_BC_JF_GE,
+        &&L_BC_JF_EQ_VK, &&L_BC_JF_NE_VK, &&L_BC_JF_LT_VK, &&L_BC_JF_LE_VK, &&L_BC_JF_GT_VK, &&L_BC_JF_GE_VK,
+        &&L_BC_INCR, &&L_BC_CHECK_DEF, &&L_BC_ADD_TO,
+        &&L_BC_INDEX, &&L_BC_SET_INDEX, &&L_BC_CALL, &&L_BC_CALL_MUT,
+        &&L_BC_MAP_NEW, &&L_BC_MAP_PUT,
+        &&L_BC_LOAD_G, &&L_BC_CALL_F, &&L_BC_TAIL_F, &&L_BC_RET,
+        &&L_BC_ADD_II, &&L_BC_SUB_II, &&L_BC_MUL_II, &&L_BC_DIV_II,
+        &&L_BC_EQ_II, &&L_BC_NE_II, &&L_BC_LT_II, &&L_BC_LE_II, &&L_BC_GT_II, &&L_BC_GE_II,
+        &&L_BC_HALT
+    };
+    (void)sizeof(char[sizeof(labels)/sizeof(labels[0]) == BC_HALT+1 ? 1 : -1]); // tabela em dia com BcOp
+    void* const* dispatch = labels;
+    void* prof_labels[BC_HALT+1];
+    if (prof) {
+        for (int i=0;i<=BC_HALT;i++) prof_labels[i] = &&L_PROF;
+        dispatch = prof_labels;
+    }
+#endif
+
+    VM_DISPATCH {
+        VM_CASE(BC_INT)   *sp++ = V_int(*ip++); VM_NEXT;
+        VM_CASE(BC_CONST) *sp++ = C->consts[*ip++]; VM_NEXT;
+        VM_CASE(BC_LOAD) {
+            Var* v = &vars[*ip++];
+            if (!v->defined) { set_error_at(E, ERR_RUNTIME, VM_ERR_POS(C, ip), "var '%s' not defined", v->name); goto done; }
+            val_retain(v->val);
+            *sp++ = v->val;
+            VM_NEXT;
+        }
+        VM_CASE(BC_STORE) {
+            Var* slot = &vars[*ip++];
+            val_release(slot->val);
+            slot->val = *--sp; slot->defined = 1;
+            VM_NEXT;
+        }
+        VM_CASE(BC_POP) val_release(*--sp); VM_NEXT;
+        VM_CASE(BC_NEG)
+            if (sp[-1].type!=V_INT) { set_error_at(E, ERR_RUNTIME, VM_ERR_POS(C, ip), "- unary is not int"); goto done; }
+            sp[-1].i = int_neg(sp[-1].i);
+            VM_NEXT;
+        VM_CASE(BC_POS)
+            if (sp[-1].type!=V_INT) { set_error_at(E, ERR_RUNTIME, VM_ERR_POS(C, ip), "+ unáry is not int"); goto done; }
+            VM_NEXT;
+        VM_CASE(BC_NOT) VM_CASE(BC_BOOL) {
+            int t = truthy(sp[-1]);
+            val_release(sp[-1]);
+            sp[-1] = V_int(ip[-1]==BC_NOT ? !t : t!=0);
+            VM_NEXT;
+        }
+        VM_CASE(BC_ADD) {
+            Value b = *--sp, a = sp[-1];
+            if (a.type==V_INT && b.type==V_INT) VM_QUICKEN(BC_ADD_II);
+            sp[-1] = add_any(E, VM_ERR_POS(C, ip), a, b);
+            val_release(a); val_release(b);
+            if (E->kind) goto done;
+            VM_NEXT;
+        }
+        VM_CASE(BC_SUB) VM_CASE(BC_MUL) VM_CASE(BC_DIV) {
+            static const OpType ops[] = { OP_MINUS, OP_MUL, OP_DIV };
+            Value b = *--sp, a = sp[-1];
+            int k = ip[-1] - BC_SUB;
+            if (a.type==V_INT && b.type==V_INT && (ip[-1]!=BC_DIV || b.i)) VM_QUICKEN(BC_SUB_II + k);
+            sp[-1] = bin_num_num(E, VM_ERR_POS(C, ip), a, b, ops[k]);
+            val_release(a); val_release(b);
+            if (E->kind) goto done;
+            VM_NEXT;
+        }
+        VM_CASE(BC_EQ) VM_CASE(BC_NE) VM_CASE(BC_LT) VM_CASE(BC_LE) VM_CASE(BC_GT) VM_CASE(BC_GE) {
+            static const OpType ops[] = { OP_EQ, OP_NE, OP_LT, OP_LE, OP_GT, OP_GE };
+            Value b = *--sp, a = sp[-1];
+            int k = ip[-1] - BC_EQ;
+            if (a.type==V_INT && b.type==V_INT) VM_QUICKEN(BC_EQ_II + k);
+            sp[-1] = cmp_any(E, VM_ERR_POS(C, ip), a, b, ops[k]);
+            val_release(a); val_release(b);
+            if (E->kind) goto done;
+            VM_NEXT;
+        }
+        VM_CASE(BC_JUMP) ip = code + *ip; VM_NEXT;
+        VM_CASE(BC_JUMP_IF_FALSE) VM_CASE(BC_JUMP_IF_TRUE) {
+            Value c = *--sp;
+            int t = truthy(c);
+            val_release(c);
+            if (t == (ip[-1]==BC_JUMP_IF_TRUE)) ip = code + *ip; else ip++;
+            VM_NEXT;
+        }
+        VM_CASE(BC_PRINT)
+            if (!*ip++) out_char(&I->io, ' ');
+            print_value(&I->io, *--sp);
+            val_release(*sp);
+            VM_NEXT;
+        VM_CASE(BC_NEWLINE) out_newline(&I->io); VM_NEXT;
+        VM_CASE(BC_INPUT) {
+            Var* slot = &vars[*ip++];
+            char buf[512];
+            if (!waited) io_prompt(&I->io);
+            waited = 0;
+            if (I->yield && !in_poll(&I->io)) { ip -= 2; waited = 1; st = RUN_WAIT; goto suspend; }
+            if (!in_line(&I->io, buf, sizeof(buf))) { set_error_at(E, ERR_RUNTIME, VM_ERR_POS(C, ip), "error in len"); goto done; }
+            buf[strcspn(buf,"\n")]=0;
+            val_release(slot->val);
+            slot->val = V_str(buf); slot->defined = 1;
+            VM_NEXT;
+        }
+        VM_CASE(BC_LOOP_INIT) ip++; VM_NEXT; // só marca a entrada do loop (prof.h conta)
+        VM_CASE(BC_LOOP_CHECK) {
+            int g = *ip++;
+            if (fuel <= 0) {
+                if (I->yield && I->budget) { ip -= 2; st = RUN_YIELD; goto suspend; }
+                if (!fuel_refill(I, FUEL_SLICE)) { set_error_at(E, ERR_RUNTIME, VM_ERR_POS(C, ip), "out of fuel"); goto done; }
+                fuel = I->fuel;
+            }
+            fuel--;
+#ifdef SUN_JIT
+            if (jit) {
+                I->fuel = fuel; // o código nativo gasta direto em I->fuel
+                int32_t pc = jit_enter(jit, C, g, vars, nvars, &I->fuel);
+                fuel = I->fuel;
+                if (pc >= 0) ip = code + pc;
+            }
+#endif
+            VM_NEXT;
+        }
+        VM_JF_CMP(BC_JF_EQ, ==) VM_JF_CMP(BC_JF_NE, !=)
+        VM_JF_CMP(BC_JF_LT, < ) VM_JF_CMP(BC_JF_LE, <=)
+        VM_JF_CMP(BC_JF_GT, > ) VM_JF_CMP(BC_JF_GE, >=)
+        VM_JF_CMP_VK(BC_JF_EQ_VK, ==) VM_JF_CMP_VK(BC_JF_NE_VK, !=)
+        VM_JF_CMP_VK(BC_JF_LT_VK, < ) VM_JF_CMP_VK(BC_JF_LE_VK, <=)
+        VM_JF_CMP_VK(BC_JF_GT_VK, > ) VM_JF_CMP_VK(BC_JF_GE_VK, >=)
+        VM_CASE(BC_INCR) {
+            Var* v = &vars[ip[0]];
+            if (!v->defined) { set_error_at(E, ERR_RUNTIME, VM_ERR_AT(C, ip), "var '%s' not defined", v->name); goto done; }
+            if (v->val.type==V_INT) v->val.i = int_add(v->val.i, ip[1]);
+            else {
+                var_append(E, VM_ERR_POS(C, ip), v, V_int(ip[1]));
+                if (E->kind) goto done;
+            }
+            ip += 2;
+            VM_NEXT;
+        }
+        VM_CASE(BC_CHECK_DEF) {
+            Var* v = &vars[*ip++];
+            if (!v->defined) { set_error_at(E, ERR_RUNTIME, VM_ERR_POS(C, ip), "var '%s' not defined", v->name); goto done; }
+            VM_NEXT;
+        }
+        VM_CASE(BC_ADD_TO) {
+            Var* v = &vars[ip[0]];
+            if (!v->defined) { set_error_at(E, ERR_RUNTIME, VM_ERR_AT(C, ip), "var '%s' not defined", v->name); goto done; }
+            int k = ip[1];
+            ip += 2;
+            sp -= k;
+            for (int i=0;i<k;i++) {
+                if (v->val.type==V_INT && sp[i].type==V_INT) v->val.i = int_add(v->val.i, sp[i].i);
+                else {
+                    var_append(E, VM_ERR_POS(C, ip - 2), v, sp[i]);
+                    val_release(sp[i]);
+                    if (E->kind) { while (++i < k) val_release(sp[i]); goto done; } // só com array ou mapa
+                }
+            }
+            VM_NEXT;
+        }
+        VM_CASE(BC_INDEX) {
+            Value i = sp[-1], a = sp[-2];
+            if (a.type!=V_ARRAY || i.type!=V_INT || (uint32_t)i.i >= (uint32_t)a.a->len) {
+                Value r;
+                if (!index_value(E, VM_ERR_POS(C, ip), a, i, &r)) goto done;
+                sp--;
+                sp[-1] = r;
+                val_release(a); val_release(i);
+                VM_NEXT;
+            }
+            sp--;
+            sp[-1] = V_int(a.a->data[i.i]);
+            val_release(a);
+            VM_NEXT;
+        }
+        VM_CASE(BC_SET_INDEX) {
+            Var* v = &vars[*ip++];
+            if (!index_store(E, VM_ERR_POS(C, ip - 1), v, sp[-2], sp[-1])) goto done;
+            sp -= 2;
+            VM_NEXT;
+        }
+        VM_CASE(BC_CALL) VM_CASE(BC_CALL_MUT) {
+            int mut = ip[-1]==BC_CALL_MUT, n = mut ? 1 : ip[1];
+            Value r = builtin_call(E, VM_ERR_POS(C, ip), ip[0], mut ? &vars[ip[1]] : NULL, sp - n);
+            ip += 2;
+            while (n--) val_release(*--sp);
+            *sp++ = r;
+            if (E->kind) goto done;
+            VM_NEXT;
+        }
+        VM_CASE(BC_MAP_NEW) {
+            *sp++ = V_map(map_new((uint32_t)*ip++));
+            VM_NEXT;
+        }
+        VM_CASE(BC_MAP_PUT) {
+            Value k = sp[-2];
+            if (!map_key_check(E, VM_ERR_POS(C, ip), k)) goto done;
+            map_put(sp[-3].m, k, map_hash(k), sp[-1]);
+            sp -= 2;
+            VM_NEXT;
+        }
+        VM_CASE(BC_LOAD_G) {
+            Var* v = &globals[*ip++];
+            if (!v->defined) { set_error_at(E, ERR_RUNTIME, VM_ERR_POS(C, ip), "var '%s' not defined", v->name); goto done; }
+            val_retain(v->val);
+            *sp++ = v->val;
+            VM_NEXT;
+        }
+        VM_CASE(BC_CALL_F) VM_CASE(BC_TAIL_F) {
+            int tail = ip[-1]==BC_TAIL_F;
+            if (ip[0] < 0) { set_error_at(E, ERR_RUNTIME, VM_ERR_POS(C, ip), "unknown function '%s'", globals[ip[1]].name); goto done; }
+            const FuncProto* fn = &C->funcs[ip[0]];
+            int np = fn->nparams;
+            if (ip[2] != np) {
+                set_error_at(E, ERR_RUNTIME, VM_ERR_POS(C, ip), "'%s' takes %d argument%s", globals[ip[1]].name, np, np == 1 ? "" : "s");
+                goto done;
+            }
+            if (fuel <= 0) {
+                if (I->yield && I->budget) { ip--; st = RUN_YIELD; goto suspend; }
+                if (!fuel_refill(I, FUEL_SLICE)) { set_error_at(E, ERR_RUNTIME, VM_ERR_POS(C, ip), "out of fuel"); goto done; }
+                fuel = I->fuel;
+            }
+            fuel--;
+            if (tail) {
+                while (ltop > vars) val_release((--ltop)->val);
+                calls[ncalls-1].fn = fn;
+            } else {
+                if (ncalls == CALL_MAX) { set_error_at(E, ERR_RUNTIME, VM_ERR_POS(C, ip), "stack overflow"); goto done; }
+                VmCall* ci = &calls[ncalls++];
+                ci->ret = ip + 3; ci->vars = vars; ci->fn = fn;
+                vars = ltop;
+            }
+            sp -= np;
+            const int32_t* ls = C->lsyms + fn->locals;
+            for (int i=0;i<np;i++) { vars[i].val = sp[i]; vars[i].defined = 1; vars[i].name = globals[ls[i]].name; }
+            for (int i=np;i<fn->nlocals;i++) { vars[i].val = V_int(0); vars[i].defined = 0; vars[i].name = globals[ls[i]].name; }
+            ltop = vars + fn->nlocals;
+            nvars = fn->nlocals;
+            ip = code + fn->entry;
+            VM_NEXT;
+        }
+        VM_CASE(BC_RET) {
+            Value r = *--sp;
+            while (ltop > vars) val_release((--ltop)->val);
+            VmCall* ci = &calls[--ncalls];
+            vars = ci->vars; ip = ci->ret;
+            nvars = ncalls ? calls[ncalls-1].fn->nlocals : I->nvars;
+            *sp++ = r;
+            VM_NEXT;
+        }
+        VM_II(BC_ADD_II, BC_ADD, 1, int_add(sp[-2].i, sp[-1].i))
+        VM_II(BC_SUB_II, BC_SUB, 1, int_sub(sp[-2].i, sp[-1].i))
+        VM_II(BC_MUL_II, BC_MUL, 1, int_mul(sp[-2].i, sp[-1].i))
+        VM_II(BC_DIV_II, BC_DIV, sp[-1].i != 0, int_div(sp[-2].i, sp[-1].i)) // zero: o genérico reporta
+        VM_II(BC_EQ_II, BC_EQ, 1, sp[-2].i == sp[-1].i) VM_II(BC_NE_II, BC_NE, 1, sp[-2].i != sp[-1].i)
+        VM_II(BC_LT_II, BC_LT, 1, sp[-2].i <  sp[-1].i) VM_II(BC_LE_II, BC_LE, 1, sp[-2].i <= sp[-1].i)
+        VM_II(BC_GT_II, BC_GT, 1, sp[-2].i >  sp[-1].i) VM_II(BC_GE_II, BC_GE, 1, sp[-2].i >= sp[-1].i)
+        VM_CASE(BC_HALT) goto done;
+    }
+#ifdef VM_THREADED
+L_PROF:
+    prof_tick(prof, (int32_t)(ip - 1 - code));
+    goto *labels[ip[-1]];
+#endif
+suspend:
+    if (prof) prof_stop(prof);
+    F->code = code;
+    F->ip = (int32_t)(ip - code);
+    F->depth = (int)(sp - stack);
+    F->waited = waited;
+    F->vars = ncalls ? vars : NULL;
+    F->ltop = ltop; F->ncalls = ncalls;
+    I->frame = F;
+    I->fuel = fuel;
+    return st;
+done:
+    if (prof) prof_stop(prof);
+    I->fuel = fuel;
+    while (sp > stack) val_release(*--sp);
+    while (ltop > F->locals) val_release((--ltop)->val);
+    free(F->locals); free(F->calls);
+    free(stack);
+    if (code != C->code) free(code);
+#ifdef SUN_JIT
+    if (F->has_jit) jit_free(&F->jit);
+#endif
+    free(F);
+    return RUN_DONE;
+}
+
+/* =================== Programa =================== */
+typedef enum { EXEC_BYTECODE, EXEC_INTERP, EXEC_TREE } ExecMode;
+
+/* Árvore já dobrada e resolvida mais o bytecode. Depois de program_prepare nada
+   aqui é escrito, então um Program pode ser rodado por várias Interp em paralelo. */
+typedef struct {
+    Ast* ast; NodeId root;      // ast == NULL quando veio do cache (.smc)
+    const SymTab* syms;
+    ExecMode mode;
+    FuncTab funcs;              // as de outer mais as de A (vazia quando veio do cache)
+    Chunk chunk;
+} Program;
+
+/* EXEC_INTERP é o bytecode sem JIT; EXEC_TREE mantém o walker recursivo como referência.
+   outer (ou NULL): funções já definidas em outras Ast que A pode chamar (REPL);
+   as de A têm precedência. */
+static void program_prepare(Program* P, Ast* A, NodeId root, ExecMode mode, const FuncTab* outer) {
+    P->ast = A; P->root = root; P->syms = A->syms; P->mode = mode;
+    fold_constants(A, root);
+    resolve(A, root);
+    functab_init(&P->funcs, outer);
+    for (uint32_t i=0;i<A->nfuncs;i++) functab_add(&P->funcs, A, &A->funcs[i]);
+    // o índice de linhas é preguiçoso: monta agora para os erros não escreverem no Source compartilhado
+    if (!A->src->lines) source_index_lines(A->src);
+    if (mode == EXEC_TREE) chunk_init(&P->chunk);
+    else compile_program(A, root, &P->funcs, &P->chunk);
+}
+
+/* uma fatia de execução: RUN_YIELD/RUN_WAIT deixam o programa suspenso em I->frame
+   (só bytecode com I->yield; o walker sempre vai até o fim) */
+static RunStatus program_step(const Program* P, Interp* I) {
+    RunStatus st = RUN_DONE;
+    if (!I->frame) interp_reserve(I, P->syms);
+    if (P->mode == EXEC_TREE) exec_program(I, P->ast, P->root, &P->funcs);
+    else st = vm_run(I, &P->chunk, P->mode == EXEC_BYTECODE);
+    if (st != RUN_YIELD) out_flush(&I->io);
+    return st;
+}
+
+/* até o fim: sem yield o fuel acabando puxa do orçamento e o input() bloqueia */
+static void program_run(const Program* P, Interp* I) {
+    int y = I->yield;
+    I->yield = 0;
+    program_step(P, I);
+    I->yield = y;
+}
+
+static void program_free(Program* P) { chunk_free(&P->chunk); functab_free(&P->funcs); }
+
+/* =================== Unidade =================== */
+/* Um arquivo .sm do fonte até o Program: dono de tudo que o programa referencia.
+   Com use_cache, um .smc em dia pula lex/parse/compile; sem ele, o cache é
+   gravado depois de compilar. O walker (EXEC_TREE) precisa da árvore e não usa cache. */
+typedef struct {
+    Source src;
+    SymTab syms;
+    Ast ast;
+    Program prog;
+    SmcMap smc;     // mem != NULL: chunk e syms apontam para o .smc
+    int loaded;
+    int saved;      // compilou e gravou o .smc
+} Unit;
+
+/* 0 se não abriu (E vazio) ou se lex/parse falhou (E preenchido, *phase = "lex"/"parse") */
+static inline int unit_load(Unit* U, const char* path, ExecMode mode, int use_cache, Error* E, const char** phase) {
+    memset(U, 0, sizeof(*U));
+    clear_error(E);
+    if (!source_open(&U->src, path)) return 0;
+    char cpath[4096];
+    use_cache = use_cache && mode != EXEC_TREE && smc_path(cpath, sizeof(cpath), path);
+    if (use_cache && smc_load(&U->smc, cpath, &U->src, &U->prog.chunk, &U->syms)) {
+        U->prog.syms = &U->syms;
+        U->prog.mode = mode;
+        return 1;
+    }
+    symtab_init(&U->syms);
+    TokenVec toks = { NULL, 0, 0, NULL, &U->syms };
+    lex_all(&U->src, &toks, E);
+    ast_init(&U->ast, &U->src, &U->syms);
+    U->loaded = 1;
+    if (E->kind) { *phase = "lex"; tokvec_free(&toks); return 0; }
+    Parser P = { toks.data, 0, toks.count, &U->ast, E, 0, 0, 0 };
+    NodeId root = parse_program(&P);
+    tokvec_free(&toks);
+    if (!root || E->kind) { *phase = "parse"; return 0; }
+    program_prepare(&U->prog, &U->ast, root, mode, NULL);
+    if (use_cache) U->saved = smc_save(cpath, &U->src, &U->prog.chunk, &U->syms);
+    return 1;
+}
+
+static inline void unit_free(Unit* U) {
+    if (U->smc.mem) smc_unmap(&U->smc, &U->src); // chunk e syms são do mapa
+    else if (U->loaded) {
+        program_free(&U->prog);
+        ast_free(&U->ast);
+        symtab_free(&U->syms);
+    }
+    source_close(&U->src);
+}
+
+#endif
@@ -0,0 +1,288 @@
+#ifndef INCR_H
+#define INCR_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/* =================== Front-end incremental =================== */
+/* Documento editável: texto, tokens e árvore ficam em dia a cada edição sem
+   refazer o arquivo inteiro.
+   - Re-lex: recomeça no token que toca a edição e para quando um token novo,
+     já depois do texto inserido, começa exatamente onde começava um antigo
+     (deslocado). Dali em diante o texto é o mesmo, então os tokens também; eles
+     só têm o offset deslocado.
+   - Re-parse: a unidade é o comando de nível superior. Os comandos que tocam os
+     tokens trocados saem da tabela e deixam um buraco. O buraco é reparseado a
+     partir do comando anterior (um 'else' novo muda o 'if' de antes) até o fim
+     de um comando cair no início de um comando que ficou.
+   - Nós guardam pos relativo ao início do seu comando (DocStmt.off), então
+     deslocar os comandos seguintes é mexer num offset por comando; a cópia
+     para rodar (doc_snapshot) volta aos offsets absolutos.
+   - Um buraco que não parseia (edição pela metade) continua na tabela até uma
+     edição consertá-lo; o resto do documento segue válido. Erro de lex deixa os
+     tokens inválidos, e a edição seguinte refaz tudo.
+   Nós substituídos ficam órfãos no arena. Quando ele passa do dobro do tamanho
+   da última reconstrução, o documento é refeito do zero. */
+
+typedef struct {
+    NodeId node;
+    int tb, te;         // tokens [tb, te)
+    uint32_t off;       // offset do primeiro token; base do pos dos nós
+    NodeId nb, ne;      // nós do comando: [nb, ne) no arena
+} DocStmt;
+
+typedef struct {
+    int full;       // refez tudo
+    int relexed;    // tokens lexados
+    int reparsed;   // comandos parseados
+} DocStats;
+
+typedef struct {
+    char* text; uint32_t len, cap;
+    Source src;             // sobre text
+    SymTab* syms;           // de quem chama (a REPL divide com as entradas)
+    TokenVec toks;          // termina em T_EOF quando lex_ok
+    Ast ast;
+    NodeId root;            // N_BLOCK com os comandos (doc_snapshot religa)
+    DocStmt* stmts; int nstmts, cstmts;
+    int lex_ok;
+    uint32_t rebuild_nodes; // ast.count logo depois da última reconstrução
+    Error err;              // primeiro erro pendente (lex ou parse)
+    DocStats stats;         // da última edição
+} Doc;
+
+static uint32_t doc_tok_begin(const Token* t) { return t->type==T_STRING ? t->off-1 : t->off; }
+static uint32_t doc_tok_end(const Token* t)   { return t->type==T_STRING ? t->off+t->len+1 : t->off+t->len; }
+
+static void doc_text_changed(Doc* D) {
+    D->src.data = D->text; D->src.len = D->len;
+    free(D->src.lines); D->src.lines = NULL; D->src.nlines = 0;
+}
+
+static int doc_rebuild(Doc* D);
+
+static void doc_init(Doc* D, SymTab* syms) {
+    memset(D, 0, sizeof(*D));
+    D->syms = syms;
+    D->cap = 256;
+    D->text = (char*)malloc(D->cap);
+    D->text[0] = 0;
+    doc_text_changed(D);
+    D->toks.src = &D->src; D->toks.syms = syms;
+    doc_rebuild(D); // documento vazio, válido
+}
+
+static void doc_free(Doc* D) {
+    free(D->text); free(D->src.lines);
+    tokvec_free(&D->toks);
+    ast_free(&D->ast);
+    free(D->stmts);
+    memset(D, 0, sizeof(*D));
+}
+
+static int doc_ok(const Doc* D) { return D->lex_ok && !D->err.kind; }
+
+/* troca stmts[s0, s1) por n comandos novos */
+static void doc_stmts_replace(Doc* D, int s0, int s1, const DocStmt* ns, int n) {
+    int count = D->nstmts - (s1 - s0) + n;
+    if (count > D->cstmts) {
+        while (count > D->cstmts) D->cstmts = D->cstmts ? D->cstmts*2 : 64;
+        D->stmts = (DocStmt*)realloc(D->stmts, sizeof(DocStmt)*D->cstmts);
+    }
+    memmove(D->stmts + s0 + n, D->stmts + s1, sizeof(DocStmt)*(D->nstmts - s1));
+    memcpy(D->stmts + s0, ns, sizeof(DocStmt)*n);
+    D->nstmts = count;
+}
+
+/* Reparseia os buracos da tabela (trechos de tokens sem comando) a partir de
+   stmts[s]; antes dele não há buraco. Sem all, para no primeiro buraco (o único
+   que uma edição sobre um documento sem erro abre). 1 se todos fecharam; senão
+   D->err tem o primeiro erro. */
+static int doc_reparse(Doc* D, int s, int all) {
+    int eof = D->toks.count - 1;
+    int c = s > 0 ? D->stmts[s-1].te : 0; // token onde o próximo comando deveria começar
+    DocStmt* ns = NULL; int nn = 0, cn = 0;
+    int ok = 1;
+    for (;;) {
+        while (s < D->nstmts && D->stmts[s].tb == c) { c = D->stmts[s].te; s++; }
+        if (s == D->nstmts && c == eof) break;
+        // buraco antes de stmts[s] (ou no fim): recomeça no comando anterior
+        int s0 = s > 0 ? s-1 : 0;
+        Error E; clear_error(&E);
+        Parser P = { D->toks.data, s > 0 ? D->stmts[s-1].tb : c, D->toks.count, &D->ast, &E, 0, 0, 0 };
+        int s1 = s, synced = 0;
+        nn = 0;
+        for (;;) {
+            if (P.pos >= eof) { s1 = D->nstmts; synced = 1; break; }
+            int tb = P.pos;
+            NodeId nb = D->ast.count;
+            NodeId n = parse_toplevel(&P);
+            if (!n || E.kind) break;
+            if (nn >= cn) { cn = cn ? cn*2 : 16; ns = (DocStmt*)realloc(ns, sizeof(DocStmt)*cn); }
+            DocStmt* st = &ns[nn++];
+            st->node = n; st->tb = tb; st->te = P.pos;
+            st->off = doc_tok_begin(&D->toks.data[tb]);
+            st->nb = nb; st->ne = D->ast.count;
+            for (NodeId k = nb; k < st->ne; k++) D->ast.nodes[k].pos -= st->off;
+            D->stats.reparsed++;
+            while (s1 < D->nstmts && D->stmts[s1].tb < P.pos) s1++;
+            if (s1 < D->nstmts && D->stmts[s1].tb == P.pos) { synced = 1; break; }
+        }
+        if (synced) {
+            doc_stmts_replace(D, s0, s1, ns, nn);
+            if (!all) break;
+            s = s0; c = s0 > 0 ? D->stmts[s0-1].te : 0;
+            continue;
+        }
+        // não parseou: o buraco fica; segue para os próximos
+        if (!E.kind) set_error_at(&E, ERR_PARSE, &D->src, D->toks.data[P.pos].off, "unexpected token");
+        if (ok) D->err = E;
+        ok = 0;
+        if (!all || s == D->nstmts) break;
+        c = D->stmts[s].tb;
+    }
+    free(ns);
+    return ok;
+}
+
+static int doc_rebuild(Doc* D) {
+    ast_free(&D->ast);
+    ast_init(&D->ast, &D->src, D->syms);
+    D->root = node_new(&D->ast, N_BLOCK, 0);
+    D->nstmts = 0;
+    D->stats.full = 1;
+    clear_error(&D->err);
+    lex_all(&D->src, &D->toks, &D->err);
+    D->stats.relexed = D->toks.count;
+    D->lex_ok = !D->err.kind;
+    int ok = D->lex_ok && doc_reparse(D, 0, 1);
+    D->rebuild_nodes = D->ast.count;
+    return ok;
+}
+
+/* substitui o texto inteiro */
+static int doc_set(Doc* D, const char* text, uint32_t len) {
+    if (len + 1 > D->cap) {
+        D->cap = len + 1;
+        D->text = (char*)realloc(D->text, D->cap);
+    }
+    memcpy(D->text, text, len);
+    D->text[len] = 0;
+    D->len = len;
+    doc_text_changed(D);
+    memset(&D->stats, 0, sizeof(D->stats));
+    return doc_rebuild(D);
+}
+
+/* Troca text[at, at+del) por ins[0, il). 1 se o documento inteiro parseia. */
+static int doc_edit(Doc* D, uint32_t at, uint32_t del, const char* ins, uint32_t il) {
+    if (at > D->len) at = D->len;
+    if (del > D->len - at) del = D->len - at;
+    if (D->len - del + il + 1 > D->cap) {
+        while (D->len - del + il + 1 > D->cap) D->cap *= 2;
+        D->text = (char*)realloc(D->text, D->cap);
+    }
+    memmove(D->text + at + il, D->text + at + del, D->len - at - del + 1);
+    memcpy(D->text + at, ins, il);
+    D->len = D->len - del + il;
+    doc_text_changed(D);
+    memset(&D->stats, 0, sizeof(D->stats));
+    int holes = D->err.kind != ERR_NONE; // buracos de edições anteriores
+    if (!D->lex_ok || D->ast.count > 2*D->rebuild_nodes + 4096) return doc_rebuild(D);
+
+    int32_t delta = (int32_t)il - (int32_t)del;
+    Token* T = D->toks.data;
+    int n = D->toks.count;
+
+    // primeiro token que toca a edição (o T_EOF sempre toca)
+    int lo = 0, hi = n - 1;
+    while (lo < hi) { int m = (lo + hi) / 2; if (doc_tok_end(&T[m]) >= at) hi = m; else lo = m + 1; }
+    int i0 = lo;
+    uint32_t from = doc_tok_begin(&T[i0]) < at ? doc_tok_begin(&T[i0]) : at;
+
+    TokenVec nt = { NULL, 0, 0, &D->src, D->syms };
+    Lexer L = { D->src.data, from, D->src.len, &nt };
+    Error E; clear_error(&E);
+    int j = i0, synced = 0;
+    while (lex_next(&L, &D->src, &E)) {
+        const Token* t = &nt.data[nt.count-1];
+        int64_t b = doc_tok_begin(t);
+        if (b < (int64_t)at + il) continue;
+        while (j < n-1 && (int64_t)doc_tok_begin(&T[j]) + delta < b) j++;
+        if (j < n-1 && (int64_t)doc_tok_begin(&T[j]) + delta == b && T[j].type == t->type && T[j].len == t->len) {
+            nt.count--; // é o T[j] deslocado
+            synced = 1;
+            break;
+        }
+    }
+    D->stats.relexed = nt.count + synced;
+    if (E.kind) { D->lex_ok = 0; D->err = E; tokvec_free(&nt); return 0; }
+    if (!synced) { j = n; emit(&L, T_EOF, L.i, 0); }
+
+    // tokens iguais antes da edição não contam como trocados
+    int p = 0;
+    while (p < nt.count && i0 < j && doc_tok_end(&T[i0]) <= at && nt.data[p].type == T[i0].type
+           && nt.data[p].off == T[i0].off && nt.data[p].len == T[i0].len) { p++; i0++; }
+    int k = nt.count - p, dtok = k - (j - i0);
+
+    // emenda: T[0, i0) + novos + T[j, n) deslocados
+    int count = n + dtok;
+    if (count > D->toks.cap) {
+        D->toks.cap = count + 1024;
+        D->toks.data = (Token*)realloc(D->toks.data, sizeof(Token)*D->toks.cap);
+        T = D->toks.data;
+    }
+    if (dtok) memmove(T + i0 + k, T + j, sizeof(Token)*(n - j));
+    memcpy(T + i0, nt.data + p, sizeof(Token)*k);
+    for (int i = i0 + k; i < count; i++) T[i].off = (uint32_t)((int32_t)T[i].off + delta);
+    D->toks.count = count;
+    tokvec_free(&nt);
+
+    // comandos: os que tocam [i0, j) saem (viram buraco), os seguintes são deslocados
+    // (só espaço mudou: nenhum comando sai, o que contém a edição desloca o que vem depois dela)
+    int ws = i0 == j && k == 0;
+    int w = 0, hole = -1;
+    for (int st=0; st<D->nstmts; st++) {
+        DocStmt d = D->stmts[st];
+        if (d.tb < j && d.te > i0) {
+            if (!ws) { if (hole < 0) hole = w; continue; }
+            for (NodeId q = d.nb; q < d.ne; q++)
+                if (D->ast.nodes[q].pos + d.off >= at) D->ast.nodes[q].pos = (uint32_t)((int32_t)D->ast.nodes[q].pos + delta);
+        }
+        if (d.tb >= j) {
+            if (hole < 0) hole = w;
+            d.tb += dtok; d.te += dtok; d.off = (uint32_t)((int32_t)d.off + delta);
+        }
+        D->stmts[w++] = d;
+    }
+    D->nstmts = w;
+    if (hole < 0) hole = w;
+    if (holes) { clear_error(&D->err); return doc_reparse(D, 0, 1); }
+    if (ws) return 1;
+    return doc_reparse(D, hole, 0);
+}
+
+/* Cópia da árvore para rodar, com os comandos religados sob um N_BLOCK e pos
+   de volta a offsets absolutos: program_prepare dobra e resolve no lugar, e o
+   documento continua com a árvore dele. 0 se há erro pendente. */
+static NodeId doc_snapshot(Doc* D, Ast* out) {
+    if (!doc_ok(D)) return 0;
+    ast_init(out, &D->src, D->syms);
+    free(out->nodes); free(out->lits);
+    out->nodes = (Node*)malloc(sizeof(Node)*D->ast.cap);
+    memcpy(out->nodes, D->ast.nodes, sizeof(Node)*D->ast.count);
+    out->count = D->ast.count; out->cap = D->ast.cap;
+    out->lits = (char*)malloc(D->ast.lits_cap);
+    memcpy(out->lits, D->ast.lits, D->ast.lits_len);
+    out->lits_len = D->ast.lits_len; out->lits_cap = D->ast.lits_cap;
+    for (int s=0; s<D->nstmts; s++) {
+        const DocStmt* st = &D->stmts[s];
+        for (NodeId k = st->nb; k < st->ne; k++) out->nodes[k].pos += st->off;
+        out->nodes[st->node].next = s+1 < D->nstmts ? D->stmts[s+1].node : 0;
+    }
+    out->nodes[D->root].extra = D->nstmts ? D->stmts[0].node : 0;
+    return D->root;
+}
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef IO_H
+#define IO_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+
+/* =================== Config =================== */
+#define OUT_BUF_SIZE  (1 << 16)
+#define IN_BUF_SIZE   (1 << 16)
+#ifndef OUT_FLUSH_AT
+#define OUT_FLUSH_AT  OUT_BUF_SIZE   // bytes acumulados antes do write(2); num terminal é por linha
+#endif
+
+/* =================== Entrada e saída =================== */
+/* output() e input() passam por aqui em vez de stdio: a saída acumula num buffer
+   próprio e sai em write(2) grandes; a entrada é lida do descritor em blocos e
+   entregue linha a linha. No modo interativo input() mostra o prompt e
+   descarrega a saída antes de ler. Cada interpretador tem o seu Io. */
+typedef struct {
+    int out_fd, in_fd;      // in_fd < 0: entrada vazia
+    char out[OUT_BUF_SIZE]; size_t out_len, flush_at;
+    char in[IN_BUF_SIZE];   size_t in_pos, in_len; int in_eof;
+    int interactive;
+} Io;
+
+static void io_write_all(int fd, const char* p, size_t n) {
+    while (n) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0) { if (errno == EINTR) continue; return; }
+        p += w; n -= (size_t)w;
+    }
+}
+
+static void out_flush(Io* o) {
+    io_write_all(o->out_fd, o->out, o->out_len);
+    o->out_len = 0;
+}
+
+static void io_init(Io* o, int out_fd, int in_fd, int interactive) {
+    o->out_fd = out_fd; o->in_fd = in_fd;
+    o->out_len = 0;
+    o->in_pos = o->in_len = 0; o->in_eof = in_fd < 0;
+    o->interactive = interactive;
+    o->flush_at = isatty(out_fd) ? 1 : OUT_FLUSH_AT;
+}
+
+static void out_write(Io* o, const char* p, size_t n) {
+    if (o->out_len + n > OUT_BUF_SIZE) {
+        out_flush(o);
+        if (n >= OUT_BUF_SIZE) { io_write_all(o->out_fd, p, n); return; }
+    }
+    memcpy(o->out + o->out_len, p, n);
+    o->out_len += n;
+}
+
+static void out_char(Io* o, char c) {
+    if (o->out_len == OUT_BUF_SIZE) out_flush(o);
+    o->out[o->out_len++] = c;
+}
+
+static void out_newline(Io* o) {
+    out_char(o, '\n');
+    if (o->out_len >= o->flush_at) out_flush(o);
+}
+
+/* int -> decimal, dois dígitos por vez; buf precisa de 11 bytes. Devolve o tamanho. */
+static const char g_digits2[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static int fmt_int(char* buf, int v) {
+    char tmp[12]; char* p = tmp + sizeof(tmp);
+    uint32_t u = v < 0 ? 0u - (uint32_t)v : (uint32_t)v;
+    while (u >= 100) {
+        uint32_t r = u % 100; u /= 100;
+        p -= 2; memcpy(p, g_digits2 + 2*r, 2);
+    }
+    if (u >= 10) { p -= 2; memcpy(p, g_digits2 + 2*u, 2); }
+    else *--p = (char)('0' + u);
+    if (v < 0) *--p = '-';
+    int n = (int)(tmp + sizeof(tmp) - p);
+    memcpy(buf, p, n);
+    return n;
+}
+
+static void out_int(Io* o, int v) {
+    if (o->out_len + 11 > OUT_BUF_SIZE) out_flush(o);
+    o->out_len += fmt_int(o->out + o->out_len, v);
+}
+
+/* mostra o prompt (só no modo interativo) */
+static void io_prompt(Io* o) {
+    if (!o->interactive) return;
+    out_write(o, "> ", 2);
+    out_flush(o);
+}
+
+/* 1 se o próximo in_line não vai bloquear: há uma linha inteira no buffer, a
+   entrada acabou ou o buffer encheu. Lê o que já chegou sem esperar. */
+static int in_poll(Io* o) {
+    for (;;) {
+        if (o->in_eof) return 1;
+        size_t avail = o->in_len - o->in_pos;
+        if (memchr(o->in + o->in_pos, '\n', avail)) return 1;
+        if (o->in_pos) { memmove(o->in, o->in + o->in_pos, avail); o->in_pos = 0; o->in_len = avail; }
+        if (o->in_len == IN_BUF_SIZE) return 1;
+        struct pollfd pf = { o->in_fd, POLLIN, 0 };
+        int r = poll(&pf, 1, 0);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return 0;
+        ssize_t n = read(o->in_fd, o->in + o->in_len, IN_BUF_SIZE - o->in_len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) { o->in_eof = 1; return 1; }
+        o->in_len += (size_t)n;
+    }
+}
+
+/* Como fgets: até cap-1 bytes, parando depois de '\n'; 0 se não havia nada para ler. */
+static int in_line(Io* o, char* buf, int cap) {
+    int n = 0;
+    while (n < cap-1) {
+        if (o->in_pos == o->in_len) {
+            if (o->in_eof) break;
+            ssize_t r = read(o->in_fd, o->in, IN_BUF_SIZE);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) { o->in_eof = 1; break; }
+            o->in_pos = 0; o->in_len = (size_t)r;
+        }
+        const char* p = o->in + o->in_pos;
+        size_t avail = o->in_len - o->in_pos, want = (size_t)(cap-1 - n);
+        if (avail > want) avail = want;
+        const char* nl = (const char*)memchr(p, '\n', avail);
+        size_t take = nl ? (size_t)(nl - p) + 1 : avail;
+        memcpy(buf + n, p, take);
+        n += (int)take; o->in_pos += take;
+        if (nl) break;
+    }
+    buf[n] = 0;
+    return n > 0;
+}
+
+#endif
@@ -0,0 +1,435 @@
+#ifndef JIT_H
+#define JIT_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* =================== JIT x86-64 =================== */
+/* Tier opcional para loops só de inteiros. Quando um loop passa JIT_HOT vezes
+   pelo seu BC_LOOP_CHECK, o trecho [top, end) é traduzido instrução a instrução
+   para código nativo num buffer mmap'd. As variáveis mais usadas do loop ficam
+   em registradores callee-saved durante toda a execução; as demais são lidas e
+   escritas direto no vetor de variáveis da Interp. A pilha de operandos vira a pilha da máquina.
+
+   Guard de tipo na entrada: toda variável tocada pelo loop tem que estar definida
+   e ser int; como o trecho só aceita operações sobre ints, ela continua int até a
+   saída. Divisão por zero ou combustível esgotado fazem deopt:
+   o código escreve os registradores de volta e devolve ao interpretador a última
+   instrução com a pilha vazia anterior ao ponto da falha, que é reexecutada e
+   reporta o erro como sempre.
+
+   Só Linux x86-64, sem dependências; compilar com -DSUN_NO_JIT desliga. */
+
+#if defined(__x86_64__) && defined(__linux__) && !defined(SUN_NO_JIT)
+#define SUN_JIT 1
+#endif
+
+#ifdef SUN_JIT
+#include <sys/mman.h>
+
+#define JIT_HOT       1000   // voltas até compilar
+#define JIT_HOT_REGS  5      // rbx, r12..r15
+
+typedef int32_t (*JitFn)(Var* vars, int64_t* fuel); // devolve o pc onde o interpretador continua
+
+enum { JIT_COLD, JIT_READY, JIT_FAILED };
+
+typedef struct {
+    int state;
+    uint32_t hits;
+    JitFn fn;
+    void* mem; size_t size;
+    int32_t* slots; int nslots;   // variáveis tocadas (guard de tipo na entrada)
+} JitLoop;
+
+typedef struct {
+    JitLoop* loops; int nloops;
+} Jit;
+
+static void jit_init(Jit* J, const Chunk* C) {
+    J->nloops = C->nloops;
+    J->loops = (JitLoop*)calloc(C->nloops + 1, sizeof(JitLoop));
+}
+
+static void jit_free(Jit* J) {
+    for (int i=0;i<J->nloops;i++) {
+        if (J->loops[i].mem) munmap(J->loops[i].mem, J->loops[i].size);
+        free(J->loops[i].slots);
+    }
+    free(J->loops);
+    memset(J, 0, sizeof(*J));
+}
+
+/* ---- emissão ---- */
+typedef struct { uint8_t* p; size_t n, cap; } JitBuf;
+
+static void jb_byte(JitBuf* B, uint8_t b) {
+    if (B->n >= B->cap) {
+        B->cap = B->cap ? B->cap*2 : 4096;
+        B->p = (uint8_t*)realloc(B->p, B->cap);
+    }
+    B->p[B->n++] = b;
+}
+static void jb_u32(JitBuf* B, uint32_t v) { for (int i=0;i<4;i++) jb_byte(B, (uint8_t)(v >> (8*i))); }
+static void jb_patch32(JitBuf* B, size_t at, uint32_t v) { for (int i=0;i<4;i++) B->p[at+i] = (uint8_t)(v >> (8*i)); }
+
+enum { R_AX=0, R_CX=1, R_DX=2, R_BX=3, R_SP=4, R_BP=5, R_SI=6, R_DI=7, R_12=12, R_13=13, R_14=14, R_15=15 };
+enum { CC_E=0x4, CC_NE=0x5, CC_L=0xC, CC_GE=0xD, CC_LE=0xE, CC_G=0xF };
+
+static void x_push(JitBuf* B, int r) { if (r>=8) jb_byte(B, 0x41); jb_byte(B, (uint8_t)(0x50 + (r&7))); }
+static void x_pop(JitBuf* B, int r)  { if (r>=8) jb_byte(B, 0x41); jb_byte(B, (uint8_t)(0x58 + (r&7))); }
+
+/* op r/m32, r32 (reg-reg) */
+static void x_rr(JitBuf* B, uint8_t op, int reg, int rm) {
+    if (reg>=8 || rm>=8) jb_byte(B, (uint8_t)(0x40 | ((reg>=8)<<2) | (rm>=8)));
+    jb_byte(B, op);
+    jb_byte(B, (uint8_t)(0xC0 | ((reg&7)<<3) | (rm&7)));
+}
+/* op com operando de memória [base+disp32] (base = rdi ou rsi) */
+static void x_mem(JitBuf* B, uint8_t op, int reg, int base, int32_t disp) {
+    if (reg>=8) jb_byte(B, 0x44);
+    jb_byte(B, op);
+    jb_byte(B, (uint8_t)(0x80 | ((reg&7)<<3) | base));
+    jb_u32(B, (uint32_t)disp);
+}
+/* grupo 0x81 /ext r32, imm32 */
+static void x_ri(JitBuf* B, int ext, int rm, int32_t imm) {
+    if (rm>=8) jb_byte(B, 0x41);
+    jb_byte(B, 0x81);
+    jb_byte(B, (uint8_t)(0xC0 | (ext<<3) | (rm&7)));
+    jb_u32(B, (uint32_t)imm);
+}
+static void x_setcc_eax(JitBuf* B, int cc) {
+    jb_byte(B, 0x0F); jb_byte(B, (uint8_t)(0x90 + cc)); jb_byte(B, 0xC0); // setcc al
+    jb_byte(B, 0x0F); jb_byte(B, 0xB6); jb_byte(B, 0xC0);               // movzx eax, al
+}
+/* jcc/jmp rel32; devolve onde fica o deslocamento */
+static size_t x_jcc(JitBuf* B, int cc) { jb_byte(B, 0x0F); jb_byte(B, (uint8_t)(0x80 + cc)); jb_u32(B, 0); return B->n - 4; }
+static size_t x_jmp(JitBuf* B)         { jb_byte(B, 0xE9); jb_u32(B, 0); return B->n - 4; }
+
+static int32_t var_disp(int32_t slot) {
+    return (int32_t)(slot * (int32_t)sizeof(Var) + (int32_t)offsetof(Var, val) + (int32_t)offsetof(Value, i));
+}
+
+/* ---- análise do trecho ---- */
+/* tamanho em palavras e efeito na pilha da instrução em w; 0 = fora do subconjunto de ints */
+static int jit_op_info(const int32_t* w, int* delta) {
+    switch ((BcOp)w[0]) {
+        case BC_INT: case BC_LOAD:  *delta = +1; return 2;
+        case BC_STORE:              *delta = -1; return 2;
+        case BC_POP:                *delta = -1; return 1;
+        case BC_NEG: case BC_POS: case BC_NOT: case BC_BOOL: *delta = 0; return 1;
+        case BC_ADD: case BC_SUB: case BC_MUL: case BC_DIV:
+        case BC_EQ: case BC_NE: case BC_LT: case BC_LE: case BC_GT: case BC_GE: *delta = -1; return 1;
+        case BC_JUMP:               *delta = 0;  return 2;
+        case BC_JUMP_IF_FALSE: case BC_JUMP_IF_TRUE: *delta = -1; return 2;
+        case BC_LOOP_INIT: case BC_LOOP_CHECK: *delta = 0; return 2;
+        case BC_JF_EQ: case BC_JF_NE: case BC_JF_LT: case BC_JF_LE: case BC_JF_GT: case BC_JF_GE: *delta = -2; return 2;
+        case BC_JF_EQ_VK: case BC_JF_NE_VK: case BC_JF_LT_VK: case BC_JF_LE_VK: case BC_JF_GT_VK: case BC_JF_GE_VK: *delta = 0; return 4;
+        case BC_INCR:               *delta = 0;  return 3;
+        case BC_CHECK_DEF:          *delta = 0;  return 2;
+        case BC_ADD_TO:             *delta = -w[2]; return 3;
+        default: return 0; // strings, I/O, HALT
+    }
+}
+
+/* operando de salto (índice relativo à instrução) ou -1 */
+static int jit_jump_operand(BcOp op) {
+    switch (op) {
+        case BC_JUMP: case BC_JUMP_IF_FALSE: case BC_JUMP_IF_TRUE:
+        case BC_JF_EQ: case BC_JF_NE: case BC_JF_LT: case BC_JF_LE: case BC_JF_GT: case BC_JF_GE:
+            return 1;
+        case BC_JF_EQ_VK: case BC_JF_NE_VK: case BC_JF_LT_VK: case BC_JF_LE_VK: case BC_JF_GT_VK: case BC_JF_GE_VK:
+            return 3;
+        default: return -1;
+    }
+}
+
+static int jit_slot_operand(BcOp op) {
+    switch (op) {
+        case BC_LOAD: case BC_STORE: case BC_INCR: case BC_CHECK_DEF: case BC_ADD_TO:
+        case BC_JF_EQ_VK: case BC_JF_NE_VK: case BC_JF_LT_VK: case BC_JF_LE_VK: case BC_JF_GT_VK: case BC_JF_GE_VK:
+            return 1;
+        default: return -1;
+    }
+}
+
+/* rel32 em at salta para o pc: dentro do trecho, ou (exit) devolve o pc ao interpretador */
+typedef struct { size_t at; int32_t pc; int exit; } JitFixup;
+
+typedef struct {
+    const Chunk* C;
+    int nvars;
+    int32_t top, end;
+    int32_t* depth;     // profundidade da pilha no início de cada palavra (-1 = não é início)
+    int32_t* native;    // offset nativo de cada palavra do trecho
+    int32_t hot[JIT_HOT_REGS]; int nhot;
+    JitBuf B;
+    JitFixup* fix; int nfix, cfix;
+} JitCtx;
+
+static const int jit_hot_regs[JIT_HOT_REGS] = { R_BX, R_12, R_13, R_14, R_15 };
+
+static int jit_reg_of(const JitCtx* X, int32_t slot) {
+    for (int i=0;i<X->nhot;i++) if (X->hot[i]==slot) return jit_hot_regs[i];
+    return -1;
+}
+
+static void jit_fixup(JitCtx* X, size_t at, int32_t pc, int exit) {
+    if (X->nfix >= X->cfix) {
+        X->cfix = X->cfix ? X->cfix*2 : 64;
+        X->fix = (JitFixup*)realloc(X->fix, sizeof(JitFixup)*X->cfix);
+    }
+    X->fix[X->nfix].at = at; X->fix[X->nfix].pc = pc; X->fix[X->nfix].exit = exit;
+    X->nfix++;
+}
+
+/* Valida o trecho, calcula a profundidade da pilha em cada instrução e conta o
+   uso de cada variável. Depois de um salto incondicional a profundidade vem de
+   quem salta para a próxima instrução (é assim que && e || se fecham). */
+static int jit_analyze(JitCtx* X, JitLoop* L) {
+    const int32_t* code = X->C->code;
+    int n = X->end - X->top;
+    for (int i=0;i<n;i++) X->depth[i] = -1;
+    int* uses = (int*)calloc(X->nvars + 1, sizeof(int));
+    int ok = 1, d = 0, reach = 1;
+    for (int32_t pc = X->top; pc < X->end && ok; ) {
+        BcOp op = (BcOp)code[pc];
+        int delta, len = jit_op_info(code + pc, &delta);
+        if (!len || pc + len > X->end) { ok = 0; break; }
+        int known = X->depth[pc - X->top];
+        if (!reach) { if (known < 0) { ok = 0; break; } d = known; }
+        else if (known >= 0 && known != d) { ok = 0; break; }
+        X->depth[pc - X->top] = d;
+        d += delta;
+        if (d < 0) { ok = 0; break; }
+        int js = jit_jump_operand(op);
+        if (js >= 0) {
+            int32_t t = code[pc + js];
+            if (t > X->top && t < X->end) {
+                if (t > pc) {
+                    int32_t* td = &X->depth[t - X->top];
+                    if (*td >= 0 && *td != d) ok = 0;
+                    *td = d;
+                } else if (X->depth[t - X->top] != d) ok = 0; // para trás: só ao início de instrução conhecida
+            } else if ((t != X->top && t != X->end) || d != 0) ok = 0;
+        }
+        int ss = jit_slot_operand(op);
+        if (ss >= 0) uses[code[pc + ss]]++;
+        reach = (op != BC_JUMP);
+        pc += len;
+    }
+    if (ok) {
+        L->nslots = 0;
+        L->slots = (int32_t*)malloc(sizeof(int32_t) * (X->nvars + 1));
+        for (int s=0;s<X->nvars;s++) if (uses[s]) L->slots[L->nslots++] = s;
+        // as JIT_HOT_REGS mais usadas vão para registradores
+        X->nhot = 0;
+        for (int k=0;k<JIT_HOT_REGS;k++) {
+            int best = -1;
+            for (int s=0;s<X->nvars;s++) if (uses[s] && (best < 0 || uses[s] > uses[best])) best = s;
+            if (best < 0) break;
+            X->hot[X->nhot++] = best;
+            uses[best] = 0;
+        }
+    }
+    free(uses);
+    return ok;
+}
+
+/* última instrução com a pilha vazia em [top+2, pc]: dali o interpretador refaz a conta */
+static int32_t jit_resume_pc(const JitCtx* X, int32_t pc) {
+    while (pc > X->top + 2 && X->depth[pc - X->top] != 0) pc--;
+    return pc;
+}
+
+static int jit_inside(const JitCtx* X, int32_t pc) { return pc >= X->top && pc < X->end; }
+
+static void jit_emit_insn(JitCtx* X, int32_t pc) {
+    JitBuf* B = &X->B;
+    const int32_t* w = X->C->code + pc;
+    static const int cc_of[] = { CC_E, CC_NE, CC_L, CC_LE, CC_G, CC_GE };
+    BcOp op = (BcOp)w[0];
+    switch (op) {
+        case BC_INT: jb_byte(B, 0x68); jb_u32(B, (uint32_t)w[1]); break; // push imm32
+        case BC_LOAD: {
+            int h = jit_reg_of(X, w[1]);
+            if (h >= 0) x_push(B, h);
+            else { x_mem(B, 0x8B, R_AX, R_DI, var_disp(w[1])); x_push(B, R_AX); } // mov eax, [rdi+disp]
+            break;
+        }
+        case BC_STORE: {
+            int h = jit_reg_of(X, w[1]);
+            if (h >= 0) x_pop(B, h);
+            else { x_pop(B, R_AX); x_mem(B, 0x89, R_AX, R_DI, var_disp(w[1])); }
+            break;
+        }
+        case BC_POP: x_pop(B, R_AX); break;
+        case BC_POS: break;
+        case BC_NEG:
+            x_pop(B, R_AX); jb_byte(B, 0xF7); jb_byte(B, 0xD8); x_push(B, R_AX); // neg eax
+            break;
+        case BC_NOT: case BC_BOOL:
+            x_pop(B, R_AX); x_rr(B, 0x85, R_AX, R_AX);
+            x_setcc_eax(B, op==BC_NOT ? CC_E : CC_NE);
+            x_push(B, R_AX);
+            break;
+        case BC_ADD: case BC_SUB: case BC_MUL:
+            x_pop(B, R_CX); x_pop(B, R_AX);
+            if (op==BC_ADD)      x_rr(B, 0x01, R_CX, R_AX);                // add eax, ecx
+            else if (op==BC_SUB) x_rr(B, 0x29, R_CX, R_AX);                // sub eax, ecx
+            else { jb_byte(B, 0x0F); x_rr(B, 0xAF, R_AX, R_CX); }          // imul eax, ecx
+            x_push(B, R_AX);
+            break;
+        case BC_DIV: {
+            int32_t back = jit_resume_pc(X, pc);
+            x_pop(B, R_CX); x_pop(B, R_AX);
+            x_rr(B, 0x85, R_CX, R_CX);
+            jit_fixup(X, x_jcc(B, CC_E), back, 1);                         // /0
+            // / -1 é negação (int_div): INT_MIN / -1 trapa no idiv
+            jb_byte(B, 0x83); jb_byte(B, 0xF9); jb_byte(B, 0xFF);          // cmp ecx, -1
+            jb_byte(B, 0x75); jb_byte(B, 0x04);                            // jne div
+            jb_byte(B, 0xF7); jb_byte(B, 0xD8);                            // neg eax
+            jb_byte(B, 0xEB); jb_byte(B, 0x03);                            // jmp fim
+            // div:
+            jb_byte(B, 0x99); jb_byte(B, 0xF7); jb_byte(B, 0xF9);          // cdq; idiv ecx
+            // fim:
+            x_push(B, R_AX);
+            break;
+        }
+        case BC_EQ: case BC_NE: case BC_LT: case BC_LE: case BC_GT: case BC_GE:
+            x_pop(B, R_CX); x_pop(B, R_AX);
+            x_rr(B, 0x39, R_CX, R_AX);                                     // cmp eax, ecx
+            x_setcc_eax(B, cc_of[op - BC_EQ]);
+            x_push(B, R_AX);
+            break;
+        case BC_JUMP: jit_fixup(X, x_jmp(B), w[1], !jit_inside(X, w[1])); break;
+        case BC_JUMP_IF_FALSE: case BC_JUMP_IF_TRUE:
+            x_pop(B, R_AX); x_rr(B, 0x85, R_AX, R_AX);
+            jit_fixup(X, x_jcc(B, op==BC_JUMP_IF_FALSE ? CC_E : CC_NE), w[1], !jit_inside(X, w[1]));
+            break;
+        case BC_LOOP_INIT: break;
+        case BC_LOOP_CHECK:
+            jb_byte(B, 0x48); jb_byte(B, 0x83); jb_byte(B, 0x3E); jb_byte(B, 0);                    // cmp qword [rsi], 0
+            jit_fixup(X, x_jcc(B, CC_LE), pc, 1);                                                   // esgotado: o interpretador decide
+            jb_byte(B, 0x48); jb_byte(B, 0x83); jb_byte(B, 0x2E); jb_byte(B, 1);                    // sub qword [rsi], 1
+            break;
+        case BC_JF_EQ: case BC_JF_NE: case BC_JF_LT: case BC_JF_LE: case BC_JF_GT: case BC_JF_GE:
+            x_pop(B, R_CX); x_pop(B, R_AX);
+            x_rr(B, 0x39, R_CX, R_AX);
+            jit_fixup(X, x_jcc(B, cc_of[op - BC_JF_EQ] ^ 1), w[1], !jit_inside(X, w[1]));
+            break;
+        case BC_JF_EQ_VK: case BC_JF_NE_VK: case BC_JF_LT_VK: case BC_JF_LE_VK: case BC_JF_GT_VK: case BC_JF_GE_VK: {
+            int h = jit_reg_of(X, w[1]);
+            if (h >= 0) x_ri(B, 7, h, w[2]);                                // cmp h, imm32
+            else { x_mem(B, 0x81, 7, R_DI, var_disp(w[1])); jb_u32(B, (uint32_t)w[2]); }
+            jit_fixup(X, x_jcc(B, cc_of[op - BC_JF_EQ_VK] ^ 1), w[3], !jit_inside(X, w[3]));
+            break;
+        }
+        case BC_INCR: {
+            int h = jit_reg_of(X, w[1]);
+            if (h >= 0) x_ri(B, 0, h, w[2]);                                // add h, imm32
+            else { x_mem(B, 0x81, 0, R_DI, var_disp(w[1])); jb_u32(B, (uint32_t)w[2]); }
+            break;
+        }
+        case BC_CHECK_DEF: break; // o guard de entrada já garantiu
+        case BC_ADD_TO: {
+            int h = jit_reg_of(X, w[1]);
+            for (int k=0;k<w[2];k++) {
+                x_pop(B, R_AX);
+                if (h >= 0) x_rr(B, 0x01, R_AX, h);                        // add h, eax
+                else x_mem(B, 0x01, R_AX, R_DI, var_disp(w[1]));            // add [rdi+disp], eax
+            }
+            break;
+        }
+        default: break; // jit_analyze já recusou
+    }
+}
+
+static int jit_compile(JitLoop* L, const Chunk* C, int g, int nvars) {
+    JitCtx X;
+    memset(&X, 0, sizeof(X));
+    X.C = C;
+    X.nvars = nvars;
+    X.top = C->loops[g].top;
+    X.end = C->loops[g].end;
+    int n = X.end - X.top;
+    X.depth  = (int32_t*)malloc(sizeof(int32_t) * (n + 1));
+    X.native = (int32_t*)malloc(sizeof(int32_t) * (n + 1));
+    int ok = jit_analyze(&X, L);
+    if (ok) {
+        JitBuf* B = &X.B;
+        // prólogo: salva callee-saved, fixa o frame, carrega as variáveis quentes
+        x_push(B, R_BP); x_push(B, R_BX); x_push(B, R_12); x_push(B, R_13); x_push(B, R_14); x_push(B, R_15);
+        jb_byte(B, 0x48); jb_byte(B, 0x89); jb_byte(B, 0xE5);             // mov rbp, rsp
+        for (int i=0;i<X.nhot;i++) x_mem(B, 0x8B, jit_hot_regs[i], R_DI, var_disp(X.hot[i]));
+        jit_fixup(&X, x_jmp(B), X.top + 2, 0);                             // o interpretador já fez o LOOP_CHECK
+
+        int delta;
+        for (int32_t pc = X.top; pc < X.end; pc += jit_op_info(C->code + pc, &delta)) {
+            X.native[pc - X.top] = (int32_t)B->n;
+            jit_emit_insn(&X, pc);
+        }
+
+        // saídas (fim do loop e deopts): um stub "mov eax, pc; jmp epílogo" por pc
+        int32_t* stub_pc  = (int32_t*)malloc(sizeof(int32_t) * (X.nfix + 1));
+        size_t*  stub_off = (size_t*)malloc(sizeof(size_t) * (X.nfix + 1));
+        size_t*  epi_at   = (size_t*)malloc(sizeof(size_t) * (X.nfix + 1));
+        int nstubs = 0;
+        for (int i=0;i<X.nfix;i++) {
+            int32_t t = X.fix[i].pc;
+            size_t dst;
+            if (!X.fix[i].exit) dst = (size_t)X.native[t - X.top];
+            else {
+                int k = 0;
+                while (k < nstubs && stub_pc[k] != t) k++;
+                if (k == nstubs) {
+                    stub_pc[k] = t; stub_off[k] = B->n;
+                    jb_byte(B, 0xB8); jb_u32(B, (uint32_t)t);              // mov eax, pc
+                    epi_at[nstubs++] = x_jmp(B);
+                }
+                dst = stub_off[k];
+            }
+            jb_patch32(B, X.fix[i].at, (uint32_t)(int32_t)((int64_t)dst - (int64_t)(X.fix[i].at + 4)));
+        }
+        // epílogo: devolve as variáveis quentes para o vetor de variáveis
+        for (int k=0;k<nstubs;k++) jb_patch32(B, epi_at[k], (uint32_t)(B->n - (epi_at[k] + 4)));
+        for (int i=0;i<X.nhot;i++) x_mem(B, 0x89, jit_hot_regs[i], R_DI, var_disp(X.hot[i]));
+        jb_byte(B, 0x48); jb_byte(B, 0x89); jb_byte(B, 0xEC);             // mov rsp, rbp
+        x_pop(B, R_15); x_pop(B, R_14); x_pop(B, R_13); x_pop(B, R_12); x_pop(B, R_BX); x_pop(B, R_BP);
+        jb_byte(B, 0xC3);
+        free(stub_pc); free(stub_off); free(epi_at);
+
+        size_t page = 4096, size = (B->n + page - 1) / page * page;
+        void* mem = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) ok = 0;
+        else {
+            memcpy(mem, B->p, B->n);
+            if (mprotect(mem, size, PROT_READ|PROT_EXEC) != 0) { munmap(mem, size); ok = 0; }
+            else { L->mem = mem; L->size = size; L->fn = (JitFn)mem; }
+        }
+    }
+    free(X.depth); free(X.native); free(X.fix); free(X.B.p);
+    return ok ? JIT_READY : JIT_FAILED;
+}
+
+/* chamado pelo BC_LOOP_CHECK do loop g depois de gastar a volta; devolve o pc
+   onde continuar, ou -1 para seguir interpretando */
+static int32_t jit_enter(Jit* J, const Chunk* C, int g, Var* vars, int nvars, int64_t* fuel) {
+    JitLoop* L = &J->loops[g];
+    if (L->state == JIT_COLD) {
+        if (++L->hits < JIT_HOT) return -1;
+        L->state = jit_compile(L, C, g, nvars);
+    }
+    if (L->state != JIT_READY) return -1;
+    for (int i=0;i<L->nslots;i++) {
+        const Var* v = &vars[L->slots[i]];
+        if (!v->defined || v->val.type != V_INT) return -1; // guard de tipo
+    }
+    return L->fn(vars, fuel);
+}
+
+#endif /* SUN_JIT */
+#endif
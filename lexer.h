@@ -3,13 +3,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
-#include <stdarg.h>  
+#include <stdarg.h>
+#include <errno.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 /* =================== Config =================== */
-#define MAX_TOKEN_LENGTH 128
-#define MAX_TOKENS       2048
-#define MAX_VARS         512
 #define MAX_LINE         2048
 
 /* =================== Diagnóstico =================== */
@@ -22,23 +29,259 @@ typedef struct {
     char msg[1024];
 } Error;
 
-static Error g_error = { ERR_NONE, 0, 0, "" };
+/* cada fase recebe o Error onde reportar: não há estado global */
+static void set_error_v(Error* E, ErrKind kind, int line, int col, const char* fmt, va_list ap) {
+    if (E->kind != ERR_NONE) return; // mantém o primeiro erro
+    E->kind = kind;
+    E->line = line;
+    E->col  = col;
+    vsnprintf(E->msg, sizeof(E->msg), fmt, ap);
+}
+
+static void clear_error(Error* E) { E->kind = ERR_NONE; E->line = E->col = 0; E->msg[0] = 0; }
+
+static void print_error_and_flush(const Error* E, const char* phase) {
+    fprintf(stderr, "[%s error] line %d, col %d: %s\n",
+            phase, E->line, E->col, E->msg);
+}
+
+/* =================== Varredura em bloco =================== */
+/* Cada scan_* devolve o primeiro índice em [i, len) cujo byte não pertence à
+   classe (ou len). Com AVX2/SSE2 a classe é testada 32/16 bytes por vez e o fim
+   da sequência sai de um ctz na máscara; o resto cai no laço escalar. */
+static int ch_ws(int c)    { return c==' ' || (c>='\t' && c<='\r'); }
+static int ch_digit(int c) { return c>='0' && c<='9'; }
+static int ch_ident(int c) { return ((c|0x20)>='a' && (c|0x20)<='z') || ch_digit(c) || c=='_'; }
+static int ch_strend(int c){ return c=='"' || c=='\\' || c==0; }
+
+#if defined(__AVX2__)
+#define LEX_W 32
+typedef __m256i lexvec;
+static lexvec   lv_load(const char* p)        { return _mm256_loadu_si256((const __m256i*)p); }
+static lexvec   lv_set(char c)                { return _mm256_set1_epi8(c); }
+static lexvec   lv_eq(lexvec a, lexvec b)     { return _mm256_cmpeq_epi8(a, b); }
+static lexvec   lv_gt(lexvec a, lexvec b)     { return _mm256_cmpgt_epi8(a, b); }
+static lexvec   lv_and(lexvec a, lexvec b)    { return _mm256_and_si256(a, b); }
+static lexvec   lv_or(lexvec a, lexvec b)     { return _mm256_or_si256(a, b); }
+static uint32_t lv_mask(lexvec a)             { return (uint32_t)_mm256_movemask_epi8(a); }
+#define LEX_FULL 0xFFFFFFFFu
+#elif defined(__SSE2__)
+#define LEX_W 16
+typedef __m128i lexvec;
+static lexvec   lv_load(const char* p)        { return _mm_loadu_si128((const __m128i*)p); }
+static lexvec   lv_set(char c)                { return _mm_set1_epi8(c); }
+static lexvec   lv_eq(lexvec a, lexvec b)     { return _mm_cmpeq_epi8(a, b); }
+static lexvec   lv_gt(lexvec a, lexvec b)     { return _mm_cmpgt_epi8(a, b); }
+static lexvec   lv_and(lexvec a, lexvec b)    { return _mm_and_si128(a, b); }
+static lexvec   lv_or(lexvec a, lexvec b)     { return _mm_or_si128(a, b); }
+static uint32_t lv_mask(lexvec a)             { return (uint32_t)_mm_movemask_epi8(a); }
+#define LEX_FULL 0xFFFFu
+#endif
+
+#ifdef LEX_W
+/* lo <= x <= hi (comparação com sinal: bytes >= 0x80 nunca entram em faixas ASCII) */
+static lexvec lv_range(lexvec x, char lo, char hi) {
+    return lv_and(lv_gt(x, lv_set((char)(lo-1))), lv_gt(lv_set((char)(hi+1)), x));
+}
+static uint32_t lv_ws(lexvec x)    { return lv_mask(lv_or(lv_eq(x, lv_set(' ')), lv_range(x, '\t', '\r'))); }
+static uint32_t lv_digit(lexvec x) { return lv_mask(lv_range(x, '0', '9')); }
+static uint32_t lv_ident(lexvec x) {
+    lexvec lower = lv_or(x, lv_set(0x20));
+    return lv_mask(lv_or(lv_or(lv_range(lower, 'a', 'z'), lv_range(x, '0', '9')), lv_eq(x, lv_set('_'))));
+}
+static uint32_t lv_strend(lexvec x) {
+    return lv_mask(lv_or(lv_or(lv_eq(x, lv_set('"')), lv_eq(x, lv_set('\\'))), lv_eq(x, lv_set(0))));
+}
+#define LEX_SCAN_BLOCKS(p, i, len, maskfn, want_in)                          \
+    for (; (i) + LEX_W <= (len); (i) += LEX_W) {                             \
+        uint32_t m = maskfn(lv_load((p) + (i)));                             \
+        if (!(want_in)) m = ~m & LEX_FULL;                                   \
+        if (m != LEX_FULL) return (i) + (uint32_t)__builtin_ctz(~m);         \
+    }
+#else
+#define LEX_SCAN_BLOCKS(p, i, len, maskfn, want_in)
+#endif
+
+static uint32_t scan_ws(const char* p, uint32_t i, uint32_t len) {
+    LEX_SCAN_BLOCKS(p, i, len, lv_ws, 1)
+    while (i < len && ch_ws((unsigned char)p[i])) i++;
+    return i;
+}
+static uint32_t scan_digits(const char* p, uint32_t i, uint32_t len) {
+    LEX_SCAN_BLOCKS(p, i, len, lv_digit, 1)
+    while (i < len && ch_digit((unsigned char)p[i])) i++;
+    return i;
+}
+static uint32_t scan_ident(const char* p, uint32_t i, uint32_t len) {
+    LEX_SCAN_BLOCKS(p, i, len, lv_ident, 1)
+    while (i < len && ch_ident((unsigned char)p[i])) i++;
+    return i;
+}
+/* corpo de string: para em '"', '\\' ou '\0' */
+static uint32_t scan_strbody(const char* p, uint32_t i, uint32_t len) {
+    LEX_SCAN_BLOCKS(p, i, len, lv_strend, 0)
+    while (i < len && !ch_strend((unsigned char)p[i])) i++;
+    return i;
+}
+
+/* =================== Fonte =================== */
+/* Buffer do programa (mapeado do arquivo ou emprestado de uma string), sem
+   terminador obrigatório. Linha/coluna só são calculadas quando alguém pede,
+   por busca binária num índice de inícios de linha montado na primeira consulta. */
+typedef struct {
+    const char* data;
+    uint32_t len;
+    int mapped;
+    uint32_t* lines; uint32_t nlines; // offsets de início de linha (preguiçoso)
+} Source;
+
+static void source_from_string(Source* S, const char* s) {
+    memset(S, 0, sizeof(*S));
+    S->data = s;
+    S->len  = (uint32_t)strlen(s);
+}
+
+/* mapeia o arquivo inteiro (somente leitura); 0 em falha, com errno. Offsets
+   são de 32 bits: arquivo maior que isso falha com EFBIG */
+static int source_open(Source* S, const char* path) {
+    memset(S, 0, sizeof(*S));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) < 0) { close(fd); return 0; }
+    if ((uint64_t)st.st_size > UINT32_MAX) { close(fd); errno = EFBIG; return 0; }
+    S->len = (uint32_t)st.st_size;
+    if (S->len == 0) { close(fd); S->data = ""; return 1; }
+    void* p = mmap(NULL, S->len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return 0;
+    S->data = (const char*)p;
+    S->mapped = 1;
+    return 1;
+}
+
+/* complemento de "cannot open '%s'" para o errno de source_open */
+static inline const char* source_open_why(int err) { return err == EFBIG ? ": file larger than 4 GiB" : ""; }
+
+static void source_close(Source* S) {
+    if (S->mapped) munmap((void*)S->data, S->len);
+    free(S->lines);
+    memset(S, 0, sizeof(*S));
+}
+
+/* duas passadas: conta os '\n' (popcount por bloco) para alocar o índice exato,
+   depois extrai as posições bit a bit */
+static void source_index_lines(Source* S) {
+    const char* p = S->data;
+    uint32_t len = S->len, i = 0, n = 1;
+#ifdef LEX_W
+    for (; i + LEX_W <= len; i += LEX_W) n += (uint32_t)__builtin_popcount(lv_mask(lv_eq(lv_load(p+i), lv_set('\n'))));
+#endif
+    for (; i < len; i++) n += p[i]=='\n';
+
+    S->lines = (uint32_t*)malloc(sizeof(uint32_t)*n);
+    S->lines[0] = 0; S->nlines = 1;
+    i = 0;
+#ifdef LEX_W
+    for (; i + LEX_W <= len; i += LEX_W) {
+        uint32_t m = lv_mask(lv_eq(lv_load(p+i), lv_set('\n')));
+        while (m) { S->lines[S->nlines++] = i + (uint32_t)__builtin_ctz(m) + 1; m &= m-1; }
+    }
+#endif
+    for (; i < len; i++) if (p[i]=='\n') S->lines[S->nlines++] = i + 1;
+}
+
+static void source_linecol(Source* S, uint32_t off, int* line, int* col) {
+    if (!S->lines) source_index_lines(S);
+    uint32_t lo = 0, hi = S->nlines;
+    while (hi - lo > 1) {
+        uint32_t mid = (lo + hi) / 2;
+        if (S->lines[mid] <= off) lo = mid; else hi = mid;
+    }
+    *line = (int)lo + 1;
+    *col  = (int)(off - S->lines[lo]) + 1;
+}
 
-static void set_error(ErrKind kind, int line, int col, const char* fmt, ...) {
-    if (g_error.kind != ERR_NONE) return; // mantém o primeiro erro
-    g_error.kind = kind;
-    g_error.line = line;
-    g_error.col  = col;
+/* como set_error, mas com a posição dada por offset no fonte */
+static void set_error_at(Error* E, ErrKind kind, Source* S, uint32_t off, const char* fmt, ...) {
+    if (E->kind != ERR_NONE) return;
+    int line, col;
+    source_linecol(S, off, &line, &col);
     va_list ap; va_start(ap, fmt);
-    vsnprintf(g_error.msg, sizeof(g_error.msg), fmt, ap);
+    set_error_v(E, kind, line, col, fmt, ap);
     va_end(ap);
 }
 
-static void clear_error(void) { g_error.kind = ERR_NONE; g_error.msg[0] = 0; }
+/* =================== Símbolos =================== */
+/* Cada identificador distinto recebe um id denso (0, 1, 2, ...) na primeira vez
+   que aparece; daí em diante parser e VM só comparam ids. */
+static unsigned hash_bytes(const char* p, int len) {
+    unsigned h = 2166136261u;
+    for (int i=0;i<len;i++) { h ^= (unsigned char)p[i]; h *= 16777619u; }
+    return h;
+}
 
-static void print_error_and_flush(const char* phase) {
-    fprintf(stderr, "[%s error] line %d, col %d: %s\n",
-            phase, g_error.line, g_error.col, g_error.msg);
+typedef struct {
+    char* names; uint32_t names_len, names_cap; // nomes terminados em 0
+    uint32_t* off; uint32_t count, cap;         // id -> offset em names
+    uint32_t* index; uint32_t index_cap;        // hash aberto: id+1
+} SymTab;
+
+static void symtab_init(SymTab* T) { memset(T, 0, sizeof(*T)); }
+
+static void symtab_free(SymTab* T) {
+    free(T->names); free(T->off); free(T->index);
+    memset(T, 0, sizeof(*T));
+}
+
+static const char* sym_name(const SymTab* T, uint32_t id) { return T->names + T->off[id]; }
+
+static int sym_same(const SymTab* T, uint32_t id, const char* p, uint32_t len) {
+    const char* n = T->names + T->off[id];
+    return memcmp(n, p, len)==0 && n[len]==0;
+}
+
+static void sym_index_put(SymTab* T, uint32_t id, unsigned h) {
+    uint32_t i = h & (T->index_cap-1);
+    while (T->index[i]) i = (i+1) & (T->index_cap-1);
+    T->index[i] = id + 1;
+}
+
+/* id do símbolo, ou -1 se nunca visto */
+static int sym_lookup(const SymTab* T, const char* p, uint32_t len) {
+    if (!T->index_cap) return -1;
+    for (uint32_t i = hash_bytes(p, (int)len) & (T->index_cap-1); T->index[i]; i = (i+1) & (T->index_cap-1))
+        if (sym_same(T, T->index[i]-1, p, len)) return (int)T->index[i]-1;
+    return -1;
+}
+
+static uint32_t sym_intern(SymTab* T, const char* p, uint32_t len) {
+    int found = sym_lookup(T, p, len);
+    if (found >= 0) return (uint32_t)found;
+    if ((T->count+1)*2 > T->index_cap) {
+        free(T->index);
+        T->index_cap = T->index_cap ? T->index_cap*2 : 256;
+        T->index = (uint32_t*)calloc(T->index_cap, sizeof(uint32_t));
+        for (uint32_t id=0; id<T->count; id++) {
+            const char* n = sym_name(T, id);
+            sym_index_put(T, id, hash_bytes(n, (int)strlen(n)));
+        }
+    }
+    if (T->count >= T->cap) {
+        T->cap = T->cap ? T->cap*2 : 256;
+        T->off = (uint32_t*)realloc(T->off, sizeof(uint32_t)*T->cap);
+    }
+    while (T->names_len + len + 1 > T->names_cap) {
+        T->names_cap = T->names_cap ? T->names_cap*2 : 4096;
+        T->names = (char*)realloc(T->names, T->names_cap);
+    }
+    uint32_t id = T->count++;
+    T->off[id] = T->names_len;
+    memcpy(T->names + T->names_len, p, len);
+    T->names[T->names_len + len] = 0;
+    T->names_len += len + 1;
+    sym_index_put(T, id, hash_bytes(p, (int)len));
+    return id;
 }
 
 /* =================== Tokens =================== */
@@ -56,182 +299,213 @@ typedef enum {
     T_LT, T_LE, T_GT, T_GE, // < <= > >=
     T_LPAREN, T_RPAREN,  // ( )
     T_LBRACE, T_RBRACE,  // { }
-    T_SEMI, T_COMMA,     // ; ,
+    T_LBRACKET, T_RBRACKET, // [ ]
+    T_SEMI, T_COMMA, T_COLON, // ; , :
 
     // lógicos
     T_AND, T_OR, T_NOT,  // && || !
 
     // palavras-chave
-    T_KW_IF, T_KW_ELSE, T_KW_WHILE, T_KW_PRINT, T_KW_INPUT
+    T_KW_IF, T_KW_ELSE, T_KW_WHILE, T_KW_PRINT, T_KW_INPUT, T_KW_FUNC, T_KW_RETURN
 } TokenType;
 
+/* o texto do token é Source.data[off .. off+len); strings excluem as aspas
+   e mantêm os escapes crus (ver lex_unescape). Identificadores trazem o id
+   do símbolo em sym. */
 typedef struct {
     TokenType type;
-    char lexeme[MAX_TOKEN_LENGTH];
-    int line;
-    int col;
+    uint32_t off;
+    uint32_t len;
+    uint32_t sym;
 } Token;
 
 typedef struct {
-    Token data[MAX_TOKENS];
-    int count;
+    Token* data;
+    int count, cap;
+    Source* src;
+    SymTab* syms;   // fornecida por quem chama; pode durar mais que os tokens
 } TokenVec;
 
+static void tokvec_free(TokenVec* v) { free(v->data); memset(v, 0, sizeof(*v)); }
+
+static const char* tok_text(const Source* S, const Token* t) { return S->data + t->off; }
+
 /* =================== Lexer =================== */
 typedef struct {
     const char* src;
-    int i;
-    int line;
-    int col;
+    uint32_t i;
+    uint32_t len;
     TokenVec* out;
 } Lexer;
 
-static int lex_peek(Lexer* L) { return L->src[L->i]; }
-static int lex_peek2(Lexer* L) { return L->src[L->i+1]; }
-static int lex_advance(Lexer* L) {
-    int c = L->src[L->i++];
-    if (c == '\n') { L->line++; L->col = 1; } else { L->col++; }
-    return c;
-}
-static void emit(Lexer* L, TokenType t, const char* lex, int line, int col) {
-    if (L->out->count >= MAX_TOKENS) {
-        set_error(ERR_LEX, line, col, "token buffer overflow");
-        return;
+static int lex_peek(Lexer* L) { return L->i < L->len ? (unsigned char)L->src[L->i] : 0; }
+static int lex_advance(Lexer* L) { return (unsigned char)L->src[L->i++]; }
+
+static Token* emit(Lexer* L, TokenType t, uint32_t off, uint32_t len) {
+    TokenVec* v = L->out;
+    if (v->count >= v->cap) {
+        v->cap = v->cap ? v->cap*2 : 1024;
+        v->data = (Token*)realloc(v->data, sizeof(Token)*v->cap);
     }
-    Token* tk = &L->out->data[L->out->count++];
+    Token* tk = &v->data[v->count++];
     tk->type = t;
-    tk->line = line;
-    tk->col  = col;
-    if (lex) strncpy(tk->lexeme, lex, MAX_TOKEN_LENGTH-1), tk->lexeme[MAX_TOKEN_LENGTH-1]=0;
-    else tk->lexeme[0]=0;
+    tk->off  = off;
+    tk->len  = len;
+    tk->sym  = 0;
+    return tk;
 }
 
-static int is_ident_start(int c){ return isalpha(c) || c=='_'; }
-static int is_ident_part (int c){ return isalnum(c) || c=='_'; }
+static int is_ident_start(int c){ return ((c|0x20)>='a' && (c|0x20)<='z') || c=='_'; } // ASCII, como ch_ident: não depende do locale
 
 static int match(Lexer* L, int expected) {
     if (lex_peek(L) == expected) { lex_advance(L); return 1; }
     return 0;
 }
 
-static void lex_all(const char* src, TokenVec* out) {
-    Lexer L = { src, 0, 1, 1, out };
-    out->count = 0;
-    clear_error();
+/* palavras-chave: despacho por tamanho e primeira letra, sem strcmp em cadeia */
+static TokenType keyword_type(const char* w, uint32_t n) {
+    switch (n) {
+        case 2: if (w[0]=='i' && w[1]=='f') return T_KW_IF; break;
+        case 4:
+            if (w[0]=='e') { if (memcmp(w+1,"lse",3)==0) return T_KW_ELSE; }
+            else if (w[0]=='l') { if (memcmp(w+1,"oop",3)==0) return T_KW_WHILE; }
+            else if (w[0]=='f') { if (memcmp(w+1,"unc",3)==0) return T_KW_FUNC; }
+            break;
+        case 5: if (w[0]=='i' && memcmp(w+1,"nput",4)==0) return T_KW_INPUT; break;
+        case 6:
+            if (w[0]=='o') { if (memcmp(w+1,"utput",5)==0) return T_KW_PRINT; }
+            else if (w[0]=='r') { if (memcmp(w+1,"eturn",5)==0) return T_KW_RETURN; }
+            break;
+    }
+    return T_IDENTIFIER;
+}
 
-    while (lex_peek(&L)) {
-        int c = lex_peek(&L);
-        if (isspace(c)) { lex_advance(&L); continue; }
+/* decodifica os escapes de um literal de string; devolve o tamanho escrito em out */
+static uint32_t lex_unescape(const char* p, uint32_t len, char* out) {
+    uint32_t j = 0;
+    for (uint32_t i=0;i<len;i++) {
+        char ch = p[i];
+        if (ch=='\\' && i+1<len) {
+            ch = p[++i];
+            if      (ch=='n') ch='\n';
+            else if (ch=='t') ch='\t';
+            else if (ch=='r') ch='\r';
+            // caso contrário, mantém o char
+        }
+        out[j++] = ch;
+    }
+    return j;
+}
+
+/* Um token a partir de L->i (pula os espaços antes). 1 se emitiu, 0 no fim do
+   fonte ou em erro (E preenchido). Entre tokens o lexer não guarda estado, então
+   pode recomeçar em qualquer início de token (ver incr.h). */
+static int lex_next(Lexer* L, Source* S, Error* E) {
+    while (lex_peek(L)) {
+        int c = lex_peek(L);
+        if (ch_ws(c)) { L->i = scan_ws(L->src, L->i, L->len); continue; }
 
-        int line = L.line, col = L.col;
+        uint32_t start = L->i;
 
         // números
-        if (isdigit(c)) {
-            char buf[MAX_TOKEN_LENGTH]; int j=0;
-            while (isdigit(lex_peek(&L))) {
-                if (j < MAX_TOKEN_LENGTH-1) buf[j++] = lex_advance(&L); else lex_advance(&L);
-            }
-            buf[j]=0;
-            emit(&L, T_NUMBER, buf, line, col);
-            if (g_error.kind) return;
-            continue;
+        if (ch_digit(c)) {
+            L->i = scan_digits(L->src, L->i, L->len);
+            emit(L, T_NUMBER, start, L->i - start);
+            return 1;
         }
 
         // identificadores / palavras-chave
         if (is_ident_start(c)) {
-            char buf[MAX_TOKEN_LENGTH]; int j=0;
-            while (is_ident_part(lex_peek(&L))) {
-                if (j < MAX_TOKEN_LENGTH-1) buf[j++] = lex_advance(&L); else lex_advance(&L);
-            }
-            buf[j]=0;
-            TokenType t = T_IDENTIFIER;
-            if      (strcmp(buf,"if")==0)    t=T_KW_IF;
-            else if (strcmp(buf,"else")==0)  t=T_KW_ELSE;
-            else if (strcmp(buf,"loop")==0) t=T_KW_WHILE;
-            else if (strcmp(buf,"output")==0) t=T_KW_PRINT;
-            else if (strcmp(buf,"input")==0) t=T_KW_INPUT;
-            emit(&L, t, buf, line, col);
-            if (g_error.kind) return;
-            continue;
+            L->i = scan_ident(L->src, L->i, L->len);
+            const char* w = S->data + start; uint32_t n = L->i - start;
+            TokenType t = keyword_type(w, n);
+            Token* tk = emit(L, t, start, n);
+            if (t == T_IDENTIFIER) tk->sym = sym_intern(L->out->syms, w, n);
+            return 1;
         }
 
-        // strings
+        // strings: o token cobre só o conteúdo entre as aspas
         if (c=='"') {
-            lex_advance(&L);
-            char buf[512]; int j=0;
-            int escaped = 0;
-            while (lex_peek(&L)) {
-                int ch = lex_advance(&L);
-                if (!escaped && ch=='"') break;
-                if (!escaped && ch=='\\') { escaped=1; continue; }
-                if (escaped) {
-                    if      (ch=='n') ch='\n';
-                    else if (ch=='t') ch='\t';
-                    else if (ch=='r') ch='\r';
-                    // caso contrário, mantém o char
-                    escaped=0;
-                }
-                if (j< (int)sizeof(buf)-1) buf[j++]= (char)ch;
+            lex_advance(L);
+            int closed = 0;
+            for (;;) {
+                L->i = scan_strbody(L->src, L->i, L->len);
+                int ch = lex_peek(L);
+                if (!ch) break;
+                lex_advance(L);
+                if (ch=='"') { closed = 1; break; }
+                if (lex_peek(L)) lex_advance(L); // '\\' + char escapado
             }
-            if (L.src[L.i-1] != '"') {
-                set_error(ERR_LEX, line, col, "string no closure");
-                return;
+            if (!closed) {
+                set_error_at(E, ERR_LEX, S, start, "string no closure");
+                return 0;
             }
-            buf[j]=0;
-            emit(&L, T_STRING, buf, line, col);
-            if (g_error.kind) return;
-            continue;
+            emit(L, T_STRING, start+1, L->i - start - 2);
+            return 1;
         }
 
         // operadores e pontuação
         switch (c) {
-            case '+': lex_advance(&L); emit(&L, T_PLUS, "+", line, col); break;
-            case '-': lex_advance(&L); emit(&L, T_MINUS,"-", line, col); break;
-            case '*': lex_advance(&L); emit(&L, T_STAR, "*", line, col); break;
-            case '/': lex_advance(&L); emit(&L, T_SLASH,"/", line, col); break;
+            case '+': lex_advance(L); emit(L, T_PLUS,  start, 1); break;
+            case '-': lex_advance(L); emit(L, T_MINUS, start, 1); break;
+            case '*': lex_advance(L); emit(L, T_STAR,  start, 1); break;
+            case '/': lex_advance(L); emit(L, T_SLASH, start, 1); break;
             case '!':
-                lex_advance(&L);
-                if (match(&L,'=')) emit(&L, T_NE, "!=", line, col);
-                else emit(&L, T_NOT, "!", line, col);
+                lex_advance(L);
+                if (match(L,'=')) emit(L, T_NE, start, 2);
+                else emit(L, T_NOT, start, 1);
                 break;
             case '=':
-                lex_advance(&L);
-                if (match(&L,'=')) emit(&L, T_EQ, "==", line, col);
-                else emit(&L, T_ASSIGN, "=", line, col);
+                lex_advance(L);
+                if (match(L,'=')) emit(L, T_EQ, start, 2);
+                else emit(L, T_ASSIGN, start, 1);
                 break;
             case '<':
-                lex_advance(&L);
-                if (match(&L,'=')) emit(&L, T_LE, "<=", line, col);
-                else emit(&L, T_LT, "<", line, col);
+                lex_advance(L);
+                if (match(L,'=')) emit(L, T_LE, start, 2);
+                else emit(L, T_LT, start, 1);
                 break;
             case '>':
-                lex_advance(&L);
-                if (match(&L,'=')) emit(&L, T_GE, ">=", line, col);
-                else emit(&L, T_GT, ">", line, col);
+                lex_advance(L);
+                if (match(L,'=')) emit(L, T_GE, start, 2);
+                else emit(L, T_GT, start, 1);
                 break;
             case '&':
-                lex_advance(&L);
-                if (match(&L,'&')) emit(&L, T_AND, "&&", line, col);
-                else { set_error(ERR_LEX, line, col, "expected '&' to '&&'"); return; }
+                lex_advance(L);
+                if (match(L,'&')) emit(L, T_AND, start, 2);
+                else { set_error_at(E, ERR_LEX, S, start, "expected '&' to '&&'"); return 0; }
                 break;
             case '|':
-                lex_advance(&L);
-                if (match(&L,'|')) emit(&L, T_OR, "||", line, col);
-                else { set_error(ERR_LEX, line, col, "expected'|' to'||'"); return; }
+                lex_advance(L);
+                if (match(L,'|')) emit(L, T_OR, start, 2);
+                else { set_error_at(E, ERR_LEX, S, start, "expected'|' to'||'"); return 0; }
                 break;
-            case '(': lex_advance(&L); emit(&L, T_LPAREN,"(", line, col); break;
-            case ')': lex_advance(&L); emit(&L, T_RPAREN,")", line, col); break;
-            case '{': lex_advance(&L); emit(&L, T_LBRACE,"{", line, col); break;
-            case '}': lex_advance(&L); emit(&L, T_RBRACE,"}", line, col); break;
-            case ';': lex_advance(&L); emit(&L, T_SEMI,  ";", line, col); break;
-            case ',': lex_advance(&L); emit(&L, T_COMMA, ",", line, col); break;
+            case '(': lex_advance(L); emit(L, T_LPAREN, start, 1); break;
+            case ')': lex_advance(L); emit(L, T_RPAREN, start, 1); break;
+            case '{': lex_advance(L); emit(L, T_LBRACE, start, 1); break;
+            case '}': lex_advance(L); emit(L, T_RBRACE, start, 1); break;
+            case '[': lex_advance(L); emit(L, T_LBRACKET, start, 1); break;
+            case ']': lex_advance(L); emit(L, T_RBRACKET, start, 1); break;
+            case ';': lex_advance(L); emit(L, T_SEMI,   start, 1); break;
+            case ',': lex_advance(L); emit(L, T_COMMA,  start, 1); break;
+            case ':': lex_advance(L); emit(L, T_COLON,  start, 1); break;
             default:
-                set_error(ERR_LEX, line, col, "unknown caracter'%c'", c);
-                return;
+                set_error_at(E, ERR_LEX, S, start, "unknown caracter'%c'", c);
+                return 0;
         }
-        if (g_error.kind) return;
+        return 1;
     }
-    emit(&L, T_EOF, "", L.line, L.col);
+    return 0;
+}
+
+static void lex_all(Source* S, TokenVec* out, Error* E) {
+    Lexer L = { S->data, 0, S->len, out };
+    out->count = 0;
+    out->src = S;
+    clear_error(E);
+    while (lex_next(&L, S, E)) {}
+    if (E->kind) return;
+    emit(&L, T_EOF, L.i, 0); // um '\0' no meio encerra o fonte, como antes
 }
 
 #endif
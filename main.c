@@ -0,0 +1,187 @@
+#include "lexer.h"
+#include "io.h"
+#include "parser.h"
+#include "opt.h"
+#include "vec.h"
+#include "vm.h"
+#include "compiler.h"
+#include "jit.h"
+#include "cache.h"
+#include "prof.h"
+#include "exec.h"
+#include "sched.h"
+#include "incr.h"
+#include "repl.h"
+#include "pool.h"
+#include "batch.h"
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+        "usage: %s [--tree | --no-jit] [--no-cache] [--fuel N] [--batch] [--profile] [--flame out.folded] script.sm\n"
+        "       %s [--tree | --no-jit] [--no-cache] [--fuel N] [--jobs N | --slice N] script.sm...\n"
+        "       %s [--tree | --no-jit] [--no-cache] [--fuel N] [--jobs N | --slice N] --inputs script.sm input...\n"
+        "       %s [--tree | --no-jit] [--fuel N] [--batch] --repl [script.sm]\n"
+        "       %s --compile [--jobs N] (dir | @list | script.sm)...\n"
+        "--fuel N: at most N loop iterations per run (0: no limit); --slice N: one thread, N per turn\n"
+        "--compile: check every script and write its .smc without running it\n",
+        argv0, argv0, argv0, argv0, argv0);
+}
+
+/* Lote: cada script (ou cada entrada de --inputs) roda numa thread do pool e
+   escreve em <arquivo>.out. Com slice > 0 rodam todos nesta thread, em fatias.
+   Os erros saem na ordem da linha de comando. */
+static int run_batch(const char** paths, int npaths, ExecMode mode, int cache, int nthreads, int inputs,
+                     int64_t fuel, int64_t slice) {
+    Unit shared;
+    Error err;
+    const char* phase = "";
+    if (inputs) {
+        if (npaths < 2) { fprintf(stderr, "--inputs needs a script and at least one input\n"); return 2; }
+        if (!unit_load(&shared, paths[0], mode, cache, &err, &phase)) {
+            int rc = err.kind ? 1 : 2;
+            if (rc == 2) fprintf(stderr, "cannot open '%s'%s\n", paths[0], source_open_why(errno));
+            else { fprintf(stderr, "%s: ", paths[0]); print_error_and_flush(&err, phase); }
+            unit_free(&shared);
+            return rc;
+        }
+        paths++; npaths--;
+    }
+    if (nthreads <= 0) nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    BatchJob* jobs = (BatchJob*)calloc(npaths, sizeof(BatchJob));
+    for (int i=0;i<npaths;i++) {
+        size_t n = strlen(paths[i]);
+        char* out = (char*)malloc(n + 5);
+        memcpy(out, paths[i], n); memcpy(out + n, ".out", 5);
+        jobs[i].mode = mode;
+        jobs[i].cache = cache;
+        jobs[i].fuel = fuel;
+        jobs[i].out_path = out;
+        if (inputs) { jobs[i].shared = &shared.prog; jobs[i].in_path = paths[i]; }
+        else jobs[i].script = paths[i];
+    }
+    if (slice > 0) batch_run_sliced(jobs, npaths, slice);
+    else batch_run(jobs, npaths, nthreads);
+
+    int rc = 0;
+    for (int i=0;i<npaths;i++) {
+        BatchJob* J = &jobs[i];
+        if (J->rc == 2) fprintf(stderr, "%s: cannot open '%s'%s\n", paths[i], J->bad_path, source_open_why(J->bad_errno));
+        else if (J->rc == 1) { fprintf(stderr, "%s: ", paths[i]); print_error_and_flush(&J->err, J->phase); }
+        if (J->rc > rc) rc = J->rc;
+        free((char*)J->out_path);
+    }
+    free(jobs);
+    if (inputs) unit_free(&shared);
+    return rc;
+}
+
+/* Compilação: os fontes dos argumentos (batch.h, paths_gather) no pool, sem
+   rodar. Os diagnósticos saem na ordem dos caminhos e as contas em stdout. */
+static int run_compile(const char** args, int nargs, int nthreads) {
+    PathList L = { NULL, 0, 0 };
+    int rc = 0;
+    for (int i=0;i<nargs;i++)
+        if (!paths_gather(&L, args[i])) { fprintf(stderr, "cannot open '%s'\n", args[i]); rc = 2; }
+    if (nthreads <= 0) nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    CompileJob* jobs = (CompileJob*)calloc(L.n ? L.n : 1, sizeof(CompileJob));
+    for (int i=0;i<L.n;i++) jobs[i].path = L.v[i];
+    compile_run(jobs, L.n, nthreads);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    int fresh = 0, failed = 0;
+    for (int i=0;i<L.n;i++) {
+        CompileJob* J = &jobs[i];
+        if (J->diag) { fputs(J->diag, stderr); free(J->diag); }
+        fresh += J->fresh;
+        failed += J->rc != 0;
+        if (J->rc > rc) rc = J->rc;
+    }
+    printf("%d scripts: %d compiled, %d up to date, %d failed (%.1f ms)\n", L.n, L.n - fresh - failed, fresh, failed,
+           (double)(t1.tv_sec - t0.tv_sec) * 1e3 + (double)(t1.tv_nsec - t0.tv_nsec) / 1e6);
+    free(jobs);
+    paths_free(&L);
+    return rc;
+}
+
+int main(int argc, char** argv) {
+    const char** paths = (const char**)malloc(sizeof(char*) * argc);
+    int npaths = 0;
+    ExecMode mode = EXEC_BYTECODE;
+    int interactive = 1, cache = 1, nthreads = 0, batch = 0, inputs = 0, profile = 0, repl = 0, compile = 0;
+    int64_t fuel = FUEL_DEFAULT, slice = 0;
+    const char* flame = NULL;
+    for (int i=1;i<argc;i++) {
+        if (strcmp(argv[i], "--tree")==0) mode = EXEC_TREE;
+        else if (strcmp(argv[i], "--no-jit")==0) mode = EXEC_INTERP;
+        else if (strcmp(argv[i], "--no-cache")==0) cache = 0; // nem lê nem grava o .smc
+        else if (strcmp(argv[i], "--batch")==0) interactive = 0; // sem prompt em input()
+        else if (strcmp(argv[i], "--jobs")==0 && i+1 < argc) { nthreads = atoi(argv[++i]); batch = 1; }
+        else if (strcmp(argv[i], "--slice")==0 && i+1 < argc) { slice = atoll(argv[++i]); batch = 1; }
+        else if (strcmp(argv[i], "--inputs")==0) inputs = batch = 1;
+        else if (strcmp(argv[i], "--fuel")==0 && i+1 < argc) { fuel = atoll(argv[++i]); if (fuel <= 0) fuel = -1; }
+        else if (strcmp(argv[i], "--profile")==0) profile = 1; // relatório em stderr no fim
+        else if (strcmp(argv[i], "--repl")==0) repl = 1; // sessão interativa (repl.h)
+        else if (strcmp(argv[i], "--flame")==0 && i+1 < argc) { flame = argv[++i]; profile = 1; }
+        else if (strcmp(argv[i], "--compile")==0) compile = 1; // só valida e grava os .smc
+        else paths[npaths++] = argv[i];
+    }
+    if (repl && !profile && !batch && !compile && npaths <= 1) {
+        int rc = repl_run(mode, interactive, fuel, npaths ? paths[0] : NULL);
+        free(paths);
+        return rc;
+    }
+    if (!npaths || repl || (compile && (profile || inputs || slice || !cache))) { usage(argv[0]); free(paths); return 2; }
+    if (compile) {
+        int rc = run_compile(paths, npaths, nthreads);
+        free(paths);
+        return rc;
+    }
+    if (profile && (batch || npaths > 1 || mode == EXEC_TREE)) {
+        fprintf(stderr, "--profile runs a single script on the bytecode VM\n");
+        free(paths);
+        return 2;
+    }
+    if (batch || npaths > 1) {
+        int rc = run_batch(paths, npaths, mode, cache, nthreads, inputs, fuel, slice);
+        free(paths);
+        return rc;
+    }
+
+    const char* path = paths[0];
+    free(paths);
+    Unit U;
+    Error err;
+    const char* phase = "";
+    if (!unit_load(&U, path, mode, cache, &err, &phase)) {
+        int rc = err.kind ? 1 : 2;
+        if (rc == 2) fprintf(stderr, "cannot open '%s'%s\n", path, source_open_why(errno));
+        else print_error_and_flush(&err, phase);
+        unit_free(&U);
+        return rc;
+    }
+    Interp* I = (Interp*)malloc(sizeof(Interp));
+    interp_init(I, 1, 0, interactive);
+    I->budget = fuel;
+    Prof prof;
+    if (profile) { prof_init(&prof, &U.prog.chunk); I->prof = &prof; }
+    program_run(&U.prog, I);
+    int rc = 0;
+    if (I->err.kind) { print_error_and_flush(&I->err, "runtime"); rc = 1; }
+    if (profile) {
+        prof_report(&prof, &U.prog.chunk, stderr);
+        if (flame) {
+            FILE* f = fopen(flame, "w");
+            if (f) { prof_folded(&prof, &U.prog.chunk, f); fclose(f); }
+            else fprintf(stderr, "cannot open '%s'\n", flame);
+        }
+        prof_free(&prof);
+    }
+    interp_free(I);
+    free(I);
+    unit_free(&U);
+    return rc;
+}
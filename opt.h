@@ -0,0 +1,197 @@
+#ifndef OPT_H
+#define OPT_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/* =================== Dobra de constantes =================== */
+/* Roda sobre a árvore antes do resolver. Expressões só com literais viram um
+   literal; if/loop com condição constante perdem o ramo morto. Os nós são
+   reescritos no lugar (next é preservado), os filhos descartados ficam órfãos
+   no arena. O que falharia em tempo de execução (divisão por zero, tipos
+   incompatíveis) não é dobrado: o erro continua saindo no mesmo ponto. */
+
+static int fold_is_lit(const Node* n) { return n->type==N_INT || n->type==N_STRING; }
+
+/* mesma regra de truthy() para literais */
+static int fold_truthy(const Ast* A, const Node* n) {
+    return n->type==N_INT ? n->ival!=0 : node_text(A, n)[0]!=0;
+}
+
+static void fold_to_int(Node* n, int32_t v) {
+    n->type = N_INT; n->op = 0;
+    n->left = n->right = n->extra = 0;
+    n->lit = 0; n->ival = v;
+}
+
+static void fold_to_str(Node* n, uint32_t lit) {
+    n->type = N_STRING; n->op = 0;
+    n->left = n->right = n->extra = 0;
+    n->lit = lit; n->slot = 0;
+}
+
+/* texto de um literal para a concatenação (int formatado como em add_any) */
+static const char* fold_text(const Ast* A, const Node* n, char* buf, size_t cap, uint32_t* len) {
+    if (n->type==N_INT) { *len = (uint32_t)snprintf(buf, cap, "%d", n->ival); return buf; }
+    const char* t = node_text(A, n);
+    *len = (uint32_t)strlen(t);
+    return t;
+}
+
+/* "a" + "b", "a" + 1, 1 + "a" */
+static void fold_concat(Ast* A, Node* n, const Node* a, const Node* b) {
+    char na[16], nb[16];
+    uint32_t la, lb;
+    const char* pa = fold_text(A, a, na, sizeof(na), &la);
+    const char* pb = fold_text(A, b, nb, sizeof(nb), &lb);
+    // o pool pode ser realocado: guarda offsets, não ponteiros
+    uint32_t oa = a->type==N_STRING ? a->lit : 0, ob = b->type==N_STRING ? b->lit : 0;
+    uint32_t off = ast_lit_reserve(A, la + lb);
+    memcpy(A->lits + off,      a->type==N_STRING ? A->lits + oa : pa, la);
+    memcpy(A->lits + off + la, b->type==N_STRING ? A->lits + ob : pb, lb);
+    fold_to_str(n, off);
+}
+
+/* + - * e negação de int: dão a volta em 32 bits em todo executor. Em int
+   com sinal o estouro é UB, então a conta é feita em uint32_t */
+static int32_t int_add(int32_t a, int32_t b) { return (int32_t)((uint32_t)a + (uint32_t)b); }
+static int32_t int_sub(int32_t a, int32_t b) { return (int32_t)((uint32_t)a - (uint32_t)b); }
+static int32_t int_mul(int32_t a, int32_t b) { return (int32_t)((uint32_t)a * (uint32_t)b); }
+static int32_t int_neg(int32_t a) { return (int32_t)(0u - (uint32_t)a); }
+
+/* a / b com b != 0. Dá a volta em 32 bits como + e *: INT_MIN / -1 é INT_MIN
+   (o idiv do x86 trapa nesse caso, então -1 vira negação) */
+static int32_t int_div(int32_t a, int32_t b) {
+    return b == -1 ? int_neg(a) : a / b;
+}
+
+static int fold_int_binary(OpType op, int32_t a, int32_t b, int32_t* out) {
+    switch (op) {
+        case OP_PLUS:  *out = int_add(a, b); return 1;
+        case OP_MINUS: *out = int_sub(a, b); return 1;
+        case OP_MUL:   *out = int_mul(a, b); return 1;
+        case OP_DIV:
+            if (b==0) return 0; // fica para o runtime reportar
+            *out = int_div(a, b); return 1;
+        case OP_EQ: *out = a==b; return 1; case OP_NE: *out = a!=b; return 1;
+        case OP_LT: *out = a< b; return 1; case OP_LE: *out = a<=b; return 1;
+        case OP_GT: *out = a> b; return 1; case OP_GE: *out = a>=b; return 1;
+        default: return 0;
+    }
+}
+
+/* comparação de dois literais de string, como cmp_any/str_cmp */
+static int fold_str_cmp(const Ast* A, OpType op, const Node* a, const Node* b, int32_t* out) {
+    const char *pa = node_text(A, a), *pb = node_text(A, b);
+    size_t la = strlen(pa), lb = strlen(pb);
+    int c = memcmp(pa, pb, la < lb ? la : lb);
+    if (!c) c = (la > lb) - (la < lb);
+    switch (op) {
+        case OP_EQ: *out = c==0; return 1; case OP_NE: *out = c!=0; return 1;
+        case OP_LT: *out = c< 0; return 1; case OP_LE: *out = c<=0; return 1;
+        case OP_GT: *out = c> 0; return 1; case OP_GE: *out = c>=0; return 1;
+        default: return 0;
+    }
+}
+
+static void fold_expr(Ast* A, NodeId id) {
+    if (!id) return;
+    Node* n = &A->nodes[id]; // o arena não cresce aqui, o ponteiro continua válido
+    switch ((NodeType)n->type) {
+        case N_UNARY: {
+            fold_expr(A, n->left);
+            const Node* a = &A->nodes[n->left];
+            if (n->op==OP_NOT && fold_is_lit(a)) fold_to_int(n, !fold_truthy(A, a));
+            else if (a->type==N_INT && n->op==OP_MINUS) fold_to_int(n, int_neg(a->ival));
+            else if (a->type==N_INT && n->op==OP_PLUS)  fold_to_int(n, a->ival);
+            return;
+        }
+        case N_BINARY: {
+            fold_expr(A, n->left);
+            fold_expr(A, n->right);
+            const Node* a = &A->nodes[n->left];
+            const Node* b = &A->nodes[n->right];
+            if (n->op==OP_AND || n->op==OP_OR) {
+                if (!fold_is_lit(a)) return;
+                int l = fold_truthy(A, a);
+                if (n->op==OP_AND && !l) fold_to_int(n, 0);
+                else if (n->op==OP_OR && l) fold_to_int(n, 1);
+                else if (fold_is_lit(b)) fold_to_int(n, fold_truthy(A, b));
+                return;
+            }
+            if (!fold_is_lit(a) || !fold_is_lit(b)) return;
+            int32_t r;
+            if (a->type==N_INT && b->type==N_INT) {
+                if (fold_int_binary((OpType)n->op, a->ival, b->ival, &r)) fold_to_int(n, r);
+            } else if (n->op==OP_PLUS) {
+                fold_concat(A, n, a, b);
+            } else if (a->type==N_STRING && b->type==N_STRING) {
+                if (fold_str_cmp(A, (OpType)n->op, a, b, &r)) fold_to_int(n, r);
+            }
+            return;
+        }
+        case N_INDEX:
+            fold_expr(A, n->left);
+            fold_expr(A, n->right);
+            return;
+        case N_CALL: case N_MAP: case N_FCALL:
+            for (NodeId a = n->extra; a; a = A->nodes[a].next) fold_expr(A, a);
+            return;
+        default: return;
+    }
+}
+
+static void fold_stmts(Ast* A, NodeId id);
+
+static void fold_stmt(Ast* A, NodeId id) {
+    Node* n = &A->nodes[id];
+    switch ((NodeType)n->type) {
+        case N_ASSIGN: fold_expr(A, n->left); return;
+        case N_PRINT:
+            for (NodeId a = n->extra; a; a = A->nodes[a].next) fold_expr(A, a);
+            return;
+        case N_INPUT: return;
+        case N_SET_INDEX: fold_expr(A, n->left); fold_expr(A, n->right); return;
+        case N_IF: {
+            fold_expr(A, n->left);
+            fold_stmts(A, n->extra);
+            fold_stmts(A, n->right);
+            const Node* c = &A->nodes[n->left];
+            if (!fold_is_lit(c)) return;
+            // o if vira o ramo escolhido (ou um bloco vazio), mantendo o lugar na lista
+            NodeId keep = fold_truthy(A, c) ? n->extra : n->right;
+            NodeId next = n->next;
+            if (keep) *n = A->nodes[keep];
+            else { uint32_t pos = n->pos; memset(n, 0, sizeof(*n)); n->type = N_BLOCK; n->pos = pos; }
+            n->next = next;
+            return;
+        }
+        case N_WHILE: {
+            fold_expr(A, n->left);
+            fold_stmts(A, n->extra);
+            const Node* c = &A->nodes[n->left];
+            if (fold_is_lit(c) && !fold_truthy(A, c)) {
+                n->type = N_BLOCK; n->op = 0;
+                n->left = n->right = n->extra = 0;
+            }
+            return;
+        }
+        case N_BLOCK: fold_stmts(A, id); return;
+        case N_FUNC: fold_stmts(A, n->extra); return;
+        case N_RETURN: fold_expr(A, n->left); return;
+        default: fold_expr(A, id); return; // expressão solta
+    }
+}
+
+/* mesma forma de percorrer que exec_block */
+static void fold_stmts(Ast* A, NodeId id) {
+    if (!id) return;
+    if (A->nodes[id].type != N_BLOCK) { fold_stmt(A, id); return; }
+    for (NodeId cur = A->nodes[id].extra; cur; cur = A->nodes[cur].next)
+        fold_stmt(A, cur);
+}
+
+static void fold_constants(Ast* A, NodeId prog) { fold_stmts(A, prog); }
+
+#endif
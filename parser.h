@@ -5,11 +5,9 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdarg.h>  
+#include <stdint.h>
 
 /* =================== Config =================== */
-#define MAX_TOKEN_LENGTH 128
-#define MAX_TOKENS       2048
-#define MAX_VARS         512
 #define MAX_LINE         2048
 
 /* =================== AST =================== */
@@ -17,51 +15,147 @@ typedef enum {
     N_INT, N_STRING, N_VAR,
     N_UNARY,      // op, left
     N_BINARY,     // op, left, right
-    N_ASSIGN,     // var-name em value, left=expr
-    N_PRINT,      // extra = lista ligada por right
-    N_INPUT,      // value = nome var
+    N_ASSIGN,     // var-name em lit, left=expr
+    N_PRINT,      // extra = lista ligada por next
+    N_INPUT,      // lit = nome var
     N_IF,         // left=cond, extra=then, right=else?
     N_WHILE,      // left=cond, extra=body
-    N_BLOCK       // extra = primeiro stmt; encadeado via right
+    N_BLOCK,      // extra = primeiro stmt; encadeado via next
+    N_INDEX,      // left=array, right=índice
+    N_SET_INDEX,  // lit = nome var, left=índice, right=valor (a[i] = v;)
+    N_CALL,       // op = Builtin, extra = argumentos por next
+    N_MAP,        // {k: v, ...}: extra = k1 -> v1 -> k2 -> v2 ... por next, ival = pares
+    N_FUNC,       // func nome(p, ...) {...}: lit = nome, left = parâmetros (N_VAR por next), extra = corpo, op = nparams
+    N_RETURN,     // left = valor (0 em "return;")
+    N_FCALL,      // chamada de função do programa: lit = nome, extra = argumentos por next, op = nargs
+    N_GLOBAL      // N_VAR dentro de função que lê a variável global (resolver)
 } NodeType;
 
+#define FUNC_MAX_ARGS 255 // cabe em Node.op
+
+/* Funções embutidas sobre arrays de int e mapas (vm.h). As que mudam o
+   primeiro argumento (mutates) recebem uma variável e a alteram no lugar. */
+typedef enum { B_ARRAY, B_LEN, B_SUM, B_MIN, B_MAX, B_DOT, B_FILL, B_ADD, B_MUL, B_HAS, B_GET, B_DEL } Builtin;
+
+typedef struct { const char* name; int nargs; int mutates; } BuiltinInfo;
+
+static const BuiltinInfo g_builtins[] = {
+    { "array", 1, 0 },  // array(n): n zeros
+    { "len",   1, 0 },  // tamanho de array, mapa ou string
+    { "sum",   1, 0 }, { "min", 1, 0 }, { "max", 1, 0 },
+    { "dot",   2, 0 },  // produto escalar de dois arrays do mesmo tamanho
+    { "fill",  2, 1 },  // fill(a, v): todo elemento vira v
+    { "add",   2, 1 },  // add(a, k): a[i] + k
+    { "mul",   2, 1 },  // mul(a, k): a[i] * k
+    { "has",   2, 0 },  // has(m, k): 1 se a chave existe
+    { "get",   3, 0 },  // get(m, k, d): m[k], ou d se não existe
+    { "del",   2, 1 },  // del(m, k): remove; 1 se existia
+};
+
 typedef enum {
     OP_PLUS, OP_MINUS, OP_MUL, OP_DIV,
     OP_EQ, OP_NE, OP_LT, OP_LE, OP_GT, OP_GE,
     OP_AND, OP_OR, OP_NOT,
 } OpType;
 
-typedef struct Node {
-    NodeType type;
-    OpType   op;
-    char value[128]; // número em texto, string, ou nome de variável
-    struct Node* left;
-    struct Node* right;
-    struct Node* extra;
-    int line, col;
+/* Nós vivem num arena contíguo (Ast.nodes) e se referem uns aos outros por índice
+   de 32 bits; 0 é "nenhum". Números são decodificados uma vez no parser (ival);
+   textos de strings ficam fora do nó, em Ast.lits; nomes de variável são ids de
+   símbolo. Liberar a árvore inteira é
+   liberar o arena. */
+typedef uint32_t NodeId;
+
+typedef struct {
+    uint8_t  type;   // NodeType
+    uint8_t  op;     // OpType
+    uint32_t pos;    // offset no fonte (linha/coluna só quando preciso)
+    NodeId left, right, extra;
+    NodeId next;     // próximo statement do bloco / próximo argumento de output
+    uint32_t lit;    // offset do texto em Ast.lits, ou id do símbolo (N_VAR/N_ASSIGN/N_INPUT/N_FUNC/N_FCALL)
+    union {
+        int32_t slot; // slot da variável, índice em Ast.strs para N_STRING, em Ast.funcs para N_FUNC (resolver)
+        int32_t ival; // valor de N_INT; pares de N_MAP
+    };
 } Node;
 
-static Node* node_new(NodeType t, int line, int col) {
-    Node* n = (Node*)calloc(1, sizeof(Node));
-    n->type = t;
-    n->line = line;
-    n->col  = col;
-    return n;
+/* Uma função do programa (resolver). Dentro dela o slot de N_VAR/N_ASSIGN/...
+   é o índice do local no quadro: os parâmetros primeiro, depois cada nome que o
+   corpo escreve, na ordem em que aparece. */
+typedef struct {
+    NodeId node;         // o N_FUNC
+    int nparams, nlocals;
+    uint32_t* locals;    // símbolo de cada slot local
+} AstFunc;
+
+typedef struct {
+    Node* nodes; uint32_t count, cap;
+    char* lits;  uint32_t lits_len, lits_cap;
+    struct Str** strs; uint32_t nstrs, strs_cap; // literal de cada N_STRING (resolver)
+    struct Str** itab; uint32_t icount, icap;     // tabela de internação: um Str por conteúdo
+    AstFunc* funcs; uint32_t nfuncs;              // N_FUNC do nível de cima, na ordem (resolver)
+    Source* src;
+    SymTab* syms;
+} Ast;
+
+static void ast_init(Ast* A, Source* src, SymTab* syms) {
+    memset(A, 0, sizeof(*A));
+    A->src = src;
+    A->syms = syms;
+    A->cap = 256;
+    A->nodes = (Node*)calloc(A->cap, sizeof(Node));
+    A->count = 1; // índice 0 reservado
+    A->lits_cap = 1024;
+    A->lits = (char*)malloc(A->lits_cap);
+    A->lits[0] = 0; A->lits_len = 1; // lit 0 = ""
+}
+
+static void ast_free(Ast* A) {
+    for (uint32_t i=0;i<A->icap;i++) free(A->itab[i]);
+    free(A->itab);
+    for (uint32_t i=0;i<A->nfuncs;i++) free(A->funcs[i].locals);
+    free(A->funcs);
+    free(A->nodes); free(A->lits); free(A->strs);
+    memset(A, 0, sizeof(*A));
 }
 
-static void node_free(Node* n) {
-    if (!n) return;
-    node_free(n->left);
-    node_free(n->right);
-    node_free(n->extra);
-    free(n);
+static NodeId node_new(Ast* A, NodeType t, uint32_t pos) {
+    if (A->count >= A->cap) {
+        A->cap *= 2;
+        A->nodes = (Node*)realloc(A->nodes, sizeof(Node)*A->cap);
+    }
+    NodeId id = A->count++;
+    Node* n = &A->nodes[id];
+    memset(n, 0, sizeof(*n));
+    n->type = (uint8_t)t;
+    n->pos  = pos;
+    return id;
+}
+
+/* reserva len+1 bytes no pool (o último fica 0) e devolve o offset */
+static uint32_t ast_lit_reserve(Ast* A, uint32_t len) {
+    while (A->lits_len + len + 1 > A->lits_cap) {
+        A->lits_cap *= 2;
+        A->lits = (char*)realloc(A->lits, A->lits_cap);
+    }
+    uint32_t off = A->lits_len;
+    A->lits[off + len] = 0;
+    A->lits_len += len + 1;
+    return off;
 }
 
+static const char* node_text(const Ast* A, const Node* n) { return A->lits + n->lit; }
+static const char* node_name(const Ast* A, const Node* n) { return sym_name(A->syms, n->lit); }
+
 /* =================== Parser =================== */
 typedef struct {
     Token* toks;
     int pos;
     int count;
+    Ast* ast;   // ast->src é o fonte dos tokens
+    Error* err;
+    int in_func; // dentro do corpo de uma função: aceita return
+    int depth;   // aninhamento da expressão atual (parse_expression)
+    int height;  // altura da última árvore de expressão montada (parse_expression e operandos)
 } Parser;
 
 static Token* P_peek(Parser* P) {
@@ -79,197 +173,321 @@ static int P_match(Parser* P, TokenType t) {
 static Token* P_consume(Parser* P, TokenType t, const char* msg) {
     Token* tk = P_peek(P);
     if (tk->type == t) { P->pos++; return tk; }
-    set_error(ERR_PARSE, tk->line, tk->col, "%s (i found '%s')", msg, tk->lexeme);
+    set_error_at(P->err, ERR_PARSE, P->ast->src, tk->off, "%s (i found '%.*s')", msg, (int)tk->len, tok_text(P->ast->src, tk));
     return NULL;
 }
 
+/* strings: copia o lexema já sem escapes para o pool de literais;
+   identificadores só guardam o símbolo; números já saem decodificados */
+static NodeId P_leaf(Parser* P, NodeType t, Token* tk) {
+    Ast* A = P->ast;
+    NodeId n = node_new(A, t, tk->off);
+    const char* text = tok_text(A->src, tk);
+    if (tk->type == T_IDENTIFIER) {
+        A->nodes[n].lit = tk->sym;
+    } else if (tk->type == T_STRING) {
+        uint32_t off = ast_lit_reserve(A, tk->len);
+        uint32_t len = lex_unescape(text, tk->len, A->lits + off);
+        A->lits[off + len] = 0;
+        A->nodes[n].lit = off;
+    } else {
+        uint32_t v = 0; // estoura com wrap, como a aritmética em tempo de execução
+        for (uint32_t i=0;i<tk->len;i++) v = v*10 + (uint32_t)(text[i]-'0');
+        A->nodes[n].ival = (int32_t)v;
+    }
+    return n;
+}
+
 /* Forward decls */
-static Node* parse_statement(Parser* P);
-static Node* parse_block(Parser* P);
-static Node* parse_expression(Parser* P);
+static NodeId parse_statement(Parser* P);
+static NodeId parse_block(Parser* P);
+static NodeId parse_expression(Parser* P);
 
-/* precedência: || -> && -> igualdade -> relacional -> aditivo -> multiplicativo -> unário -> primário */
-static Node* parse_primary(Parser* P) {
-    Token* tk = P_peek(P);
-    if (tk->type == T_NUMBER) {
-        P->pos++;
-        Node* n = node_new(N_INT, tk->line, tk->col);
-        strncpy(n->value, tk->lexeme, sizeof(n->value)-1);
-        return n;
+/* índice em g_builtins do nome, ou -1 */
+static int builtin_find(const Source* S, const Token* name) {
+    int nb = (int)(sizeof(g_builtins)/sizeof(g_builtins[0]));
+    for (int b=0;b<nb;b++)
+        if (strlen(g_builtins[b].name) == name->len && memcmp(g_builtins[b].name, tok_text(S, name), name->len)==0) return b;
+    return -1;
+}
+
+/* nome(arg, ...): função embutida, ou N_FCALL para uma função do programa
+   (que pode vir depois no fonte: nome e aridade só são conferidos ao chamar) */
+static NodeId parse_call(Parser* P, Token* name) {
+    Ast* A = P->ast;
+    int b = builtin_find(A->src, name);
+    P_consume(P, T_LPAREN, "expected '('");
+    NodeId first=0, prev=0;
+    int nargs = 0, h = 0;
+    if (P_peek(P)->type != T_RPAREN) {
+        for (;;) {
+            NodeId e = parse_expression(P);
+            if (!e) return 0;
+            if (!first) first=e; else A->nodes[prev].next=e;
+            prev = e; nargs++;
+            if (P->height > h) h = P->height;
+            if (!P_match(P, T_COMMA)) break;
+        }
     }
-    if (tk->type == T_STRING) {
-        P->pos++;
-        Node* n = node_new(N_STRING, tk->line, tk->col);
-        strncpy(n->value, tk->lexeme, sizeof(n->value)-1);
+    if (!P_consume(P, T_RPAREN, "expected ')'")) return 0;
+    P->height = h + 1;
+    if (b < 0) {
+        if (nargs > FUNC_MAX_ARGS) {
+            set_error_at(P->err, ERR_PARSE, A->src, name->off, "more than %d arguments", FUNC_MAX_ARGS);
+            return 0;
+        }
+        NodeId n = P_leaf(P, N_FCALL, name);
+        A->nodes[n].op = (uint8_t)nargs;
+        A->nodes[n].extra = first;
         return n;
     }
-    if (tk->type == T_IDENTIFIER) {
-        P->pos++;
-        Node* n = node_new(N_VAR, tk->line, tk->col);
-        strncpy(n->value, tk->lexeme, sizeof(n->value)-1);
-        return n;
+    if (nargs != g_builtins[b].nargs) {
+        set_error_at(P->err, ERR_PARSE, A->src, name->off, "'%s' takes %d argument%s", g_builtins[b].name, g_builtins[b].nargs, g_builtins[b].nargs > 1 ? "s" : "");
+        return 0;
     }
-    if (P_match(P, T_LPAREN)) {
-        Node* e = parse_expression(P);
-        if (!e) return NULL;
-        if (!P_consume(P, T_RPAREN, "expected ')'")) { node_free(e); return NULL; }
-        return e;
+    if (g_builtins[b].mutates && A->nodes[first].type != N_VAR) {
+        set_error_at(P->err, ERR_PARSE, A->src, A->nodes[first].pos, "'%s' changes its first argument: it must be a variable", g_builtins[b].name);
+        return 0;
     }
-    set_error(ERR_PARSE, tk->line, tk->col, "invalid primary expression");
-    return NULL;
-}
-
-static Node* make_unary(OpType op, Node* a, int line, int col) {
-    Node* n = node_new(N_UNARY, line, col); n->op = op; n->left = a; return n;
-}
-static Node* make_binary(OpType op, Node* a, Node* b, int line, int col) {
-    Node* n = node_new(N_BINARY, line, col); n->op = op; n->left = a; n->right = b; return n;
+    NodeId n = node_new(A, N_CALL, name->off);
+    A->nodes[n].op = (uint8_t)b;
+    A->nodes[n].extra = first;
+    return n;
 }
 
-static Node* parse_unary(Parser* P) {
-    Token* tk = P_peek(P);
-    if (tk->type == T_NOT || tk->type == T_MINUS || tk->type == T_PLUS) {
-        P->pos++;
-        Node* rhs = parse_unary(P);
-        if (!rhs) return NULL;
-        OpType op = (tk->type==T_NOT)? OP_NOT : (tk->type==T_MINUS? OP_MINUS : OP_PLUS);
-        return make_unary(op, rhs, tk->line, tk->col);
+/* {k: v, ...}; {} é o mapa vazio. Só em expressão: um '{' no começo de um
+   comando continua sendo bloco. */
+static NodeId parse_map(Parser* P) {
+    Ast* A = P->ast;
+    Token* lb = P_consume(P, T_LBRACE, "expected '{'");
+    if (!lb) return 0;
+    NodeId first=0, prev=0;
+    int n = 0, h = 0;
+    if (P_peek(P)->type != T_RBRACE) {
+        for (;;) {
+            NodeId k = parse_expression(P);
+            if (!k) return 0;
+            if (P->height > h) h = P->height;
+            if (!P_consume(P, T_COLON, "expected ':' after map key")) return 0;
+            NodeId v = parse_expression(P);
+            if (!v) return 0;
+            if (P->height > h) h = P->height;
+            if (!first) first=k; else A->nodes[prev].next=k;
+            A->nodes[k].next = v;
+            prev = v; n++;
+            if (!P_match(P, T_COMMA)) break;
+        }
     }
-    return parse_primary(P);
+    if (!P_consume(P, T_RBRACE, "expected '}'")) return 0;
+    P->height = h + 1;
+    NodeId m = node_new(A, N_MAP, lb->off);
+    A->nodes[m].extra = first;
+    A->nodes[m].ival = n;
+    return m;
 }
 
-static Node* parse_mul(Parser* P) {
-    Node* left = parse_unary(P);
-    if (!left) return NULL;
-    for (;;) {
-        Token* tk = P_peek(P);
-        if (tk->type == T_STAR || tk->type == T_SLASH) {
-            P->pos++;
-            Node* right = parse_unary(P);
-            if (!right) { node_free(left); return NULL; }
-            left = make_binary(tk->type==T_STAR?OP_MUL:OP_DIV, left, right, tk->line, tk->col);
-        } else break;
-    }
-    return left;
-}
+/* =================== Expressões =================== */
+/* Pratt: um laço só em vez de uma função por nível de precedência. Parênteses
+   e operadores pendentes ficam numa pilha explícita (PrattOp), então o
+   aninhamento não gasta pilha de C; só chamada, índice e mapa chamam
+   parse_expression de novo. O aninhamento inteiro de uma expressão (itens na
+   pilha mais essas recursões) é limitado a PARSE_MAX_NEST, e a altura da
+   árvore montada também: a + b + c ... não empilha nada, mas cada + é um nível
+   a mais para as fases seguintes (fold, resolve, compile), que recursam nela.
+   Não limita a execução: no walker, uma chamada dentro de uma expressão funda
+   empilha outra, e quem segura isso é WALK_MAX_DEPTH (vm.h).
+   Precedência, do mais forte: pós-fixo [], unário ! - +, * /, + -, < <= > >=,
+   == !=, &&, ||. Os binários associam à esquerda. */
+#define PARSE_MAX_NEST 4096
 
-static Node* parse_add(Parser* P) {
-    Node* left = parse_mul(P);
-    if (!left) return NULL;
-    for (;;) {
-        Token* tk = P_peek(P);
-        if (tk->type == T_PLUS || tk->type == T_MINUS) {
-            P->pos++;
-            Node* right = parse_mul(P);
-            if (!right) { node_free(left); return NULL; }
-            left = make_binary(tk->type==T_PLUS?OP_PLUS:OP_MINUS, left, right, tk->line, tk->col);
-        } else break;
+/* força de ligação (bp) de cada TokenType como operador binário, na ordem do
+   enum; 0: não é binário */
+typedef struct { uint8_t bp, op; } BinOp;
+
+static const BinOp g_binops[] = {
+    {0,0}, {0,0}, {0,0}, {0,0}, {0,0},                  // EOF ? número string nome
+    {5,OP_PLUS}, {5,OP_MINUS}, {6,OP_MUL}, {6,OP_DIV},  // + - * /
+    {0,0},                                              // =
+    {3,OP_EQ}, {3,OP_NE},                               // == !=
+    {4,OP_LT}, {4,OP_LE}, {4,OP_GT}, {4,OP_GE},         // < <= > >=
+    {0,0}, {0,0}, {0,0}, {0,0}, {0,0}, {0,0},           // ( ) { } [ ]
+    {0,0}, {0,0}, {0,0},                                // ; , :
+    {2,OP_AND}, {1,OP_OR}, {0,0},                       // && || !
+    {0,0}, {0,0}, {0,0}, {0,0}, {0,0}, {0,0}, {0,0},    // palavras-chave
+};
+
+enum { PX_PAREN, PX_UNARY, PX_BINARY };
+
+typedef struct {
+    uint8_t kind, op, bp;
+    uint32_t pos;
+    NodeId left;    // PX_BINARY: o operando da esquerda
+    int lh;         // PX_BINARY: altura de left
+} PrattOp;
+
+/* lugar novo no topo; a pilha começa em local (na pilha de C) e dobra no heap */
+static PrattOp* pratt_push(PrattOp** st, int* sp, int* cap, PrattOp* local) {
+    if (*sp == *cap) {
+        PrattOp* n = (PrattOp*)malloc(sizeof(PrattOp) * *cap * 2);
+        memcpy(n, *st, sizeof(PrattOp) * *cap);
+        if (*st != local) free(*st);
+        *st = n; *cap *= 2;
     }
-    return left;
+    return &(*st)[(*sp)++];
 }
 
-static Node* parse_rel(Parser* P) {
-    Node* left = parse_add(P);
-    if (!left) return NULL;
-    for (;;) {
-        Token* tk = P_peek(P);
-        OpType op;
-        int match = 1;
-        switch (tk->type) {
-            case T_LT: op=OP_LT; break;
-            case T_LE: op=OP_LE; break;
-            case T_GT: op=OP_GT; break;
-            case T_GE: op=OP_GE; break;
-            default: match=0; break;
-        }
-        if (!match) break;
-        P->pos++;
-        Node* right = parse_add(P);
-        if (!right) { node_free(left); return NULL; }
-        left = make_binary(op, left, right, tk->line, tk->col);
-    }
-    return left;
+static NodeId make_unary(Parser* P, OpType op, NodeId a, uint32_t pos) {
+    NodeId n = node_new(P->ast, N_UNARY, pos);
+    Node* nd = &P->ast->nodes[n]; nd->op = (uint8_t)op; nd->left = a;
+    return n;
+}
+static NodeId make_binary(Parser* P, OpType op, NodeId a, NodeId b, uint32_t pos) {
+    NodeId n = node_new(P->ast, N_BINARY, pos);
+    Node* nd = &P->ast->nodes[n]; nd->op = (uint8_t)op; nd->left = a; nd->right = b;
+    return n;
 }
 
-static Node* parse_eq(Parser* P) {
-    Node* left = parse_rel(P);
-    if (!left) return NULL;
-    for (;;) {
-        Token* tk = P_peek(P);
-        if (tk->type == T_EQ || tk->type == T_NE) {
-            P->pos++;
-            Node* right = parse_rel(P);
-            if (!right) { node_free(left); return NULL; }
-            left = make_binary(tk->type==T_EQ?OP_EQ:OP_NE, left, right, tk->line, tk->col);
-        } else break;
+/* e[i][j]...: indexação; P->height entra com a altura de e e sai com a do resultado */
+static NodeId parse_postfix(Parser* P, NodeId e) {
+    int h = P->height;
+    while (P_peek(P)->type == T_LBRACKET) {
+        Token* lb = P_peek(P);
+        P->pos++;
+        NodeId i = parse_expression(P);
+        if (!i) return 0;
+        if (!P_consume(P, T_RBRACKET, "expected ']'")) return 0;
+        h = 1 + (P->height > h ? P->height : h);
+        NodeId n = node_new(P->ast, N_INDEX, lb->off);
+        P->ast->nodes[n].left = e; P->ast->nodes[n].right = i;
+        e = n;
     }
-    return left;
+    P->height = h;
+    return e;
 }
 
-static Node* parse_and(Parser* P) {
-    Node* left = parse_eq(P);
-    if (!left) return NULL;
-    for (;;) {
-        Token* tk = P_peek(P);
-        if (tk->type == T_AND) {
-            P->pos++;
-            Node* right = parse_eq(P);
-            if (!right) { node_free(left); return NULL; }
-            left = make_binary(OP_AND, left, right, tk->line, tk->col);
-        } else break;
+/* operando sem parênteses em volta: literal, variável, chamada ou mapa, mais os índices */
+static NodeId parse_operand(Parser* P) {
+    Token* tk = P_peek(P);
+    NodeId e = 0;
+    P->height = 1;
+    if (tk->type == T_NUMBER)      { P->pos++; e = P_leaf(P, N_INT, tk); }
+    else if (tk->type == T_STRING) { P->pos++; e = P_leaf(P, N_STRING, tk); }
+    else if (tk->type == T_IDENTIFIER) {
+        P->pos++;
+        e = P_peek(P)->type == T_LPAREN ? parse_call(P, tk) : P_leaf(P, N_VAR, tk);
     }
-    return left;
+    else if (tk->type == T_LBRACE) e = parse_map(P);
+    else set_error_at(P->err, ERR_PARSE, P->ast->src, tk->off, "invalid primary expression");
+    return e ? parse_postfix(P, e) : 0;
 }
 
-static Node* parse_or(Parser* P) {
-    Node* left = parse_and(P);
-    if (!left) return NULL;
+static NodeId parse_expression(Parser* P) {
+    (void)sizeof(char[sizeof(g_binops)/sizeof(g_binops[0]) == T_KW_RETURN+1 ? 1 : -1]); // tabela em dia com TokenType
+    PrattOp local[16];
+    PrattOp* st = local;
+    int sp = 0, cap = 16, depth0 = P->depth, eh = 0; // eh: altura de e
+    NodeId e = 0;
+    Token* tk = P_peek(P);
+    if (++P->depth > PARSE_MAX_NEST) goto deep;
     for (;;) {
-        Token* tk = P_peek(P);
-        if (tk->type == T_OR) {
-            P->pos++;
-            Node* right = parse_and(P);
-            if (!right) { node_free(left); return NULL; }
-            left = make_binary(OP_OR, left, right, tk->line, tk->col);
-        } else break;
+        // prefixo: parênteses e unários esperam na pilha até vir um operando
+        tk = P_peek(P);
+        if (tk->type == T_LPAREN || tk->type == T_NOT || tk->type == T_MINUS || tk->type == T_PLUS) {
+            if (P->depth >= PARSE_MAX_NEST) goto deep;
+            PrattOp* o = pratt_push(&st, &sp, &cap, local);
+            o->kind = tk->type == T_LPAREN ? PX_PAREN : PX_UNARY;
+            o->op = tk->type == T_NOT ? OP_NOT : tk->type == T_MINUS ? OP_MINUS : OP_PLUS;
+            o->pos = tk->off;
+            P->pos++; P->depth++;
+            continue;
+        }
+        e = parse_operand(P);
+        if (!e) goto fail;
+        eh = P->height;
+        // infixo: e é um operando completo
+        for (;;) {
+            while (sp && st[sp-1].kind == PX_UNARY) { sp--; P->depth--; eh++; e = make_unary(P, (OpType)st[sp].op, e, st[sp].pos); }
+            tk = P_peek(P);
+            const BinOp* b = &g_binops[tk->type];
+            while (sp && st[sp-1].kind == PX_BINARY && st[sp-1].bp >= b->bp) { // bp 0: fecha todos
+                sp--; P->depth--;
+                eh = 1 + (st[sp].lh > eh ? st[sp].lh : eh);
+                e = make_binary(P, (OpType)st[sp].op, st[sp].left, e, st[sp].pos);
+            }
+            // a cadeia à esquerda (a + b + c ...) não fica na pilha, mas cresce a árvore
+            if (depth0 + eh > PARSE_MAX_NEST) goto deep;
+            if (b->bp) break;
+            if (!sp) goto done;
+            // topo é um '(': o que veio é o seu conteúdo
+            if (!P_consume(P, T_RPAREN, "expected ')'")) goto fail;
+            sp--; P->depth--;
+            P->height = eh;
+            e = parse_postfix(P, e);
+            if (!e) goto fail;
+            eh = P->height;
+        }
+        // um binário: guarda o operando da esquerda e volta ao prefixo
+        if (P->depth >= PARSE_MAX_NEST) goto deep;
+        PrattOp* o = pratt_push(&st, &sp, &cap, local);
+        o->kind = PX_BINARY; o->op = g_binops[tk->type].op; o->bp = g_binops[tk->type].bp;
+        o->pos = tk->off; o->left = e; o->lh = eh;
+        P->pos++; P->depth++;
     }
-    return left;
+deep:
+    set_error_at(P->err, ERR_PARSE, P->ast->src, tk->off, "expression nested too deeply");
+fail:
+    e = 0;
+done:
+    if (st != local) free(st);
+    P->depth = depth0;
+    P->height = eh;
+    return e;
 }
 
-static Node* parse_expression(Parser* P) { return parse_or(P); }
-
-static Node* parse_assignment_or_expr_stmt(Parser* P) {
+static NodeId parse_assignment_or_expr_stmt(Parser* P) {
     // lookahead para "IDENT = ..."
     if (P_peek(P)->type == T_IDENTIFIER && P->toks[P->pos+1].type == T_ASSIGN) {
         Token* id = P_consume(P, T_IDENTIFIER, "expected indentifier");
-        if (!id) return NULL;
+        if (!id) return 0;
         P_consume(P, T_ASSIGN, "expected '='");
-        Node* expr = parse_expression(P);
-        if (!expr) return NULL;
-        Node* n = node_new(N_ASSIGN, id->line, id->col);
-        strncpy(n->value, id->lexeme, sizeof(n->value)-1);
-        n->left = expr;
+        NodeId expr = parse_expression(P);
+        if (!expr) return 0;
+        NodeId n = P_leaf(P, N_ASSIGN, id);
+        P->ast->nodes[n].left = expr;
         P_consume(P, T_SEMI, "expected';' after assignment");
         return n;
     } else {
         // expressão solta (ex.: função que não retorna? aqui só avaliamos e descartamos)
-        Node* e = parse_expression(P);
-        if (!e) return NULL;
+        NodeId e = parse_expression(P);
+        if (!e) return 0;
+        Node* x = &P->ast->nodes[e];
+        if (x->type == N_INDEX && P->ast->nodes[x->left].type == N_VAR && P_peek(P)->type == T_ASSIGN) {
+            // var[i] = valor;
+            P->pos++;
+            NodeId v = parse_expression(P);
+            if (!v) return 0;
+            x = &P->ast->nodes[e];
+            x->type = N_SET_INDEX;
+            x->lit = P->ast->nodes[x->left].lit;
+            x->left = x->right; x->right = v;
+            P_consume(P, T_SEMI, "expected';' after assignment");
+            return e;
+        }
         P_consume(P, T_SEMI, "expected';' after expression");
         return e; // como "stmt expr;" (sem efeito prático)
     }
 }
 
-static Node* parse_print(Parser* P) {
+static NodeId parse_print(Parser* P) {
     Token* kw = P_consume(P, T_KW_PRINT, "expected 'output'");
-    if (!kw) return NULL;
+    if (!kw) return 0;
     P_consume(P, T_LPAREN, "expected'(' after 'output'");
-    Node* first=NULL, *prev=NULL;
+    NodeId first=0, prev=0;
     if (P_peek(P)->type != T_RPAREN) {
         for (;;) {
-            Node* e = parse_expression(P);
-            if (!e) { node_free(first); return NULL; }
-            if (!first) first=e; else prev->right=e;
+            NodeId e = parse_expression(P);
+            if (!e) return 0;
+            if (!first) first=e; else P->ast->nodes[prev].next=e;
             prev = e;
             if (P_match(P, T_COMMA)) continue;
             break;
@@ -277,84 +495,186 @@ static Node* parse_print(Parser* P) {
     }
     P_consume(P, T_RPAREN, "expected')'");
     P_consume(P, T_SEMI,   "expected ';'  after 'output(...)'");
-    Node* n = node_new(N_PRINT, kw->line, kw->col);
-    n->extra = first;
+    NodeId n = node_new(P->ast, N_PRINT, kw->off);
+    P->ast->nodes[n].extra = first;
     return n;
 }
 
-static Node* parse_input(Parser* P) {
+static NodeId parse_input(Parser* P) {
     Token* kw = P_consume(P, T_KW_INPUT, "expected'input'");
-    if (!kw) return NULL;
+    if (!kw) return 0;
     P_consume(P, T_LPAREN, "expected '(' after 'input'");
     Token* id = P_consume(P, T_IDENTIFIER, "expected indentifier ininput(var)");
-    if (!id) return NULL;
+    if (!id) return 0;
     P_consume(P, T_RPAREN, "expected ')'");
     P_consume(P, T_SEMI,   "expected after 'input(...)'");
-    Node* n = node_new(N_INPUT, kw->line, kw->col);
-    strncpy(n->value, id->lexeme, sizeof(n->value)-1);
+    NodeId n = node_new(P->ast, N_INPUT, kw->off);
+    P->ast->nodes[n].lit = id->sym;
     return n;
 }
 
-static Node* parse_if(Parser* P) {
+static NodeId parse_if(Parser* P) {
     Token* kw = P_consume(P, T_KW_IF, "expected 'if'");
-    if (!kw) return NULL;
+    if (!kw) return 0;
     P_consume(P, T_LPAREN, "expected after '(' após 'if'");
-    Node* cond = parse_expression(P);
-    if (!cond) return NULL;
+    NodeId cond = parse_expression(P);
+    if (!cond) return 0;
     P_consume(P, T_RPAREN, "expected ')'");
-    Node* thenB = parse_block(P);
-    if (!thenB) { node_free(cond); return NULL; }
-    Node* elseB = NULL;
+    NodeId thenB = parse_block(P);
+    if (!thenB) return 0;
+    NodeId elseB = 0;
     if (P_match(P, T_KW_ELSE)) {
         elseB = parse_block(P);
-        if (!elseB) { node_free(cond); node_free(thenB); return NULL; }
+        if (!elseB) return 0;
     }
-    Node* n = node_new(N_IF, kw->line, kw->col);
-    n->left = cond; n->extra = thenB; n->right = elseB;
+    NodeId n = node_new(P->ast, N_IF, kw->off);
+    Node* nd = &P->ast->nodes[n];
+    nd->left = cond; nd->extra = thenB; nd->right = elseB;
     return n;
 }
 
-static Node* parse_while(Parser* P) {
+static NodeId parse_while(Parser* P) {
     Token* kw = P_consume(P, T_KW_WHILE, "expected 'loop'");
-    if (!kw) return NULL;
+    if (!kw) return 0;
     P_consume(P, T_LPAREN, "expected '(' after 'loop'");
-    Node* cond = parse_expression(P);
-    if (!cond) return NULL;
+    NodeId cond = parse_expression(P);
+    if (!cond) return 0;
     P_consume(P, T_RPAREN, "expected ')'");
-    Node* body = parse_block(P);
-    if (!body) { node_free(cond); return NULL; }
-    Node* n = node_new(N_WHILE, kw->line, kw->col);
-    n->left = cond; n->extra = body;
+    NodeId body = parse_block(P);
+    if (!body) return 0;
+    NodeId n = node_new(P->ast, N_WHILE, kw->off);
+    Node* nd = &P->ast->nodes[n];
+    nd->left = cond; nd->extra = body;
+    return n;
+}
+
+static NodeId parse_return(Parser* P) {
+    Token* kw = P_consume(P, T_KW_RETURN, "expected 'return'");
+    if (!kw) return 0;
+    if (!P->in_func) {
+        set_error_at(P->err, ERR_PARSE, P->ast->src, kw->off, "return outside a function");
+        return 0;
+    }
+    NodeId e = 0;
+    if (P_peek(P)->type != T_SEMI) {
+        e = parse_expression(P);
+        if (!e) return 0;
+    }
+    if (!P_consume(P, T_SEMI, "expected ';' after 'return'")) return 0;
+    NodeId n = node_new(P->ast, N_RETURN, kw->off);
+    P->ast->nodes[n].left = e;
     return n;
 }
 
-static Node* parse_statement(Parser* P) {
+static NodeId parse_statement(Parser* P) {
     Token* tk = P_peek(P);
     switch (tk->type) {
         case T_KW_PRINT: return parse_print(P);
         case T_KW_INPUT: return parse_input(P);
         case T_KW_IF:    return parse_if(P);
         case T_KW_WHILE: return parse_while(P);
+        case T_KW_RETURN: return parse_return(P);
         case T_LBRACE:   return parse_block(P);
+        case T_KW_FUNC:
+            set_error_at(P->err, ERR_PARSE, P->ast->src, tk->off, "functions are declared at the top level");
+            return 0;
         default:         return parse_assignment_or_expr_stmt(P);
     }
 }
 
-static Node* parse_block(Parser* P) {
+/* func nome(a, b) { ... }. O corpo sempre entre chaves. */
+static NodeId parse_func(Parser* P) {
+    Ast* A = P->ast;
+    Token* kw = P_consume(P, T_KW_FUNC, "expected 'func'");
+    if (!kw) return 0;
+    Token* name = P_consume(P, T_IDENTIFIER, "expected function name after 'func'");
+    if (!name) return 0;
+    if (builtin_find(A->src, name) >= 0) {
+        set_error_at(P->err, ERR_PARSE, A->src, name->off, "'%.*s' is a built-in function", (int)name->len, tok_text(A->src, name));
+        return 0;
+    }
+    if (!P_consume(P, T_LPAREN, "expected '(' after function name")) return 0;
+    NodeId first=0, prev=0;
+    int np = 0;
+    if (P_peek(P)->type != T_RPAREN) {
+        for (;;) {
+            Token* p = P_consume(P, T_IDENTIFIER, "expected parameter name");
+            if (!p) return 0;
+            for (NodeId q = first; q; q = A->nodes[q].next)
+                if (A->nodes[q].lit == p->sym) {
+                    set_error_at(P->err, ERR_PARSE, A->src, p->off, "duplicate parameter '%.*s'", (int)p->len, tok_text(A->src, p));
+                    return 0;
+                }
+            if (np == FUNC_MAX_ARGS) {
+                set_error_at(P->err, ERR_PARSE, A->src, p->off, "more than %d parameters", FUNC_MAX_ARGS);
+                return 0;
+            }
+            NodeId v = P_leaf(P, N_VAR, p);
+            if (!first) first=v; else A->nodes[prev].next=v;
+            prev = v; np++;
+            if (!P_match(P, T_COMMA)) break;
+        }
+    }
+    if (!P_consume(P, T_RPAREN, "expected ')'")) return 0;
+    if (P_peek(P)->type != T_LBRACE) { P_consume(P, T_LBRACE, "expected '{' to open the function body"); return 0; }
+    P->in_func = 1;
+    NodeId body = parse_block(P);
+    P->in_func = 0;
+    if (!body) return 0;
+    NodeId n = node_new(A, N_FUNC, kw->off);
+    Node* nd = &A->nodes[n];
+    nd->lit = name->sym; nd->left = first; nd->extra = body; nd->op = (uint8_t)np;
+    return n;
+}
+
+/* comando do nível de cima: o único lugar onde cabe uma definição de função */
+static NodeId parse_toplevel(Parser* P) {
+    if (P_peek(P)->type == T_KW_FUNC) return parse_func(P);
+    return parse_statement(P);
+}
+
+static NodeId parse_block_items(Parser* P) {
     if (!P_match(P, T_LBRACE)) {
         // bloco reduzido a um único statement (permitimos 'stmt' sem chaves)
         return parse_statement(P);
     }
-    Node* first=NULL, *prev=NULL;
+    NodeId first=0, prev=0;
     while (P_peek(P)->type != T_RBRACE && P_peek(P)->type != T_EOF) {
-        Node* s = parse_statement(P);
-        if (!s) { node_free(first); return NULL; }
-        if (!first) first=s; else prev->right=s;
+        NodeId s = parse_statement(P);
+        if (!s) return 0;
+        if (!first) first=s; else P->ast->nodes[prev].next=s;
+        prev=s;
+    }
+    if (!P_consume(P, T_RBRACE, "expected '}' to close block")) return 0;
+    NodeId blk = node_new(P->ast, N_BLOCK, P_prev(P)->off);
+    P->ast->nodes[blk].extra = first;
+    return blk;
+}
+
+/* corpo de if/loop/func ou { ... }: cada nível é uma recursão aqui e nas fases
+   seguintes, então blocos e expressões dividem o PARSE_MAX_NEST */
+static NodeId parse_block(Parser* P) {
+    if (P->depth + 1 >= PARSE_MAX_NEST) { // deixa um nível para a expressão de dentro
+        set_error_at(P->err, ERR_PARSE, P->ast->src, P_peek(P)->off, "blocks nested too deeply");
+        return 0;
+    }
+    P->depth++;
+    NodeId b = parse_block_items(P);
+    P->depth--;
+    return b;
+}
+
+/* programa = sequência de statements até EOF, devolvida como N_BLOCK */
+static NodeId parse_program(Parser* P) {
+    NodeId first=0, prev=0;
+    while (P_peek(P)->type != T_EOF && !P->err->kind) {
+        NodeId s = parse_toplevel(P);
+        if (!s) return 0;
+        if (!first) first=s; else P->ast->nodes[prev].next=s;
         prev=s;
     }
-    if (!P_consume(P, T_RBRACE, "expected '}' to close block")) { node_free(first); return NULL; }
-    Node* blk = node_new(N_BLOCK, P_prev(P)->line, P_prev(P)->col);
-    blk->extra = first;
+    NodeId blk = node_new(P->ast, N_BLOCK, 0);
+    P->ast->nodes[blk].extra = first;
     return blk;
 }
 #endif
@@ -0,0 +1,190 @@
+#ifndef POOL_H
+#define POOL_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/* =================== Pool de threads =================== */
+/* N workers tirando tarefas de uma fila FIFO (anel que cresce) protegida por um
+   mutex. pool_wait espera a fila esvaziar e as tarefas em andamento terminarem.
+   Precisa de -pthread. */
+#define POOL_STACK (8u << 20) // pilha de cada worker: o walker conta com ela (WALK_MAX_DEPTH)
+
+typedef struct { void (*fn)(void*); void* arg; } PoolTask;
+
+typedef struct {
+    pthread_t* threads; int nthreads;
+    PoolTask* q; int head, count, cap;
+    int active;     // tarefas rodando agora
+    int stop;
+    pthread_mutex_t mu;
+    pthread_cond_t has_work, idle;
+} Pool;
+
+static void* pool_worker(void* arg) {
+    Pool* P = (Pool*)arg;
+    pthread_mutex_lock(&P->mu);
+    for (;;) {
+        while (!P->count && !P->stop) pthread_cond_wait(&P->has_work, &P->mu);
+        if (!P->count) break; // stop e fila vazia
+        PoolTask t = P->q[P->head];
+        P->head = (P->head + 1) % P->cap;
+        P->count--;
+        P->active++;
+        pthread_mutex_unlock(&P->mu);
+        t.fn(t.arg);
+        pthread_mutex_lock(&P->mu);
+        P->active--;
+        if (!P->count && !P->active) pthread_cond_broadcast(&P->idle);
+    }
+    pthread_mutex_unlock(&P->mu);
+    return NULL;
+}
+
+static void pool_init(Pool* P, int nthreads) {
+    memset(P, 0, sizeof(*P));
+    if (nthreads < 1) nthreads = 1;
+    pthread_mutex_init(&P->mu, NULL);
+    pthread_cond_init(&P->has_work, NULL);
+    pthread_cond_init(&P->idle, NULL);
+    P->cap = 64;
+    P->q = (PoolTask*)malloc(sizeof(PoolTask) * P->cap);
+    P->threads = (pthread_t*)malloc(sizeof(pthread_t) * nthreads);
+    // o padrão vem do ulimit -s e, com ele unlimited, cai para 2 MB
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, POOL_STACK);
+    for (int i=0;i<nthreads;i++)
+        if (pthread_create(&P->threads[i], &attr, pool_worker, P) == 0) P->nthreads++;
+    pthread_attr_destroy(&attr);
+}
+
+static void pool_submit(Pool* P, void (*fn)(void*), void* arg) {
+    pthread_mutex_lock(&P->mu);
+    if (P->count == P->cap) {
+        // desenrola o anel no vetor novo
+        PoolTask* q = (PoolTask*)malloc(sizeof(PoolTask) * P->cap * 2);
+        for (int i=0;i<P->count;i++) q[i] = P->q[(P->head + i) % P->cap];
+        free(P->q);
+        P->q = q; P->head = 0; P->cap *= 2;
+    }
+    P->q[(P->head + P->count) % P->cap].fn  = fn;
+    P->q[(P->head + P->count) % P->cap].arg = arg;
+    P->count++;
+    pthread_cond_signal(&P->has_work);
+    pthread_mutex_unlock(&P->mu);
+    if (!P->nthreads) { // sem threads: roda na hora
+        pthread_mutex_lock(&P->mu);
+        PoolTask t = P->q[P->head];
+        P->head = (P->head + 1) % P->cap; P->count--;
+        pthread_mutex_unlock(&P->mu);
+        t.fn(t.arg);
+    }
+}
+
+static void pool_wait(Pool* P) {
+    pthread_mutex_lock(&P->mu);
+    while (P->count || P->active) pthread_cond_wait(&P->idle, &P->mu);
+    pthread_mutex_unlock(&P->mu);
+}
+
+static void pool_free(Pool* P) {
+    pthread_mutex_lock(&P->mu);
+    P->stop = 1;
+    pthread_cond_broadcast(&P->has_work);
+    pthread_mutex_unlock(&P->mu);
+    for (int i=0;i<P->nthreads;i++) pthread_join(P->threads[i], NULL);
+    pthread_mutex_destroy(&P->mu);
+    pthread_cond_destroy(&P->has_work);
+    pthread_cond_destroy(&P->idle);
+    free(P->threads); free(P->q);
+    memset(P, 0, sizeof(*P));
+}
+
+/* =================== Divisão com roubo =================== */
+/* pool_for: fn(arg, i) para todo i em [0, n), espalhado pelas threads do pool.
+   Cada worker começa com um trecho contíguo de [0, n) e tira índices da
+   frente do seu; quando ele acaba, rouba a metade de trás do maior trecho de
+   outro worker. Cada trecho tem a sua trava e nenhuma thread segura duas, então
+   sem roubo as threads não disputam nada (a fila do pool_submit trava um mutex
+   só por tarefa). Bom para milhares de tarefas curtas e desiguais. */
+typedef struct {
+    pthread_mutex_t mu;
+    int lo, hi;
+    char pad[64]; // um trecho por linha de cache
+} PoolRange;
+
+typedef struct {
+    PoolRange* r; int nr;
+    void (*fn)(void*, int); void* arg;
+} PoolFor;
+
+typedef struct { PoolFor* F; int me; } PoolForSlot;
+
+/* próximo índice do trecho r, ou -1 */
+static int pool_range_take(PoolRange* r) {
+    pthread_mutex_lock(&r->mu);
+    int i = r->lo < r->hi ? r->lo++ : -1;
+    pthread_mutex_unlock(&r->mu);
+    return i;
+}
+
+/* passa para o trecho de me a metade de trás do maior trecho alheio; 0 se todos vazios */
+static int pool_for_steal(PoolFor* F, int me) {
+    for (;;) {
+        int best = -1, blen = 0;
+        for (int v=0;v<F->nr;v++) {
+            if (v == me) continue;
+            pthread_mutex_lock(&F->r[v].mu);
+            int len = F->r[v].hi - F->r[v].lo;
+            pthread_mutex_unlock(&F->r[v].mu);
+            if (len > blen) { best = v; blen = len; }
+        }
+        if (best < 0) return 0;
+        PoolRange* V = &F->r[best];
+        pthread_mutex_lock(&V->mu);
+        int lo = V->lo + (V->hi - V->lo) / 2, hi = V->hi; // com 1 sobrando, leva ele
+        if (lo < hi) V->hi = lo;
+        pthread_mutex_unlock(&V->mu);
+        if (lo >= hi) continue; // esvaziou entre as duas olhadas: procura de novo
+        pthread_mutex_lock(&F->r[me].mu);
+        F->r[me].lo = lo; F->r[me].hi = hi;
+        pthread_mutex_unlock(&F->r[me].mu);
+        return 1;
+    }
+}
+
+static void pool_for_worker(void* arg) {
+    PoolForSlot* S = (PoolForSlot*)arg;
+    PoolFor* F = S->F;
+    for (;;) {
+        int i = pool_range_take(&F->r[S->me]);
+        if (i >= 0) F->fn(F->arg, i);
+        else if (!pool_for_steal(F, S->me)) break;
+    }
+}
+
+/* volta quando todos os índices rodaram; o pool não deve ter outras tarefas */
+static void pool_for(Pool* P, int n, void (*fn)(void*, int), void* arg) {
+    int nw = P->nthreads ? P->nthreads : 1;
+    if (nw > n) nw = n;
+    if (nw < 1) return;
+    PoolFor F;
+    F.r = (PoolRange*)malloc(sizeof(PoolRange) * nw); F.nr = nw;
+    F.fn = fn; F.arg = arg;
+    PoolForSlot* slots = (PoolForSlot*)malloc(sizeof(PoolForSlot) * nw);
+    for (int w=0;w<nw;w++) {
+        pthread_mutex_init(&F.r[w].mu, NULL);
+        F.r[w].lo = (int)((int64_t)n * w / nw);
+        F.r[w].hi = (int)((int64_t)n * (w + 1) / nw);
+        slots[w].F = &F; slots[w].me = w;
+    }
+    for (int w=0;w<nw;w++) pool_submit(P, pool_for_worker, &slots[w]);
+    pool_wait(P);
+    for (int w=0;w<nw;w++) pthread_mutex_destroy(&F.r[w].mu);
+    free(F.r); free(slots);
+}
+
+#endif
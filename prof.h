@@ -0,0 +1,206 @@
+#ifndef PROF_H
+#define PROF_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/* =================== Profiler =================== */
+/* Opcional (--profile). Com ele o vm_run despacha por outra tabela, em que todo
+   opcode passa antes por um stub que conta a instrução e dá à anterior os ciclos
+   desde a última (rdtsc; fora do x86, nanossegundos). Sem ele o despacho é o de
+   sempre. O JIT fica desligado enquanto mede: código nativo não tem contadores.
+   Os contadores são por palavra de código; no fim são agregados por linha, por
+   comando (StmtInfo) e por loop (LoopInfo). */
+#define PROF_TOP 20   // linhas/comandos mostrados no relatório
+
+typedef struct Prof {
+    uint64_t* hits;    // por palavra: vezes que a instrução que começa ali rodou
+    uint64_t* cycles;  // por palavra: ciclos até a instrução seguinte começar
+    int n;
+    int32_t last;      // instrução em andamento
+    uint64_t t;        // quando ela começou
+} Prof;
+
+static uint64_t prof_now(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static inline void prof_init(Prof* P, const Chunk* C) {
+    P->n = C->count;
+    P->hits   = (uint64_t*)calloc(C->count + 1, sizeof(uint64_t));
+    P->cycles = (uint64_t*)calloc(C->count + 1, sizeof(uint64_t));
+    P->last = 0; P->t = 0;
+}
+
+static inline void prof_free(Prof* P) { free(P->hits); free(P->cycles); memset(P, 0, sizeof(*P)); }
+
+static void prof_start(Prof* P) { P->t = prof_now(); }
+
+static void prof_tick(Prof* P, int32_t w) {
+    uint64_t t = prof_now();
+    P->cycles[P->last] += t - P->t;
+    P->hits[w]++;
+    P->last = w; P->t = t;
+}
+
+/* a instrução em w vai ser despachada de novo (quickening desfeito): o stub
+   conta outra vez, então essa execução sai daqui */
+static void prof_redispatch(Prof* P, int32_t w) { P->hits[w]--; }
+
+static void prof_stop(Prof* P) { P->cycles[P->last] += prof_now() - P->t; }
+
+/* ---- relatório ---- */
+typedef struct { uint64_t key; int idx; } ProfRank;
+
+static int prof_rank_cmp(const void* a, const void* b) {
+    uint64_t x = ((const ProfRank*)a)->key, y = ((const ProfRank*)b)->key;
+    return (x < y) - (x > y); // decrescente
+}
+
+static const char* prof_kind(int kind) {
+    switch ((NodeType)kind) {
+        case N_ASSIGN: case N_SET_INDEX: return "assign";
+        case N_PRINT:  return "output";
+        case N_INPUT:  return "input";
+        case N_IF:     return "if";
+        case N_WHILE:  return "loop";
+        case N_RETURN: return "return";
+        default:       return "expr";
+    }
+}
+
+static int prof_line(const Chunk* C, uint32_t pos) {
+    int line, col;
+    source_linecol(C->src, pos, &line, &col);
+    return line;
+}
+
+static uint64_t prof_sum(const Prof* P, int32_t top, int32_t end) {
+    uint64_t s = 0;
+    for (int32_t w = top; w < end; w++) s += P->cycles[w];
+    return s;
+}
+
+/* texto da linha (1-based) sem a indentação, até max bytes */
+static void prof_print_source(FILE* f, const Source* S, int line, int max) {
+    const char* p = S->data + S->lines[line-1];
+    const char* e = (uint32_t)line < S->nlines ? S->data + S->lines[line] : S->data + S->len;
+    while (p < e && (*p==' ' || *p=='\t')) p++;
+    while (e > p && (e[-1]=='\n' || e[-1]=='\r')) e--;
+    int n = (int)(e - p) < max ? (int)(e - p) : max;
+    fprintf(f, "%.*s%s", n, p, (int)(e - p) > max ? "..." : "");
+}
+
+static double prof_pct(uint64_t x, uint64_t total) { return total ? 100.0 * (double)x / (double)total : 0.0; }
+
+/* tabelas de pontos quentes: linhas (ciclos próprios), comandos e loops (inclusivos) */
+static inline void prof_report(const Prof* P, const Chunk* C, FILE* f) {
+    const Source* S = C->src;
+    uint64_t total = 0, instrs = 0;
+    for (int w=0; w<P->n; w++) { total += P->cycles[w]; instrs += P->hits[w]; }
+    fprintf(f, "== profile: %llu instructions, %llu %s ==\n", (unsigned long long)instrs, (unsigned long long)total,
+#if defined(__x86_64__) || defined(__i386__)
+            "cycles"
+#else
+            "ns"
+#endif
+            );
+
+    int nl = (int)S->nlines;
+    uint64_t* lc = (uint64_t*)calloc(nl + 1, sizeof(uint64_t));
+    uint64_t* li = (uint64_t*)calloc(nl + 1, sizeof(uint64_t));
+    for (int w=0; w<P->n; w++) {
+        if (!P->hits[w] && !P->cycles[w]) continue;
+        int l = prof_line(C, C->pos[w]) - 1;
+        lc[l] += P->cycles[w]; li[l] += P->hits[w];
+    }
+    ProfRank* r = (ProfRank*)malloc(sizeof(ProfRank) * (nl + C->nstmts + C->nloops + 1));
+    int k = 0;
+    for (int l=0; l<nl; l++) if (lc[l]) { r[k].key = lc[l]; r[k].idx = l; k++; }
+    qsort(r, k, sizeof(ProfRank), prof_rank_cmp);
+    fprintf(f, "\n  line      instrs          cycles      %%  source\n");
+    for (int i=0; i<k && i<PROF_TOP; i++) {
+        int l = r[i].idx;
+        fprintf(f, "%6d %11llu %15llu %5.1f%%  ", l+1, (unsigned long long)li[l], (unsigned long long)lc[l], prof_pct(lc[l], total));
+        prof_print_source(f, S, l+1, 60);
+        fputc('\n', f);
+    }
+
+    k = 0;
+    for (int s=0; s<C->nstmts; s++) {
+        const StmtInfo* st = &C->stmts[s];
+        if (st->end > st->top && P->hits[st->top]) { r[k].key = prof_sum(P, st->top, st->end); r[k].idx = s; k++; }
+    }
+    qsort(r, k, sizeof(ProfRank), prof_rank_cmp);
+    fprintf(f, "\n  stmt           runs          cycles      %%\n");
+    for (int i=0; i<k && i<PROF_TOP; i++) {
+        const StmtInfo* st = &C->stmts[r[i].idx];
+        char name[32];
+        snprintf(name, sizeof(name), "%s:%d", prof_kind(st->kind), prof_line(C, st->pos));
+        fprintf(f, "  %-12s %11llu %15llu %5.1f%%\n", name, (unsigned long long)P->hits[st->top],
+                (unsigned long long)r[i].key, prof_pct(r[i].key, total));
+    }
+
+    k = 0;
+    for (int g=0; g<C->nloops; g++) { r[k].key = prof_sum(P, C->loops[g].top, C->loops[g].end); r[k].idx = g; k++; }
+    qsort(r, k, sizeof(ProfRank), prof_rank_cmp);
+    if (k) fprintf(f, "\n  loop        entries      iterations          cycles      %%\n");
+    for (int i=0; i<k; i++) {
+        const LoopInfo* L = &C->loops[r[i].idx];
+        // BC_LOOP_INIT (2 palavras) vem logo antes de top; cada entrada faz uma checagem a mais que as voltas
+        uint64_t entries = P->hits[L->top - 2], checks = P->hits[L->top];
+        fprintf(f, "  line %-6d %8llu %15llu %15llu %5.1f%%\n", prof_line(C, C->pos[L->top]),
+                (unsigned long long)entries, (unsigned long long)(checks - entries),
+                (unsigned long long)r[i].key, prof_pct(r[i].key, total));
+    }
+    free(r); free(lc); free(li);
+}
+
+/* pilha de um comando, da raiz até ele: main;loop:3;if:5;assign:6 */
+static void prof_print_stack(FILE* f, const Chunk* C, const int* parent, int s) {
+    if (s < 0) { fputs("main", f); return; }
+    prof_print_stack(f, C, parent, parent[s]);
+    fprintf(f, ";%s:%d", prof_kind(C->stmts[s].kind), prof_line(C, C->stmts[s].pos));
+}
+
+/* Formato "folded" dos scripts de flamegraph: uma linha por pilha, ciclos próprios
+   no fim. A pilha é o aninhamento de comandos (loops, ifs) até o mais interno. */
+static inline void prof_folded(const Prof* P, const Chunk* C, FILE* f) {
+    int ns = C->nstmts;
+    int* parent = (int*)malloc(sizeof(int) * (ns + 1));
+    int* stack  = (int*)malloc(sizeof(int) * (ns + 1));
+    uint64_t* self = (uint64_t*)calloc(ns + 1, sizeof(uint64_t));
+    uint64_t root = 0;
+    int depth = 0, si = 0;
+    // stmts está em pré-ordem: uma varredura com pilha acha o comando mais interno de cada palavra
+    for (int w=0; w<P->n; w++) {
+        while (depth && C->stmts[stack[depth-1]].end <= w) depth--;
+        for (; si < ns && C->stmts[si].top <= w; si++) {
+            parent[si] = depth ? stack[depth-1] : -1;
+            if (C->stmts[si].end > w) stack[depth++] = si;
+        }
+        if (depth) self[stack[depth-1]] += P->cycles[w];
+        else root += P->cycles[w];
+    }
+    for (; si < ns; si++) parent[si] = -1;
+    if (root) fprintf(f, "main %llu\n", (unsigned long long)root);
+    for (int s=0; s<ns; s++) {
+        if (!self[s]) continue;
+        prof_print_stack(f, C, parent, s);
+        fprintf(f, " %llu\n", (unsigned long long)self[s]);
+    }
+    free(parent); free(stack); free(self);
+}
+
+#endif
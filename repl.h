@@ -0,0 +1,306 @@
+#ifndef REPL_H
+#define REPL_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+
+/* =================== REPL =================== */
+/* sun --repl [script]. Cada entrada é lexada, parseada e roda na hora contra a
+   Interp da sessão, então as variáveis continuam de uma entrada para a outra.
+   Uma entrada que termina no meio de um comando (bloco aberto, falta ';')
+   continua na linha seguinte; uma linha vazia a encerra e mostra o erro.
+   Os comandos ':' mexem no documento da sessão (incr.h), um script longo
+   editado por linha: cada edição relexa/reparseia só o trecho afetado e diz
+   quanto refez e em quanto tempo.
+   Funções definidas numa entrada ficam na sessão: a entrada (texto, Source e
+   Ast) é guardada num ReplDef até o fim, e as próximas chamam por R->funcs. */
+#define REPL_LINE 4096
+
+typedef struct ReplDef {
+    char* text; Source src; Ast ast;
+    struct ReplDef* next;
+} ReplDef;
+
+typedef struct {
+    SymTab syms;    // da sessão: entradas e documento dividem os ids (= slots)
+    Interp* I;
+    Doc doc;
+    ExecMode mode;
+    int64_t fuel;   // orçamento de cada execução (entrada ou :run)
+    FuncTab funcs;  // as das entradas anteriores, apontando para defs
+    ReplDef* defs;
+} Repl;
+
+static void repl_forget_funcs(Repl* R) {
+    functab_free(&R->funcs);
+    while (R->defs) {
+        ReplDef* d = R->defs;
+        R->defs = d->next;
+        ast_free(&d->ast);
+        free(d->src.lines);
+        free(d->text);
+        free(d);
+    }
+}
+
+static void repl_printf(Repl* R, const char* fmt, ...) {
+    char buf[1024];
+    va_list ap; va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n > (int)sizeof(buf) - 1) n = (int)sizeof(buf) - 1;
+    out_write(&R->I->io, buf, (size_t)n);
+}
+
+static double repl_ms(const struct timespec* a, const struct timespec* b) {
+    return (double)(b->tv_sec - a->tv_sec) * 1e3 + (double)(b->tv_nsec - a->tv_nsec) / 1e6;
+}
+
+/* roda uma árvore e a deixa pronta para ser liberada */
+static void repl_exec(Repl* R, Ast* A, NodeId root) {
+    Program prog;
+    program_prepare(&prog, A, root, R->mode, &R->funcs);
+    R->I->budget = R->fuel; R->I->fuel = 0;
+    program_run(&prog, R->I);
+    if (R->I->err.kind) { print_error_and_flush(&R->I->err, "runtime"); clear_error(&R->I->err); }
+    interp_own_values(R->I);
+    program_free(&prog);
+}
+
+/* 0 se a entrada parou no meio de um comando e force == 0 (espera mais linhas) */
+static int repl_eval(Repl* R, const char* text, int force) {
+    ReplDef* d = (ReplDef*)malloc(sizeof(ReplDef)); // só fica se a entrada define funções
+    size_t tl = strlen(text);
+    d->text = (char*)malloc(tl + 1);
+    memcpy(d->text, text, tl + 1);
+    Source* S = &d->src;
+    Ast* A = &d->ast;
+    source_from_string(S, d->text);
+    TokenVec toks = { NULL, 0, 0, NULL, &R->syms };
+    Error E;
+    lex_all(S, &toks, &E);
+    ast_init(A, S, &R->syms);
+    int done = 1, keep = 0;
+    if (E.kind) print_error_and_flush(&E, "lex");
+    else {
+        Parser P = { toks.data, 0, toks.count, A, &E, 0, 0, 0 };
+        NodeId root = parse_program(&P);
+        if (E.kind && !force && P.pos >= toks.count - 1) done = 0; // faltou texto, não sobrou
+        else if (E.kind || !root) print_error_and_flush(&E, "parse");
+        else {
+            repl_exec(R, A, root);
+            for (uint32_t i=0;i<A->nfuncs;i++) functab_add(&R->funcs, A, &A->funcs[i]);
+            keep = A->nfuncs > 0;
+        }
+    }
+    tokvec_free(&toks);
+    if (keep) { d->next = R->defs; R->defs = d; }
+    else { ast_free(A); free(S->lines); free(d->text); free(d); }
+    return done;
+}
+
+/* ---- documento ---- */
+/* [b, e) da linha n (1-based), sem o '\n'; 0 se não existe */
+static int repl_doc_line(Doc* D, long n, uint32_t* b, uint32_t* e) {
+    if (!D->src.lines) source_index_lines(&D->src);
+    if (n < 1 || n > (long)D->src.nlines) return 0;
+    *b = D->src.lines[n-1];
+    *e = n < (long)D->src.nlines ? D->src.lines[n] - 1 : D->len;
+    return 1;
+}
+
+static void repl_doc_report(Repl* R, const struct timespec* t0) {
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    Doc* D = &R->doc;
+    repl_printf(R, "%s: %d tokens relexed, %d statements reparsed, %.3f ms\n",
+                D->stats.full ? "rebuilt" : "edited", D->stats.relexed, D->stats.reparsed, repl_ms(t0, &t1));
+    out_flush(&R->I->io);
+    if (!doc_ok(D)) print_error_and_flush(&D->err, D->lex_ok ? "parse" : "lex");
+}
+
+static void repl_doc_edit(Repl* R, uint32_t at, uint32_t del, const char* ins, uint32_t il) {
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    doc_edit(&R->doc, at, del, ins, il);
+    repl_doc_report(R, &t0);
+}
+
+static int repl_load(Repl* R, const char* path) {
+    Source S;
+    if (!source_open(&S, path)) { fprintf(stderr, "cannot open '%s'%s\n", path, source_open_why(errno)); return 0; }
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    doc_set(&R->doc, S.data, S.len);
+    source_close(&S);
+    repl_doc_report(R, &t0);
+    return 1;
+}
+
+static void repl_list(Repl* R, long a, long b) {
+    Doc* D = &R->doc;
+    uint32_t lb, le;
+    for (long n = a; n <= b && repl_doc_line(D, n, &lb, &le); n++) {
+        repl_printf(R, "%5ld  ", n);
+        out_write(&R->I->io, D->text + lb, le - lb);
+        out_newline(&R->I->io);
+    }
+}
+
+static void repl_vars(Repl* R) {
+    Interp* I = R->I;
+    for (int i=0;i<I->nvars;i++) {
+        if (!I->vars[i].defined) continue;
+        Value v = I->vars[i].val;
+        repl_printf(R, "%s = %s", I->vars[i].name, v.type==V_STRING ? "\"" : "");
+        print_value(&I->io, v);
+        repl_printf(R, "%s\n", v.type==V_STRING ? "\"" : "");
+    }
+}
+
+static void repl_help(Repl* R) {
+    repl_printf(R,
+        "code runs as soon as it is complete; variables and functions persist\n"
+        ":load FILE          replace the document with FILE\n"
+        ":save FILE          write the document to FILE\n"
+        ":list [A [B]]       show document lines A..B\n"
+        ":line N TEXT        replace line N\n"
+        ":insert N TEXT      insert TEXT before line N\n"
+        ":delete N           remove line N\n"
+        ":edit OFF LEN TEXT  replace LEN bytes at OFF (TEXT takes \\n, \\t)\n"
+        ":run                run the document against the session variables\n"
+        ":vars               show the variables\n"
+        ":reset              forget the variables and functions\n"
+        ":quit\n");
+}
+
+/* número no começo de *p; *p passa para o texto depois dele. -1 se não há número */
+static long repl_arg(const char** p) {
+    char* e;
+    long v = strtol(*p, &e, 10);
+    if (e == *p) return -1;
+    *p = e;
+    if (**p == ' ') (*p)++;
+    return v;
+}
+
+/* 0 em :quit */
+static int repl_command(Repl* R, char* cmd) {
+    size_t n = strlen(cmd);
+    while (n && (cmd[n-1]=='\n' || cmd[n-1]=='\r')) cmd[--n] = 0;
+    char* arg = cmd;
+    while (*arg && *arg != ' ') arg++;
+    size_t clen = (size_t)(arg - cmd);
+    while (*arg == ' ') arg++;
+    const char* p = arg;
+    Doc* D = &R->doc;
+    uint32_t b, e;
+#define CMD(s) (clen == sizeof(s)-1 && memcmp(cmd, s, clen)==0)
+    if (CMD(":quit") || CMD(":q")) return 0;
+    else if (CMD(":help")) repl_help(R);
+    else if (CMD(":load") && *arg) repl_load(R, arg);
+    else if (CMD(":save") && *arg) {
+        FILE* f = fopen(arg, "wb");
+        if (!f || fwrite(D->text, 1, D->len, f) != D->len) fprintf(stderr, "cannot write '%s'\n", arg);
+        if (f) fclose(f);
+    }
+    else if (CMD(":list")) {
+        long a = repl_arg(&p), z = repl_arg(&p);
+        if (a < 1) a = 1;
+        if (z < a) z = *arg ? a : 0x7fffffff;
+        repl_list(R, a, z);
+    }
+    else if (CMD(":line")) {
+        long l = repl_arg(&p);
+        if (!repl_doc_line(D, l, &b, &e)) fprintf(stderr, "no line %ld\n", l);
+        else repl_doc_edit(R, b, e - b, p, (uint32_t)strlen(p));
+    }
+    else if (CMD(":insert")) {
+        long l = repl_arg(&p);
+        size_t pl = strlen(p);
+        char* t = (char*)malloc(pl + 2);
+        if (repl_doc_line(D, l, &b, &e)) { memcpy(t, p, pl); t[pl] = '\n'; repl_doc_edit(R, b, 0, t, (uint32_t)pl + 1); }
+        else if (l == (long)D->src.nlines + 1) { t[0] = '\n'; memcpy(t + 1, p, pl); repl_doc_edit(R, D->len, 0, t, (uint32_t)pl + 1); }
+        else fprintf(stderr, "no line %ld\n", l);
+        free(t);
+    }
+    else if (CMD(":delete")) {
+        long l = repl_arg(&p);
+        if (!repl_doc_line(D, l, &b, &e)) fprintf(stderr, "no line %ld\n", l);
+        else if (e < D->len) repl_doc_edit(R, b, e + 1 - b, "", 0);
+        else repl_doc_edit(R, b ? b - 1 : 0, e - (b ? b - 1 : 0), "", 0); // última: leva o '\n' de antes
+    }
+    else if (CMD(":edit")) {
+        long off = repl_arg(&p), len = repl_arg(&p);
+        if (off < 0 || len < 0) { fprintf(stderr, "usage: :edit OFF LEN TEXT\n"); return 1; }
+        char* t = (char*)malloc(strlen(p) + 1);
+        uint32_t tl = lex_unescape(p, (uint32_t)strlen(p), t);
+        repl_doc_edit(R, (uint32_t)off, (uint32_t)len, t, tl);
+        free(t);
+    }
+    else if (CMD(":run")) {
+        Ast A;
+        NodeId root = doc_snapshot(D, &A);
+        if (!root) print_error_and_flush(&D->err, D->lex_ok ? "parse" : "lex");
+        else { repl_exec(R, &A, root); ast_free(&A); }
+    }
+    else if (CMD(":vars")) repl_vars(R);
+    else if (CMD(":reset")) { interp_free(R->I); repl_forget_funcs(R); }
+    else fprintf(stderr, "unknown command '%s' (:help lists them)\n", cmd);
+#undef CMD
+    out_flush(&R->I->io);
+    return 1;
+}
+
+static int repl_run(ExecMode mode, int interactive, int64_t fuel, const char* script) {
+    Repl R;
+    symtab_init(&R.syms);
+    R.mode = mode;
+    R.fuel = fuel;
+    memset(&R.funcs, 0, sizeof(R.funcs));
+    R.defs = NULL;
+    R.I = (Interp*)malloc(sizeof(Interp));
+    interp_init(R.I, 1, 0, interactive);
+    doc_init(&R.doc, &R.syms);
+    if (script) repl_load(&R, script);
+
+    char line[REPL_LINE];
+    char* buf = NULL; size_t len = 0, cap = 0;
+    int more = 0; // len > 0: a entrada anterior ainda não fechou
+    for (;;) {
+        if (interactive && !more) { out_write(&R.I->io, len ? "...> " : "sun> ", 5); out_flush(&R.I->io); }
+        size_t start = len;
+        if (!in_line(&R.I->io, line, sizeof(line))) break;
+        size_t n = strlen(line);
+        if (len + n + 1 > cap) { cap = (len + n + 1) * 2; buf = (char*)realloc(buf, cap); }
+        memcpy(buf + len, line, n + 1);
+        len += n;
+        more = n && line[n-1] != '\n'; // linha maior que o buffer: junta o resto
+        if (more) continue;
+
+        if (!start && buf[0] == ':') {
+            int go = repl_command(&R, buf);
+            len = 0;
+            if (!go) break;
+            continue;
+        }
+        size_t i = start;
+        while (i < len && ch_ws((unsigned char)buf[i])) i++;
+        int blank = i == len;
+        if (blank && !start) { len = 0; continue; }
+        if (repl_eval(&R, buf, blank)) len = 0;
+    }
+    if (len) repl_eval(&R, buf, 1);
+    free(buf);
+    out_flush(&R.I->io);
+    doc_free(&R.doc);
+    interp_free(R.I);
+    repl_forget_funcs(&R);
+    free(R.I);
+    symtab_free(&R.syms);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef SCHED_H
+#define SCHED_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <poll.h>
+
+/* =================== Escalonador =================== */
+/* Várias Interp numa thread só, como corrotinas. Cada vez que uma tarefa roda
+   ela leva uma fatia de combustível (slice voltas de loop); quando a fatia
+   acaba o vm_run suspende e a vez passa para a próxima, em rodízio, então um
+   script que não termina não segura os outros. Tarefa parada em input() sem
+   linha pronta sai do rodízio até o seu descritor ter dado; se todas estão
+   esperando, um poll(2) dorme até alguma entrada chegar.
+   O walker (EXEC_TREE) não suspende: roda inteiro na primeira vez. */
+enum { TASK_READY, TASK_WAIT, TASK_DONE };
+
+typedef struct {
+    const Program* prog;
+    Interp* I;      // do chamador; o erro fica em I->err
+    int state;
+} SchedTask;
+
+typedef struct {
+    SchedTask* tasks; int n, cap;
+    int64_t slice;
+} Sched;
+
+static void sched_init(Sched* S, int64_t slice) {
+    S->tasks = NULL; S->n = S->cap = 0;
+    S->slice = slice > 0 ? slice : FUEL_SLICE;
+}
+
+static void sched_free(Sched* S) { free(S->tasks); S->tasks = NULL; S->n = S->cap = 0; }
+
+static void sched_add(Sched* S, const Program* P, Interp* I) {
+    if (S->n == S->cap) {
+        S->cap = S->cap ? S->cap*2 : 16;
+        S->tasks = (SchedTask*)realloc(S->tasks, sizeof(SchedTask) * S->cap);
+    }
+    I->yield = 1;
+    S->tasks[S->n].prog = P;
+    S->tasks[S->n].I = I;
+    S->tasks[S->n].state = TASK_READY;
+    S->n++;
+}
+
+/* até todas as tarefas terminarem */
+static void sched_run(Sched* S) {
+    struct pollfd* pf = (struct pollfd*)malloc(sizeof(struct pollfd) * (S->n + 1));
+    int left = S->n;
+    while (left) {
+        int ran = 0, npf = 0;
+        for (int i=0;i<S->n;i++) {
+            SchedTask* T = &S->tasks[i];
+            if (T->state == TASK_WAIT && in_poll(&T->I->io)) T->state = TASK_READY;
+            if (T->state == TASK_WAIT) { pf[npf].fd = T->I->io.in_fd; pf[npf].events = POLLIN; pf[npf].revents = 0; npf++; continue; }
+            if (T->state != TASK_READY) continue;
+            if (T->I->fuel <= 0) fuel_refill(T->I, S->slice); // orçamento vazio: o vm_run reporta
+            RunStatus st = program_step(T->prog, T->I);
+            ran = 1;
+            if (st == RUN_WAIT) T->state = TASK_WAIT;
+            else if (st == RUN_DONE) { T->state = TASK_DONE; T->I->yield = 0; left--; }
+        }
+        // todas esperando entrada: dorme até uma delas ter o que ler
+        if (!ran && npf && poll(pf, (nfds_t)npf, -1) < 0 && errno != EINTR) break;
+    }
+    free(pf);
+}
+
+#endif
@@ -0,0 +1,108 @@
+#!/bin/sh
+# Regressão do sun. Compila main.c e roda cada tests/scripts/*.sm no executor
+# padrão (VM com JIT), em --no-jit e em --tree, comparando a saída (stdout e
+# stderr juntos, mais "[exit N]" se N != 0) com o .out ao lado; depois roda uma
+# cópia duas vezes com o cache ligado, gravando e então lendo o .smc. Opcionais
+# por script: .in vira a entrada, .args traz opções extras (ex.: --fuel 100).
+# Os scripts rodam de novo num binário com -fsanitize=undefined, que aborta no
+# primeiro UB (estouro de int com sinal, shift, ...), se o compilador tiver.
+# Os testes de unidade em tests/unit/*.c incluem os headers direto; cada um é
+# compilado e roda sozinho, saindo com 0 se passou.
+#
+#   sh tests/run.sh            # CC e CFLAGS do ambiente valem
+#   sh tests/run.sh --update   # regrava os .out com a saída do executor padrão
+set -u
+here=$(cd "$(dirname "$0")" && pwd)
+root=$(dirname "$here")
+CC=${CC:-cc}
+CFLAGS=${CFLAGS:--O2 -Wall -Wextra}
+update=0
+[ "${1:-}" = --update ] && update=1
+
+work=$(mktemp -d "${TMPDIR:-/tmp}/sun-tests.XXXXXX") || exit 1
+trap 'rm -rf "$work"' EXIT INT TERM
+
+$CC $CFLAGS -pthread -o "$work/sun" "$root/main.c" || { echo "build failed"; exit 1; }
+ubsan=
+$CC $CFLAGS -fsanitize=undefined -fno-sanitize-recover=undefined -pthread -o "$work/sun-ubsan" "$root/main.c" 2>/dev/null \
+    && ubsan=$work/sun-ubsan
+
+pass=0
+fail=0
+
+# run base script [opções...]: roda o script em $sun com o .in e o .args de base
+run() {
+    b=$1; s=$2; shift 2
+    args=
+    [ -f "$b.args" ] && args=$(cat "$b.args")
+    in=/dev/null
+    [ -f "$b.in" ] && in=$b.in
+    # $args sem aspas: são várias opções
+    "$sun" "$@" $args "$s" < "$in" 2>&1
+    rc=$?
+    [ $rc -ne 0 ] && echo "[exit $rc]"
+    return 0
+}
+
+# check nome modo esperado obtido
+check() {
+    if [ "$3" = "$4" ]; then
+        pass=$((pass + 1))
+    else
+        fail=$((fail + 1))
+        echo "FAIL $1 ($2)"
+        printf '%s\n' "$3" > "$work/want"
+        printf '%s\n' "$4" > "$work/got"
+        diff -u "$work/want" "$work/got" | sed -n '3,22p'
+    fi
+}
+
+# scripts rótulo: todos os scripts em $sun, nos três executores e pelo cache
+scripts() {
+    for s in "$here"/scripts/*.sm; do
+        [ -f "$s" ] || continue
+        b=${s%.sm}
+        name=$(basename "$b")
+        [ $update = 1 ] && [ -z "$1" ] && run "$b" "$s" --no-cache > "$b.out"
+        if [ ! -f "$b.out" ]; then
+            fail=$((fail + 1)); echo "FAIL $name (no $name.out)"; continue
+        fi
+        want=$(cat "$b.out")
+        check "$name" "${1}default" "$want" "$(run "$b" "$s" --no-cache)"
+        check "$name" "${1}--no-jit" "$want" "$(run "$b" "$s" --no-cache --no-jit)"
+        check "$name" "${1}--tree" "$want" "$(run "$b" "$s" --no-cache --tree)"
+        cp "$s" "$work/c.sm"
+        rm -f "$work/c.smc"
+        check "$name" "${1}cache write" "$want" "$(run "$b" "$work/c.sm")"
+        case $want in
+            *"[lex error]"*|*"[parse error]"*) ;;
+            *) [ -f "$work/c.smc" ] || { fail=$((fail + 1)); echo "FAIL $name (no .smc written)"; } ;;
+        esac
+        check "$name" "${1}cache read" "$want" "$(run "$b" "$work/c.sm")"
+    done
+}
+
+sun=$work/sun
+scripts ""
+if [ -n "$ubsan" ]; then
+    sun=$ubsan
+    scripts "ubsan "
+else
+    echo "note: $CC has no -fsanitize=undefined; skipping the UBSan pass"
+fi
+
+for u in "$here"/unit/*.c; do
+    [ -f "$u" ] || continue
+    name=$(basename "$u" .c)
+    if ! $CC $CFLAGS -pthread -iquote "$root" -o "$work/$name" "$u"; then
+        fail=$((fail + 1)); echo "FAIL $name (build)"; continue
+    fi
+    if "$work/$name" > "$work/$name.log" 2>&1; then
+        pass=$((pass + 1))
+    else
+        fail=$((fail + 1)); echo "FAIL $name"; sed -n '1,20p' "$work/$name.log"
+    fi
+done
+
+echo "$pass passed, $fail failed"
+[ $fail -eq 0 ]
@@ -0,0 +1,228 @@
+/* doc_edit: depois de cada edição os tokens e a árvore do documento têm de ser
+   os mesmos de um lex/parse do zero sobre o texto (posições inclusive), e ele
+   só pode dizer que parseia quando o texto parseia. Edições escritas à mão
+   (else novo, string aberta, comando pela metade), onde o programa do documento
+   também tem de rodar igual, e uma sequência aleatória com semente fixa; uma
+   edição pequena num documento grande não refaz tudo. */
+#include "lexer.h"
+#include "io.h"
+#include "parser.h"
+#include "opt.h"
+#include "vec.h"
+#include "vm.h"
+#include "compiler.h"
+#include "jit.h"
+#include "cache.h"
+#include "prof.h"
+#include "exec.h"
+#include "incr.h"
+
+static int g_fail;
+#define CHECK(c, ...) do { if (!(c)) { g_fail++; fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+                                       fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); } } while (0)
+
+static SymTab g_syms;
+static int g_run; // check_doc também roda os dois programas
+
+/* saída do programa (mais a mensagem do erro de execução, se houver) em out */
+static void run_tree(Ast* A, NodeId root, char* out, size_t cap) {
+    Program prog;
+    program_prepare(&prog, A, root, EXEC_BYTECODE, NULL);
+    FILE* f = tmpfile();
+    Interp* I = (Interp*)malloc(sizeof(Interp));
+    interp_init(I, fileno(f), -1, 0);
+    program_run(&prog, I);
+    size_t n = (size_t)lseek(fileno(f), 0, SEEK_CUR);
+    rewind(f);
+    n = fread(out, 1, n < cap ? n : cap - 1, f);
+    out[n] = 0;
+    if (I->err.kind) snprintf(out + n, cap - n, "[%s]", I->err.msg);
+    interp_free(I);
+    free(I);
+    fclose(f);
+    program_free(&prog);
+}
+
+/* a e b iguais, com os irmãos que vêm por next */
+static int same_tree(const Ast* A, NodeId a, const Ast* B, NodeId b) {
+    for (; a || b; a = A->nodes[a].next, b = B->nodes[b].next) {
+        if (!a || !b) return 0;
+        const Node* x = &A->nodes[a];
+        const Node* y = &B->nodes[b];
+        if (x->type != y->type || x->op != y->op || x->pos != y->pos || x->ival != y->ival) return 0;
+        if (x->type == N_STRING ? strcmp(node_text(A, x), node_text(B, y)) != 0 : x->lit != y->lit) return 0;
+        if (!same_tree(A, x->left, B, y->left) || !same_tree(A, x->right, B, y->right)
+            || !same_tree(A, x->extra, B, y->extra)) return 0;
+    }
+    return 1;
+}
+
+/* D contra lex/parse do zero do mesmo texto */
+static void check_doc(Doc* D, const char* what) {
+    Source S;
+    source_from_string(&S, D->text);
+    Error E;
+    clear_error(&E);
+    TokenVec tv = { NULL, 0, 0, &S, &g_syms };
+    lex_all(&S, &tv, &E);
+    CHECK(D->lex_ok == !E.kind, "%s: lex_ok %d, fresh lex error '%s'", what, D->lex_ok, E.msg);
+    if (D->lex_ok && !E.kind) {
+        int same = D->toks.count == tv.count;
+        for (int i=0; same && i<tv.count; i++) {
+            const Token* t = &D->toks.data[i];
+            const Token* u = &tv.data[i];
+            same = t->type == u->type && t->off == u->off && t->len == u->len && t->sym == u->sym;
+        }
+        CHECK(same, "%s: tokens differ from a fresh lex", what);
+    }
+    int ok = !E.kind;
+    Ast A;
+    ast_init(&A, &S, &g_syms);
+    NodeId root = 0;
+    if (ok) {
+        Parser P = { tv.data, 0, tv.count, &A, &E, 0, 0, 0 };
+        root = parse_program(&P);
+        ok = root && !E.kind;
+    }
+    CHECK(doc_ok(D) == ok, "%s: doc_ok %d but fresh parse %s ('%s')", what, doc_ok(D), ok ? "passes" : "fails", E.msg);
+    if (ok && doc_ok(D)) {
+        Ast B;
+        NodeId r = doc_snapshot(D, &B);
+        CHECK(r && same_tree(&A, A.nodes[root].extra, &B, B.nodes[r].extra), "%s: tree differs from a fresh parse", what);
+        if (r && g_run) {
+            char want[512], got[512];
+            run_tree(&A, root, want, sizeof(want));
+            run_tree(&B, r, got, sizeof(got));
+            CHECK(strcmp(want, got) == 0, "%s: document prints '%s', fresh parse '%s'", what, got, want);
+        }
+        ast_free(&B);
+    }
+    ast_free(&A);
+    tokvec_free(&tv);
+    source_close(&S);
+}
+
+/* troca a primeira ocorrência de from (a partir de skip ocorrências) por to */
+static void edit(Doc* D, const char* from, int skip, const char* to, const char* what) {
+    const char* p = D->text;
+    for (;;) {
+        p = strstr(p, from);
+        if (!p) { g_fail++; fprintf(stderr, "%s: '%s' not in the text\n", what, from); return; }
+        if (skip-- == 0) break;
+        p++;
+    }
+    doc_edit(D, (uint32_t)(p - D->text), (uint32_t)strlen(from), to, (uint32_t)strlen(to));
+    check_doc(D, what);
+}
+
+static const char* PROG =
+    "x = 1;\n"
+    "s = \"a b\";\n"
+    "if (x > 0) { output(\"pos\"); }\n"
+    "loop (x < 10) { x = x + 1; }\n"
+    "func f(a, b) { return a * b + 1; }\n"
+    "m = {1: \"one\", \"k\": 0};\n"
+    "output(f(x, 2), s);\n";
+
+static void scripted(void) {
+    Doc D;
+    g_run = 1;
+    doc_init(&D, &g_syms);
+    doc_set(&D, PROG, (uint32_t)strlen(PROG));
+    if (!doc_ok(&D)) { g_fail++; print_error_and_flush(&D.err, "parse"); }
+    check_doc(&D, "set");
+    edit(&D, "x = 1;", 0, "x = 12;", "retype a literal");
+    edit(&D, "1", 1, "1 + 2 * 3", "grow an expression");
+    edit(&D, "}\n", 0, "} else { output(\"neg\"); }\n", "else joins the if before it");
+    edit(&D, " else { output(\"neg\"); }", 0, "", "drop the else");
+    edit(&D, "\"a b\"", 0, "\"a b", "open a string");
+    edit(&D, "\"a b", 0, "\"a b\"", "close it again");
+    edit(&D, "x + 1;", 0, "x + ;", "half-typed statement");
+    edit(&D, "output(f(x, 2), s);", 0, "output(f(x, 2), s", "second hole");
+    edit(&D, "x + ;", 0, "x + 1;", "fix the first hole");
+    edit(&D, "output(f(x, 2), s", 0, "output(f(x, 2), s);", "fix the second hole");
+    edit(&D, "x = 12", 0, "x  =  12", "whitespace only");
+    edit(&D, "12", 0, " 12", "space before a token");
+    edit(&D, "(f(x", 0, "(\n  f(x", "line break inside a call");
+    edit(&D, "\n", 0, "\n\n\n", "blank lines");
+    edit(&D, "func f(a, b)", 0, "func g(a, b)", "rename a function");
+    edit(&D, "{1:", 0, "{ 1 :", "spaces in a map");
+    doc_edit(&D, 0, 0, "y = 0;\n", 7);
+    check_doc(&D, "insert at the start");
+    doc_edit(&D, D.len, 0, "output(y);\n", 11);
+    check_doc(&D, "append");
+    doc_edit(&D, 0, D.len, "", 0);
+    check_doc(&D, "delete everything");
+    doc_edit(&D, 0, 0, "output(1)", 9);
+    check_doc(&D, "type into an empty document");
+    doc_free(&D);
+    g_run = 0;
+}
+
+/* documento grande: digitar num comando do meio relexa e reparseia só ele */
+static void incremental(void) {
+    char* text = (char*)malloc(200 * 32);
+    uint32_t len = 0;
+    for (int i=0;i<200;i++) len += (uint32_t)sprintf(text + len, "v%d = %d + v%d;\n", i, i, i ? i-1 : 0);
+    Doc D;
+    doc_init(&D, &g_syms);
+    doc_set(&D, text, len);
+    const char* p = strstr(D.text, "v100 = 100");
+    doc_edit(&D, (uint32_t)(p - D.text) + 8, 0, "7", 1);
+    check_doc(&D, "edit in the middle");
+    CHECK(!D.stats.full && D.stats.relexed <= 3 && D.stats.reparsed <= 2,
+          "edit in the middle: full %d, relexed %d, reparsed %d", D.stats.full, D.stats.relexed, D.stats.reparsed);
+    doc_free(&D);
+    free(text);
+}
+
+/* edições aleatórias com pedaços que abrem e fecham construções; metade delas
+   é desfeita logo em seguida, para o documento voltar a parsear e as árvores
+   serem comparadas de novo */
+static void random_edits(void) {
+    static const char* bits[] = {
+        ";", "x", " ", "\n", "1", "(", ")", "{", "}", "\"", "=", "+", "else ", "if (x) ",
+        "output(1);", "loop (0) {}", "y = x;", "func h() { return 1; }", "[", "]", ",", ":"
+    };
+    const int nbits = (int)(sizeof(bits)/sizeof(bits[0]));
+    uint32_t seed = 12345;
+    Doc D;
+    doc_init(&D, &g_syms);
+    doc_set(&D, PROG, (uint32_t)strlen(PROG));
+    char what[64], old[4];
+    int compared = 0, broken = 0;
+    for (int i=0; i<4000 && !g_fail; i++) {
+        seed = seed * 1103515245u + 12345u;
+        uint32_t r = seed >> 8;
+        uint32_t at = D.len ? r % (D.len + 1) : 0;
+        uint32_t del = (r >> 12) % 4;
+        if (del > D.len - at) del = D.len - at;
+        const char* ins = bits[(r >> 16) % nbits];
+        if ((r & 7) == 0) ins = "";
+        uint32_t il = (uint32_t)strlen(ins);
+        memcpy(old, D.text + at, del);
+        doc_edit(&D, at, del, ins, il);
+        snprintf(what, sizeof(what), "random edit %d", i);
+        check_doc(&D, what);
+        if (r & 0x800000) {
+            doc_edit(&D, at, il, old, del);
+            snprintf(what, sizeof(what), "undo random edit %d", i);
+            check_doc(&D, what);
+        }
+        compared += doc_ok(&D);
+        broken = doc_ok(&D) ? 0 : broken + 1;
+        if (broken > 4 || D.len > 2000) doc_edit(&D, 0, D.len, PROG, (uint32_t)strlen(PROG));
+    }
+    CHECK(compared > 1000, "random edits: only %d edits left a document that parses", compared);
+    doc_free(&D);
+}
+
+int main(void) {
+    symtab_init(&g_syms);
+    scripted();
+    incremental();
+    random_edits();
+    symtab_free(&g_syms);
+    if (g_fail) { fprintf(stderr, "%d failed\n", g_fail); return 1; }
+    return 0;
+}
@@ -0,0 +1,83 @@
+/* pool_for roda cada índice de [0, n) uma vez só, com qualquer número de
+   threads (inclusive mais threads que índices e n == 0); um trecho lento é
+   roubado pelos outros workers; o pool aguenta muitas rodadas seguidas e a
+   fila do pool_submit cresce sem perder tarefa. */
+#include "pool.h"
+#include <time.h>
+
+static int g_fail;
+#define CHECK(c, ...) do { if (!(c)) { g_fail++; fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+                                       fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); } } while (0)
+
+typedef struct { int* hits; pthread_t* who; int slow; } Work;
+
+static void count_index(void* arg, int i) {
+    Work* W = (Work*)arg;
+    __atomic_fetch_add(&W->hits[i], 1, __ATOMIC_RELAXED);
+    if (W->who) W->who[i] = pthread_self();
+    if (i < W->slow) { struct timespec ts = { 0, 1000000 }; nanosleep(&ts, NULL); }
+}
+
+static void once_each(int nthreads, int n) {
+    Pool P;
+    pool_init(&P, nthreads);
+    Work W = { (int*)calloc((size_t)n + 1, sizeof(int)), NULL, 0 };
+    pool_for(&P, n, count_index, &W);
+    int bad = 0;
+    for (int i=0;i<n;i++) bad += W.hits[i] != 1;
+    CHECK(bad == 0, "%d threads, n %d: %d indices did not run exactly once", nthreads, n, bad);
+    free(W.hits);
+    pool_free(&P);
+}
+
+/* 4 workers, n = 256: o trecho do worker 0 ([0, 64)) leva 1 ms por índice e
+   os outros acabam na hora, então parte dele tem de rodar em outra thread */
+static void steals(void) {
+    enum { N = 256, SLOW = 64 };
+    Pool P;
+    pool_init(&P, 4);
+    Work W = { (int*)calloc(N, sizeof(int)), (pthread_t*)calloc(N, sizeof(pthread_t)), SLOW };
+    pool_for(&P, N, count_index, &W);
+    int moved = 0, bad = 0;
+    for (int i=0;i<N;i++) bad += W.hits[i] != 1;
+    for (int i=1;i<SLOW;i++) moved += !pthread_equal(W.who[i], W.who[0]);
+    CHECK(bad == 0, "steal: %d indices did not run exactly once", bad);
+    CHECK(P.nthreads < 2 || moved > 0, "steal: no index of the slow range ran on another thread");
+    free(W.hits); free(W.who);
+    pool_free(&P);
+}
+
+static void add_one(void* arg) { __atomic_fetch_add((int*)arg, 1, __ATOMIC_RELAXED); }
+
+/* um pool, muitas rodadas de pool_for e de pool_submit (anel passa de 64) */
+static void reuse(void) {
+    Pool P;
+    pool_init(&P, 3);
+    int hits[50];
+    for (int round=0; round<2000; round++) {
+        int n = round % 50;
+        memset(hits, 0, sizeof(hits));
+        Work W = { hits, NULL, 0 };
+        pool_for(&P, n, count_index, &W);
+        int bad = 0;
+        for (int i=0;i<n;i++) bad += hits[i] != 1;
+        CHECK(bad == 0, "round %d: %d of %d indices did not run exactly once", round, bad, n);
+        if (bad) break;
+    }
+    int counter = 0;
+    for (int i=0;i<1000;i++) pool_submit(&P, add_one, &counter);
+    pool_wait(&P);
+    CHECK(counter == 1000, "pool_submit: %d of 1000 tasks ran", counter);
+    pool_free(&P);
+}
+
+int main(void) {
+    static const int threads[] = { 1, 2, 3, 8, 64 };
+    static const int sizes[] = { 0, 1, 2, 7, 1000, 100003 };
+    for (int t=0; t<5; t++)
+        for (int s=0; s<6; s++) once_each(threads[t], sizes[s]);
+    steals();
+    reuse();
+    if (g_fail) { fprintf(stderr, "%d failed\n", g_fail); return 1; }
+    return 0;
+}
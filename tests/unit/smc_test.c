@@ -0,0 +1,241 @@
+/* Cache .smc: um arquivo em dia é carregado e roda igual ao fonte; velho,
+   truncado ou corrompido (tabelas, operandos, alvos de salto, pilha) é recusado
+   por smc_load, e o fonte volta a ser compilado. */
+#include "lexer.h"
+#include "io.h"
+#include "parser.h"
+#include "opt.h"
+#include "vec.h"
+#include "vm.h"
+#include "compiler.h"
+#include "jit.h"
+#include "cache.h"
+#include "prof.h"
+#include "exec.h"
+
+static int g_fail;
+#define CHECK(c, ...) do { if (!(c)) { g_fail++; fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+                                       fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); } } while (0)
+
+static char g_dir[] = "/tmp/smc_test.XXXXXX";
+static char g_sm[128], g_smc[128], g_out[128];
+
+static void write_file(const char* path, const void* p, size_t n) {
+    FILE* f = fopen(path, "wb");
+    if (!f || fwrite(p, 1, n, f) != n) { perror(path); exit(2); }
+    fclose(f);
+}
+
+static char* read_file(const char* path, size_t* n) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    *n = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* p = (char*)malloc(*n + 1);
+    if (fread(p, 1, *n, f) != *n) { perror(path); exit(2); }
+    p[*n] = 0;
+    fclose(f);
+    return p;
+}
+
+/* roda g_sm como o sun (bytecode, com cache); a saída vai para out */
+static void run(char* out, size_t cap, int* from_cache) {
+    Unit U;
+    Error E;
+    const char* phase = "";
+    out[0] = 0;
+    if (!unit_load(&U, g_sm, EXEC_BYTECODE, 1, &E, &phase)) {
+        print_error_and_flush(&E, phase);
+        unit_free(&U);
+        return;
+    }
+    *from_cache = U.smc.mem != NULL;
+    int fd = open(g_out, O_RDWR|O_CREAT|O_TRUNC, 0644);
+    Interp* I = (Interp*)malloc(sizeof(Interp));
+    interp_init(I, fd, -1, 0);
+    program_run(&U.prog, I);
+    if (I->err.kind) print_error_and_flush(&I->err, "runtime");
+    interp_free(I);
+    free(I);
+    close(fd);
+    unit_free(&U);
+    size_t n;
+    char* p = read_file(g_out, &n);
+    snprintf(out, cap, "%s", p);
+    free(p);
+}
+
+/* grava src e o compila, deixando o .smc */
+static void prepare(const char* src) {
+    char out[256];
+    int cached = 0;
+    unlink(g_smc);
+    write_file(g_sm, src, strlen(src));
+    run(out, sizeof(out), &cached);
+    CHECK(!cached && access(g_smc, R_OK) == 0, "no .smc written for %s", src);
+}
+
+/* partes do .smc em memória */
+typedef struct {
+    SmcHeader* h;
+    int32_t* code;
+    LoopInfo* loops;
+    FuncProto* funcs;
+    int32_t* lsyms;
+    uint32_t* symoff;
+    char* names;
+    SmcConst* consts;
+    char* base;
+} Smc;
+
+typedef void (*Mutation)(Smc* F);
+
+/* src compilado, F mutado: smc_load recusa e a execução recompila e dá want */
+static void expect_reject(const char* what, const char* src, const char* want, Mutation mut) {
+    prepare(src);
+    size_t n;
+    char* b = read_file(g_smc, &n);
+    Smc F;
+    F.base = b;
+    F.h = (SmcHeader*)b;
+    F.code = (int32_t*)(b + F.h->off_code);
+    F.loops = (LoopInfo*)(b + F.h->off_loops);
+    F.funcs = (FuncProto*)(b + F.h->off_funcs);
+    F.lsyms = (int32_t*)(b + F.h->off_lsyms);
+    F.symoff = (uint32_t*)(b + F.h->off_symoff);
+    F.names = b + F.h->off_names;
+    F.consts = (SmcConst*)(b + F.h->off_consts);
+    mut(&F);
+    write_file(g_smc, b, n);
+    free(b);
+
+    Source S;
+    SmcMap M;
+    Chunk C;
+    SymTab T;
+    if (!source_open(&S, g_sm)) { perror(g_sm); exit(2); }
+    int ok = smc_load(&M, g_smc, &S, &C, &T);
+    CHECK(!ok, "%s: corrupted .smc accepted", what);
+    if (ok) smc_unmap(&M, &S);
+    source_close(&S);
+
+    char out[256];
+    int cached = 1;
+    run(out, sizeof(out), &cached);
+    CHECK(!cached && strcmp(out, want) == 0, "%s: got '%s' (from cache: %d)", what, out, cached);
+}
+
+/* ---- mutações ---- */
+#define EXPECT_OP(F, w, op) CHECK((F)->code[w] == (op), "code[%d] is %d, expected %d", (int)(w), (F)->code[w], (int)(op))
+
+// x = "hi"; output(x);  ->  CONST 0, STORE x, LOAD x, PRINT 1, NEWLINE, HALT
+static const char* P_STR = "x = \"hi\";\noutput(x);\n";
+static void m_const(Smc* F)      { EXPECT_OP(F, 0, BC_CONST); F->code[1] = (int32_t)F->h->nconsts; }
+static void m_slot(Smc* F)       { EXPECT_OP(F, 2, BC_STORE); F->code[3] = (int32_t)F->h->nsyms; }
+static void m_underflow(Smc* F)  { F->code[0] = BC_POP; F->code[1] = BC_POP; }
+static void m_opcode(Smc* F)     { F->code[0] = BC_HALT + 1; }
+static void m_quick(Smc* F)      { F->code[2] = BC_ADD_II; }
+static void m_ret_main(Smc* F)   { EXPECT_OP(F, F->h->ncode - 1, BC_HALT); F->code[F->h->ncode - 1] = BC_RET; }
+static void m_no_halt(Smc* F)    { F->code[F->h->ncode - 1] = BC_NEWLINE; }
+static void m_str_refs(Smc* F)   { ((Str*)(F->base + F->consts[0].val))->refs = 1; }
+static void m_const_type(Smc* F) { F->consts[0].type = V_MAP; }
+static void m_sym_off(Smc* F)    { F->symoff[0] = F->h->names_len; }
+static void m_names_nul(Smc* F)  { F->names[F->h->names_len - 1] = 'x'; }
+static void m_fits(Smc* F)       { F->h->nconsts = 1u << 24; }
+static void m_align(Smc* F)      { F->h->off_code += 4; }
+static void m_pos(Smc* F)        { ((uint32_t*)(F->base + F->h->off_pos))[0] = F->h->src_len + 1; }
+static void m_max_stack(Smc* F)  { F->h->max_stack = 0; }
+
+// o BC_JUMP de volta fica nas duas últimas palavras do loop
+static const char* P_LOOP = "i = 0;\nloop (i < 3) { i = i + 1; }\noutput(i);\n";
+static void m_jump_out(Smc* F)   { int32_t j = F->loops[0].end - 2; EXPECT_OP(F, j, BC_JUMP); F->code[j+1] = (int32_t)F->h->ncode + 5; }
+static void m_jump_mid(Smc* F)   { int32_t j = F->loops[0].end - 2; EXPECT_OP(F, j, BC_JUMP); F->code[j+1] = -1; }
+static void m_loop_id(Smc* F)    { EXPECT_OP(F, F->loops[0].top, BC_LOOP_CHECK); F->code[F->loops[0].top + 1] = (int32_t)F->h->nloops; }
+static void m_loop_top(Smc* F)   { F->loops[0].top += 2; }
+static void m_loop_end(Smc* F)   { F->loops[0].end = (int32_t)F->h->ncode + 1; }
+
+// main: INT 2, CALL_F f sym 1, PRINT 1, NEWLINE, HALT; depois o corpo de f
+static const char* P_FUNC = "func f(a) { return a + 1; }\noutput(f(2));\n";
+static void m_callee(Smc* F)     { EXPECT_OP(F, 2, BC_CALL_F); F->code[3] = (int32_t)F->h->nfuncs; }
+static void m_call_sym(Smc* F)   { EXPECT_OP(F, 2, BC_CALL_F); F->code[4] = (int32_t)F->h->nsyms; }
+static void m_entry(Smc* F)      { F->funcs[0].entry = (int32_t)F->h->ncode; }
+static void m_entry0(Smc* F)     { F->funcs[0].entry = 0; }
+static void m_nlocals(Smc* F)    { F->funcs[0].nlocals = (int32_t)F->h->max_locals + 1; }
+static void m_nparams(Smc* F)    { F->funcs[0].nparams = F->funcs[0].nlocals + 1; }
+static void m_fn_sym(Smc* F)     { F->funcs[0].sym = (int32_t)F->h->nsyms; }
+static void m_lsyms(Smc* F)      { F->lsyms[0] = (int32_t)F->h->nsyms; }
+static void m_fn_stack(Smc* F)   { F->funcs[0].max_stack = 1; }
+static void m_fn_slot(Smc* F)    { EXPECT_OP(F, F->funcs[0].entry, BC_LOAD); F->code[F->funcs[0].entry + 1] = F->funcs[0].nlocals; }
+
+// o BC_MAP_PUT só confere a altura: abaixo de chave e valor tem de estar o mapa
+static const char* P_MAP = "m = {1: 2};\noutput(m[1]);\n";
+static void m_map_new(Smc* F)    { EXPECT_OP(F, 0, BC_MAP_NEW); F->code[0] = BC_INT; }
+
+int main(void) {
+    if (!mkdtemp(g_dir)) { perror("mkdtemp"); return 2; }
+    snprintf(g_sm, sizeof(g_sm), "%s/t.sm", g_dir);
+    snprintf(g_smc, sizeof(g_smc), "%s/t.smc", g_dir);
+    snprintf(g_out, sizeof(g_out), "%s/out", g_dir);
+    char out[256];
+    int cached;
+
+    // ida e volta: a segunda execução vem do .smc
+    prepare(P_FUNC);
+    cached = 0;
+    run(out, sizeof(out), &cached);
+    CHECK(cached && strcmp(out, "3\n") == 0, "round trip: got '%s' (from cache: %d)", out, cached);
+
+    // fonte mudou (mesmo tamanho ou não): o .smc velho não vale
+    prepare(P_STR);
+    Source S;
+    SmcMap M;
+    Chunk C;
+    SymTab T;
+    source_from_string(&S, "x = \"hi\";\noutput(y);\n");
+    CHECK(!smc_load(&M, g_smc, &S, &C, &T), "hash: .smc of another source accepted");
+    write_file(g_sm, "x = \"ho\";\noutput(x);\n", 20);
+    cached = 1;
+    run(out, sizeof(out), &cached);
+    CHECK(!cached && strcmp(out, "ho\n") == 0, "same-size edit: got '%s' (from cache: %d)", out, cached);
+    write_file(g_sm, "x = \"hoo\";\noutput(x);\n", 21);
+    cached = 1;
+    run(out, sizeof(out), &cached);
+    CHECK(!cached && strcmp(out, "hoo\n") == 0, "edit: got '%s' (from cache: %d)", out, cached);
+
+    expect_reject("const index", P_STR, "hi\n", m_const);
+    expect_reject("global slot", P_STR, "hi\n", m_slot);
+    expect_reject("stack underflow", P_STR, "hi\n", m_underflow);
+    expect_reject("bad opcode", P_STR, "hi\n", m_opcode);
+    expect_reject("quickened opcode", P_STR, "hi\n", m_quick);
+    expect_reject("return in main", P_STR, "hi\n", m_ret_main);
+    expect_reject("falls off the end", P_STR, "hi\n", m_no_halt);
+    expect_reject("mortal string", P_STR, "hi\n", m_str_refs);
+    expect_reject("const type", P_STR, "hi\n", m_const_type);
+    expect_reject("symbol offset", P_STR, "hi\n", m_sym_off);
+    expect_reject("names end", P_STR, "hi\n", m_names_nul);
+    expect_reject("table past eof", P_STR, "hi\n", m_fits);
+    expect_reject("misaligned table", P_STR, "hi\n", m_align);
+    expect_reject("position", P_STR, "hi\n", m_pos);
+    expect_reject("max stack", P_STR, "hi\n", m_max_stack);
+    expect_reject("jump past code", P_LOOP, "3\n", m_jump_out);
+    expect_reject("negative jump", P_LOOP, "3\n", m_jump_mid);
+    expect_reject("loop index", P_LOOP, "3\n", m_loop_id);
+    expect_reject("loop top", P_LOOP, "3\n", m_loop_top);
+    expect_reject("loop end", P_LOOP, "3\n", m_loop_end);
+    expect_reject("callee", P_FUNC, "3\n", m_callee);
+    expect_reject("call name", P_FUNC, "3\n", m_call_sym);
+    expect_reject("entry past code", P_FUNC, "3\n", m_entry);
+    expect_reject("entry in main", P_FUNC, "3\n", m_entry0);
+    expect_reject("frame size", P_FUNC, "3\n", m_nlocals);
+    expect_reject("params", P_FUNC, "3\n", m_nparams);
+    expect_reject("function name", P_FUNC, "3\n", m_fn_sym);
+    expect_reject("local name", P_FUNC, "3\n", m_lsyms);
+    expect_reject("function stack", P_FUNC, "3\n", m_fn_stack);
+    expect_reject("local slot", P_FUNC, "3\n", m_fn_slot);
+    expect_reject("map under put", P_MAP, "2\n", m_map_new);
+
+    unlink(g_sm); unlink(g_smc); unlink(g_out); rmdir(g_dir);
+    if (g_fail) { fprintf(stderr, "%d failed\n", g_fail); return 1; }
+    return 0;
+}
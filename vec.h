@@ -0,0 +1,187 @@
+#ifndef VEC_H
+#define VEC_H
+#include <stdint.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* =================== Kernels de int32 =================== */
+/* O corpo dos built-ins de array (vm.h): sum, min/max, dot, fill e map com
+   constante. Com AVX2/SSE2 andam 8/4 ints por vez e o resto sai no laço
+   escalar. A aritmética dá a volta em 32 bits como + e * da linguagem (as
+   contas escalares passam por uint32_t para não cair em overflow com sinal).
+   Loads e stores não alinhados: o array não promete alinhamento. */
+
+#if defined(__AVX2__)
+#define VEC_W 8
+typedef __m256i vec_t;
+static vec_t   vec_load(const int32_t* p)        { return _mm256_loadu_si256((const __m256i*)p); }
+static void    vec_store(int32_t* p, vec_t v)    { _mm256_storeu_si256((__m256i*)p, v); }
+static vec_t   vec_set1(int32_t x)               { return _mm256_set1_epi32(x); }
+static vec_t   vec_add32(vec_t a, vec_t b)       { return _mm256_add_epi32(a, b); }
+static vec_t   vec_mul32(vec_t a, vec_t b)       { return _mm256_mullo_epi32(a, b); }
+static vec_t   vec_min32(vec_t a, vec_t b)       { return _mm256_min_epi32(a, b); }
+static vec_t   vec_max32(vec_t a, vec_t b)       { return _mm256_max_epi32(a, b); }
+#elif defined(__SSE2__)
+#define VEC_W 4
+typedef __m128i vec_t;
+static vec_t   vec_load(const int32_t* p)        { return _mm_loadu_si128((const __m128i*)p); }
+static void    vec_store(int32_t* p, vec_t v)    { _mm_storeu_si128((__m128i*)p, v); }
+static vec_t   vec_set1(int32_t x)               { return _mm_set1_epi32(x); }
+static vec_t   vec_add32(vec_t a, vec_t b)       { return _mm_add_epi32(a, b); }
+/* SSE2 não tem pmulld nem pminsd: os 32 bits de baixo do produto saem de dois
+   pmuludq (pares e ímpares), e min/max é compara-e-mistura */
+static vec_t vec_mul32(vec_t a, vec_t b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd  = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0,0,2,0)),
+                              _mm_shuffle_epi32(odd,  _MM_SHUFFLE(0,0,2,0)));
+}
+static vec_t vec_min32(vec_t a, vec_t b) {
+    __m128i gt = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a));
+}
+static vec_t vec_max32(vec_t a, vec_t b) {
+    __m128i gt = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+}
+#endif
+
+static int32_t vec_wrap_add(int32_t a, int32_t b) { return (int32_t)((uint32_t)a + (uint32_t)b); }
+static int32_t vec_wrap_mul(int32_t a, int32_t b) { return (int32_t)((uint32_t)a * (uint32_t)b); }
+
+static int32_t vec_sum(const int32_t* p, int n) {
+    int i = 0;
+    int32_t s = 0;
+#ifdef VEC_W
+    if (n >= 2*VEC_W) {
+        vec_t a0 = vec_set1(0), a1 = vec_set1(0); // dois acumuladores: esconde a latência do add
+        for (; i + 2*VEC_W <= n; i += 2*VEC_W) {
+            a0 = vec_add32(a0, vec_load(p + i));
+            a1 = vec_add32(a1, vec_load(p + i + VEC_W));
+        }
+        int32_t lane[VEC_W];
+        vec_store(lane, vec_add32(a0, a1));
+        for (int k=0;k<VEC_W;k++) s = vec_wrap_add(s, lane[k]);
+    }
+#endif
+    for (; i < n; i++) s = vec_wrap_add(s, p[i]);
+    return s;
+}
+
+/* n > 0 */
+static int32_t vec_min(const int32_t* p, int n) {
+    int i = 0;
+    int32_t m = p[0];
+#ifdef VEC_W
+    if (n >= VEC_W) {
+        vec_t a = vec_load(p);
+        for (i = VEC_W; i + VEC_W <= n; i += VEC_W) a = vec_min32(a, vec_load(p + i));
+        int32_t lane[VEC_W];
+        vec_store(lane, a);
+        for (int k=0;k<VEC_W;k++) if (lane[k] < m) m = lane[k];
+    }
+#endif
+    for (; i < n; i++) if (p[i] < m) m = p[i];
+    return m;
+}
+
+static int32_t vec_max(const int32_t* p, int n) {
+    int i = 0;
+    int32_t m = p[0];
+#ifdef VEC_W
+    if (n >= VEC_W) {
+        vec_t a = vec_load(p);
+        for (i = VEC_W; i + VEC_W <= n; i += VEC_W) a = vec_max32(a, vec_load(p + i));
+        int32_t lane[VEC_W];
+        vec_store(lane, a);
+        for (int k=0;k<VEC_W;k++) if (lane[k] > m) m = lane[k];
+    }
+#endif
+    for (; i < n; i++) if (p[i] > m) m = p[i];
+    return m;
+}
+
+static int32_t vec_dot(const int32_t* a, const int32_t* b, int n) {
+    int i = 0;
+    int32_t s = 0;
+#ifdef VEC_W
+    if (n >= VEC_W) {
+        vec_t acc = vec_set1(0);
+        for (; i + VEC_W <= n; i += VEC_W) acc = vec_add32(acc, vec_mul32(vec_load(a + i), vec_load(b + i)));
+        int32_t lane[VEC_W];
+        vec_store(lane, acc);
+        for (int k=0;k<VEC_W;k++) s = vec_wrap_add(s, lane[k]);
+    }
+#endif
+    for (; i < n; i++) s = vec_wrap_add(s, vec_wrap_mul(a[i], b[i]));
+    return s;
+}
+
+static void vec_fill(int32_t* p, int n, int32_t x) {
+    int i = 0;
+#ifdef VEC_W
+    vec_t v = vec_set1(x);
+    for (; i + VEC_W <= n; i += VEC_W) vec_store(p + i, v);
+#endif
+    for (; i < n; i++) p[i] = x;
+}
+
+static void vec_add_k(int32_t* p, int n, int32_t k) {
+    int i = 0;
+#ifdef VEC_W
+    vec_t v = vec_set1(k);
+    for (; i + VEC_W <= n; i += VEC_W) vec_store(p + i, vec_add32(vec_load(p + i), v));
+#endif
+    for (; i < n; i++) p[i] = vec_wrap_add(p[i], k);
+}
+
+static void vec_mul_k(int32_t* p, int n, int32_t k) {
+    int i = 0;
+#ifdef VEC_W
+    vec_t v = vec_set1(k);
+    for (; i + VEC_W <= n; i += VEC_W) vec_store(p + i, vec_mul32(vec_load(p + i), v));
+#endif
+    for (; i < n; i++) p[i] = vec_wrap_mul(p[i], k);
+}
+
+/* =================== Grupos de bytes =================== */
+/* A sonda dos mapas (vm.h) olha 16 bytes de controle por vez: máscara com o
+   bit k ligado onde p[k] == b, ou onde p[k] tem o bit de cima (slot livre).
+   Com SSE2 é um pcmpeqb/pmovmskb. */
+#define VEC_GROUP 16
+
+static uint32_t vec_match16(const uint8_t* p, uint8_t b) {
+#if defined(__SSE2__)
+    __m128i g = _mm_loadu_si128((const __m128i*)p);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)b)));
+#else
+    uint32_t m = 0;
+    for (int k=0;k<VEC_GROUP;k++) m |= (uint32_t)(p[k] == b) << k;
+    return m;
+#endif
+}
+
+static uint32_t vec_high16(const uint8_t* p) {
+#if defined(__SSE2__)
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)p));
+#else
+    uint32_t m = 0;
+    for (int k=0;k<VEC_GROUP;k++) m |= (uint32_t)(p[k] >> 7) << k;
+    return m;
+#endif
+}
+
+static int vec_ctz(uint32_t x) { // x != 0
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(x);
+#else
+    int n = 0;
+    while (!(x & 1)) { x >>= 1; n++; }
+    return n;
+#endif
+}
+
+#endif
@@ -5,72 +5,530 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdarg.h>  
+#include <stdint.h>
+#include <setjmp.h>
 
 /* =================== Config =================== */
-#define MAX_TOKEN_LENGTH 128
-#define MAX_TOKENS       2048
-#define MAX_VARS         512
 #define MAX_LINE         2048
+#define FUEL_DEFAULT     100000000  // voltas de loop por execução (--fuel muda; 0 = sem limite)
+#define FUEL_SLICE       100000     // voltas por fatia
+#define CALL_MAX         1000       // chamadas de função aninhadas (return f(...) não conta)
+#define WALK_MAX_DEPTH   10000      // walker: níveis de eval mais chamadas na pilha de C
 
-typedef enum { V_INT, V_STRING } ValType;
+#if defined(__GNUC__) || defined(__clang__)
+#define SUN_NORETURN __attribute__((noreturn))
+#define SUN_NOINLINE __attribute__((noinline))
+#else
+#define SUN_NORETURN
+#define SUN_NOINLINE
+#endif
+
+/* =================== Valores =================== */
+typedef enum { V_INT, V_STRING, V_ARRAY, V_MAP } ValType;
+
+/* String com tamanho explícito (data termina em 0 só por conveniência).
+   refs < 0 marca literal internado: imortal, nunca é liberado nem contado.
+   Imutável enquanto compartilhada; com refs == 1 quem a tem pode crescer no
+   lugar até cap (ver str_append). */
+typedef struct Str {
+    int refs;
+    int len, cap;
+    unsigned hash;
+    char data[];
+} Str;
+
+/* Array de int contíguo. Compartilhado por contagem de referências e copiado
+   na primeira escrita quando refs > 1 (arr_own), então b = a continua sendo
+   uma cópia para quem lê o programa. */
+typedef struct Arr {
+    int refs;
+    int len;
+    int32_t data[];
+} Arr;
+
+#define ARR_MAX (1 << 26) // elementos
+
+struct Map;
 
 typedef struct {
     ValType type;
-    int i;
-    char s[512];
+    union { int i; Str* s; Arr* a; struct Map* m; };
 } Value;
 
-typedef struct { char name[64]; Value val; } Var;
-static Var g_vars[MAX_VARS]; static int g_varc=0;
+/* Mapa de chave int ou string para qualquer valor, no formato swiss table:
+   endereçamento aberto com um byte de controle por slot, MAP_EMPTY,
+   MAP_DELETED (lápide) ou, ocupado, os 7 bits de baixo do hash. A sonda anda
+   de grupo em grupo de VEC_GROUP slots e compara o byte com o grupo inteiro de
+   uma vez (vec_match16); só os candidatos comparam a chave. Os primeiros
+   VEC_GROUP bytes de ctrl se repetem no fim, então um grupo que passa do último
+   slot é lido direto. Semântica de valor como a dos arrays (map_own). */
+#define MAP_EMPTY   0x80
+#define MAP_DELETED 0xFE
+
+typedef struct { Value key, val; } MapSlot;
+
+typedef struct Map {
+    int refs;
+    uint32_t count;  // chaves
+    uint32_t used;   // chaves + lápides
+    uint32_t cap;    // potência de 2, >= VEC_GROUP
+    uint8_t* ctrl;   // cap + VEC_GROUP bytes
+    MapSlot* slots;
+} Map;
+
+static Str* str_alloc(int len) {
+    Str* s = (Str*)malloc(sizeof(Str) + len + 1);
+    s->refs = 1; s->len = len; s->cap = len; s->hash = 0; s->data[len] = 0;
+    return s;
+}
+static Str* str_new(const char* p, int len) {
+    Str* s = str_alloc(len);
+    memcpy(s->data, p, len);
+    return s;
+}
+
+/* acrescenta no fim de uma string com refs == 1; a capacidade dobra, então
+   uma sequência de appends custa O(1) amortizado */
+static Str* str_append(Str* s, const char* p, int n) {
+    if (s->len + n > s->cap) {
+        int cap = s->cap*2 > s->len + n ? s->cap*2 : s->len + n;
+        if (cap < 32) cap = 32;
+        s = (Str*)realloc(s, sizeof(Str) + cap + 1);
+        s->cap = cap;
+    }
+    memcpy(s->data + s->len, p, n);
+    s->len += n;
+    s->data[s->len] = 0;
+    s->hash = 0;
+    return s;
+}
+
+static Arr* arr_alloc(int len) {
+    Arr* a = (Arr*)malloc(sizeof(Arr) + sizeof(int32_t) * (size_t)len);
+    a->refs = 1; a->len = len;
+    return a;
+}
+
+static void map_free(Map* m);
 
-static Var* var_find(const char* name) {
-    for (int i=0;i<g_varc;i++) if (strcmp(g_vars[i].name, name)==0) return &g_vars[i];
-    return NULL;
+static void val_retain(Value v) {
+    if (v.type==V_STRING) { if (v.s->refs > 0) v.s->refs++; }
+    else if (v.type==V_ARRAY) v.a->refs++;
+    else if (v.type==V_MAP) v.m->refs++;
 }
-static Var* var_ensure(const char* name) {
-    Var* v = var_find(name);
-    if (v) return v;
-    if (g_varc>=MAX_VARS) return NULL;
-    strncpy(g_vars[g_varc].name, name, sizeof(g_vars[g_varc].name)-1);
-    g_vars[g_varc].name[sizeof(g_vars[g_varc].name)-1]=0;
-    g_vars[g_varc].val.type=V_INT; g_vars[g_varc].val.i=0; g_vars[g_varc].val.s[0]=0;
-    return &g_vars[g_varc++];
+static void val_release(Value v) {
+    if (v.type==V_STRING) { if (v.s->refs > 0 && --v.s->refs == 0) free(v.s); }
+    else if (v.type==V_ARRAY) { if (--v.a->refs == 0) free(v.a); }
+    else if (v.type==V_MAP && --v.m->refs == 0) map_free(v.m);
+}
+
+/* literais internados: um Str por conteúdo dentro de uma Ast (A->itab), comparados
+   por ponteiro; vivem até ast_free */
+static void intern_insert(Ast* A, Str* s) {
+    uint32_t i = s->hash & (A->icap-1);
+    while (A->itab[i]) i = (i+1) & (A->icap-1);
+    A->itab[i] = s;
+}
+
+static Str* str_intern(Ast* A, const char* p, int len) {
+    unsigned h = hash_bytes(p, len);
+    if (A->icap) {
+        for (uint32_t i = h & (A->icap-1); A->itab[i]; i = (i+1) & (A->icap-1)) {
+            Str* s = A->itab[i];
+            if (s->hash==h && s->len==len && memcmp(s->data, p, len)==0) return s;
+        }
+    }
+    if ((A->icount+1)*2 > A->icap) {
+        Str** old = A->itab; uint32_t oldcap = A->icap;
+        A->icap = oldcap ? oldcap*2 : 256;
+        A->itab = (Str**)calloc(A->icap, sizeof(Str*));
+        for (uint32_t i=0;i<oldcap;i++) if (old[i]) intern_insert(A, old[i]);
+        free(old);
+    }
+    Str* s = str_new(p, len);
+    s->refs = -1; s->hash = h;
+    intern_insert(A, s);
+    A->icount++;
+    return s;
+}
+
+static int str_eq(const Str* a, const Str* b) {
+    if (a == b) return 1;
+    if (a->refs < 0 && b->refs < 0) return 0; // dois internados distintos
+    return a->len == b->len && memcmp(a->data, b->data, a->len) == 0;
+}
+static int str_cmp(const Str* a, const Str* b) {
+    if (a == b) return 0;
+    int n = a->len < b->len ? a->len : b->len;
+    int c = memcmp(a->data, b->data, n);
+    return c ? c : (a->len > b->len) - (a->len < b->len);
+}
+
+static Value V_int(int x){ Value v; v.type=V_INT; v.i=x; return v; }
+static Value V_sobj(Str* s){ Value v; v.type=V_STRING; v.s=s; return v; }
+static Value V_str(const char* s){ return V_sobj(str_new(s, (int)strlen(s))); }
+static Value V_arr(Arr* a){ Value v; v.type=V_ARRAY; v.a=a; return v; }
+static Value V_map(Map* m){ Value v; v.type=V_MAP; v.m=m; return v; }
+
+/* =================== Mapas =================== */
+/* hash guardado na string: literais internados já vêm com ele, os outros
+   calculam na primeira vez (str_append zera quando o conteúdo muda) */
+static uint32_t str_hash(Str* s) {
+    if (!s->hash && s->refs >= 0) s->hash = hash_bytes(s->data, s->len);
+    return s->hash;
+}
+
+static int map_key_ok(Value k) { return k.type==V_INT || k.type==V_STRING; }
+
+static uint32_t map_hash(Value k) {
+    if (k.type==V_INT) return (uint32_t)(((uint64_t)(uint32_t)k.i * 0x9E3779B97F4A7C15ull) >> 32);
+    return str_hash(k.s);
+}
+
+/* b vem de map_hash, então os dois hashes de string já estão calculados */
+static int map_key_eq(Value a, Value b) {
+    if (a.type != b.type) return 0;
+    if (a.type==V_INT) return a.i == b.i;
+    return a.s == b.s || (a.s->hash == b.s->hash && a.s->len == b.s->len && memcmp(a.s->data, b.s->data, a.s->len) == 0);
+}
+
+static Map* map_alloc(uint32_t cap) {
+    Map* m = (Map*)malloc(sizeof(Map));
+    m->refs = 1; m->count = m->used = 0; m->cap = cap;
+    m->ctrl = (uint8_t*)malloc(cap + VEC_GROUP);
+    memset(m->ctrl, MAP_EMPTY, cap + VEC_GROUP);
+    m->slots = (MapSlot*)malloc(sizeof(MapSlot) * cap);
+    return m;
+}
+
+/* vazio, com lugar para n chaves sem crescer (carga máxima de 7/8) */
+static Map* map_new(uint32_t n) {
+    uint32_t cap = VEC_GROUP;
+    while (cap - cap/8 < n) cap *= 2;
+    return map_alloc(cap);
+}
+
+static void map_free(Map* m) {
+    for (uint32_t i=0;i<m->cap;i++)
+        if (!(m->ctrl[i] & 0x80)) { val_release(m->slots[i].key); val_release(m->slots[i].val); }
+    free(m->ctrl); free(m->slots); free(m);
+}
+
+static void map_set_ctrl(Map* m, uint32_t i, uint8_t c) {
+    m->ctrl[i] = c;
+    if (i < VEC_GROUP) m->ctrl[m->cap + i] = c; // espelho
+}
+
+/* slot da chave ou -1. Grupos em passos triangulares (16, 32, 48, ...): com cap
+   potência de 2 passa por todos, e um grupo com slot vazio encerra a busca. */
+static int map_find(const Map* m, Value k, uint32_t h) {
+    uint32_t mask = m->cap - 1, pos = (h >> 7) & mask, step = 0;
+    uint8_t h2 = (uint8_t)(h & 0x7f);
+    for (;;) {
+        const uint8_t* g = m->ctrl + pos;
+        for (uint32_t hit = vec_match16(g, h2); hit; hit &= hit - 1) {
+            uint32_t i = (pos + (uint32_t)vec_ctz(hit)) & mask;
+            if (map_key_eq(m->slots[i].key, k)) return (int)i;
+        }
+        if (vec_match16(g, MAP_EMPTY)) return -1;
+        step += VEC_GROUP;
+        pos = (pos + step) & mask;
+    }
+}
+
+/* primeiro slot vazio ou lápide na sonda de h */
+static uint32_t map_free_slot(const Map* m, uint32_t h) {
+    uint32_t mask = m->cap - 1, pos = (h >> 7) & mask, step = 0;
+    for (;;) {
+        uint32_t free_ = vec_high16(m->ctrl + pos);
+        if (free_) return (pos + (uint32_t)vec_ctz(free_)) & mask;
+        step += VEC_GROUP;
+        pos = (pos + step) & mask;
+    }
+}
+
+/* reinsere tudo numa tabela de cap slots (as lápides somem) */
+static void map_rehash(Map* m, uint32_t cap) {
+    uint8_t* ctrl = m->ctrl; MapSlot* slots = m->slots;
+    uint32_t old = m->cap;
+    m->cap = cap; m->used = m->count;
+    m->ctrl = (uint8_t*)malloc(cap + VEC_GROUP);
+    memset(m->ctrl, MAP_EMPTY, cap + VEC_GROUP);
+    m->slots = (MapSlot*)malloc(sizeof(MapSlot) * cap);
+    for (uint32_t i=0;i<old;i++) {
+        if (ctrl[i] & 0x80) continue;
+        uint32_t h = map_hash(slots[i].key), j = map_free_slot(m, h);
+        map_set_ctrl(m, j, (uint8_t)(h & 0x7f));
+        m->slots[j] = slots[i];
+    }
+    free(ctrl); free(slots);
+}
+
+/* m[k] = v, ficando com k e v (a chave é solta se já estava lá) */
+static void map_put(Map* m, Value k, uint32_t h, Value v) {
+    int i = map_find(m, k, h);
+    if (i >= 0) {
+        val_release(m->slots[i].val);
+        m->slots[i].val = v;
+        val_release(k);
+        return;
+    }
+    uint32_t max = m->cap - m->cap/8;
+    if (m->used + 1 > max) map_rehash(m, m->count + 1 > max/2 ? m->cap*2 : m->cap); // muitas lápides: só limpa
+    uint32_t j = map_free_slot(m, h);
+    if (m->ctrl[j] == MAP_EMPTY) m->used++;
+    map_set_ctrl(m, j, (uint8_t)(h & 0x7f));
+    m->slots[j].key = k; m->slots[j].val = v;
+    m->count++;
+}
+
+/* 1 se a chave estava lá */
+static int map_del(Map* m, Value k, uint32_t h) {
+    int i = map_find(m, k, h);
+    if (i < 0) return 0;
+    val_release(m->slots[i].key); val_release(m->slots[i].val);
+    map_set_ctrl(m, (uint32_t)i, MAP_DELETED);
+    m->count--;
+    return 1;
+}
+
+/* O slot de uma variável é o id do seu símbolo, então o acesso em tempo de
+   execução é I->vars[slot]. */
+typedef struct { const char* name; Value val; int defined; } Var;
+
+/* =================== Funções =================== */
+/* Funções do programa por id de símbolo (funções e variáveis não dividem
+   nomes). Cada entrada guarda a Ast que a definiu: na REPL uma entrada chama
+   funções de entradas anteriores. */
+typedef struct { const Ast* A; const AstFunc* fn; } FuncRef;
+
+typedef struct {
+    FuncRef* by_sym; uint32_t cap; // A == NULL: o símbolo não é função
+    int max_locals;
+} FuncTab;
+
+/* cópia de base (ou vazia) */
+static void functab_init(FuncTab* T, const FuncTab* base) {
+    memset(T, 0, sizeof(*T));
+    if (!base || !base->cap) return;
+    T->cap = base->cap; T->max_locals = base->max_locals;
+    T->by_sym = (FuncRef*)malloc(sizeof(FuncRef)*T->cap);
+    memcpy(T->by_sym, base->by_sym, sizeof(FuncRef)*T->cap);
+}
+
+static void functab_free(FuncTab* T) { free(T->by_sym); memset(T, 0, sizeof(*T)); }
+
+/* a última definição de um nome vale */
+static void functab_add(FuncTab* T, const Ast* A, const AstFunc* fn) {
+    uint32_t sym = A->nodes[fn->node].lit;
+    if (sym >= T->cap) {
+        uint32_t cap = T->cap ? T->cap : 64;
+        while (sym >= cap) cap *= 2;
+        T->by_sym = (FuncRef*)realloc(T->by_sym, sizeof(FuncRef)*cap);
+        memset(T->by_sym + T->cap, 0, sizeof(FuncRef)*(cap - T->cap));
+        T->cap = cap;
+    }
+    T->by_sym[sym].A = A; T->by_sym[sym].fn = fn;
+    if (fn->nlocals > T->max_locals) T->max_locals = fn->nlocals;
+}
+
+static const FuncRef* func_lookup(const FuncTab* T, uint32_t sym) {
+    return T && sym < T->cap && T->by_sym[sym].A ? &T->by_sym[sym] : NULL;
+}
+
+/* =================== Interpretador =================== */
+/* Todo o estado de uma execução: variáveis, erro e E/S. O programa (Ast já
+   resolvida, Chunk) só é lido, então várias Interp podem rodar o mesmo programa
+   ao mesmo tempo em threads diferentes.
+   Combustível: cada volta de loop gasta uma unidade da fatia (fuel). Fatia
+   vazia puxa outra do orçamento (budget); orçamento vazio é erro. Com yield
+   (sched.h) o vm_run não puxa: suspende em I->frame e devolve a vez, e o
+   input() sem linha pronta também suspende em vez de bloquear.
+   Chamadas no walker: os quadros ficam em sequência em locals e scope aponta
+   as variáveis do quadro atual (vars fora de função); um return sobe até a
+   chamada com ret marcado. O vm_run tem as próprias pilhas (exec.h). */
+enum { RET_NONE, RET_VALUE, RET_TAIL };
+
+struct Prof;
+struct VmFrame;
+
+typedef struct {
+    Var* vars; int nvars, cap;
+    Error err;
+    Io io;
+    struct Prof* prof; // != NULL: vm_run conta instruções e ciclos (prof.h)
+    int64_t fuel;      // voltas que ainda cabem na fatia
+    int64_t budget;    // voltas além da fatia; < 0: sem limite
+    int yield;         // escalonada: suspende em vez de puxar fatia ou bloquear no input()
+    struct VmFrame* frame; // != NULL: vm_run suspenso, a próxima chamada retoma (exec.h)
+    jmp_buf* unwind;   // walker: para onde um erro de execução salta (exec_program)
+    Var* scope;        // walker: variáveis do quadro atual
+    Var* locals; int ltop, lcap;
+    int calls;         // walker: chamadas em andamento (CALL_MAX, como na VM)
+    int depth;         // walker: níveis de eval e de chamada na pilha de C (WALK_MAX_DEPTH)
+    int ret;           // walker: RET_VALUE/RET_TAIL de um return a caminho da chamada
+    Value retval;
+    const FuncRef* tail;   // RET_TAIL: a função chamada, argumentos já no topo de locals
+    const FuncTab* funcs;
+} Interp;
+
+static void interp_init(Interp* I, int out_fd, int in_fd, int interactive) {
+    I->vars = NULL; I->nvars = I->cap = 0;
+    I->prof = NULL;
+    I->fuel = 0; I->budget = FUEL_DEFAULT;
+    I->yield = 0; I->frame = NULL;
+    I->unwind = NULL;
+    I->scope = NULL;
+    I->locals = NULL; I->ltop = I->lcap = 0;
+    I->calls = I->depth = 0; I->ret = RET_NONE; I->retval = V_int(0);
+    I->tail = NULL; I->funcs = NULL;
+    clear_error(&I->err);
+    io_init(&I->io, out_fd, in_fd, interactive);
+}
+
+static void interp_free(Interp* I) {
+    for (int i=0;i<I->nvars;i++) val_release(I->vars[i].val);
+    free(I->vars);
+    I->vars = NULL; I->nvars = I->cap = 0;
+    free(I->locals); // vazia fora de execução
+    I->locals = NULL; I->ltop = I->lcap = 0;
+}
+
+/* passa até n voltas do orçamento para a fatia; 0 se o orçamento acabou */
+static int fuel_refill(Interp* I, int64_t n) {
+    if (I->budget == 0) return 0;
+    if (I->budget > 0) { if (n > I->budget) n = I->budget; I->budget -= n; }
+    I->fuel = n;
+    return 1;
+}
+
+/* garante um slot (ainda indefinido) para cada símbolo de T */
+static void interp_reserve(Interp* I, const SymTab* T) {
+    if ((int)T->count > I->cap) {
+        while ((int)T->count > I->cap) I->cap = I->cap ? I->cap*2 : 64;
+        I->vars = (Var*)realloc(I->vars, sizeof(Var)*I->cap);
+    }
+    for (; I->nvars < (int)T->count; I->nvars++) {
+        I->vars[I->nvars].val = V_int(0);
+        I->vars[I->nvars].defined = 0;
+    }
+    for (int i=0;i<I->nvars;i++) I->vars[i].name = sym_name(T, i); // names pode ter sido realocado
+}
+
+/* Literais internados (refs < 0) morrem com a Ast que os criou. Quem roda várias
+   Ast contra a mesma Interp (a REPL) chama isto antes de liberar cada uma: as
+   variáveis que apontam para um literal, direto ou dentro de um mapa, ganham
+   cópia própria. */
+static Value own_value(Value v) {
+    if (v.type==V_STRING && v.s->refs < 0) {
+        Str* s = str_new(v.s->data, v.s->len);
+        s->hash = v.s->hash;
+        return V_sobj(s);
+    }
+    if (v.type==V_MAP) {
+        for (uint32_t i=0;i<v.m->cap;i++) {
+            if (v.m->ctrl[i] & 0x80) continue;
+            v.m->slots[i].key = own_value(v.m->slots[i].key);
+            v.m->slots[i].val = own_value(v.m->slots[i].val);
+        }
+    }
+    return v;
+}
+
+static inline void interp_own_values(Interp* I) {
+    for (int i=0;i<I->nvars;i++) I->vars[i].val = own_value(I->vars[i].val);
 }
 
 static int truthy(Value v) {
     if (v.type==V_INT) return v.i!=0;
-    return v.s[0]!=0;
+    if (v.type==V_ARRAY) return v.a->len!=0;
+    if (v.type==V_MAP) return v.m->count!=0;
+    return v.s->len!=0;
+}
+
+static const char* type_name(Value v) {
+    static const char* const names[] = { "int", "string", "array", "map" };
+    return names[v.type];
+}
+
+static void print_value(Io* o, Value v) {
+    if (v.type==V_INT) out_int(o, v.i);
+    else if (v.type==V_STRING) out_write(o, v.s->data, (size_t)v.s->len);
+    else if (v.type==V_ARRAY) {
+        out_char(o, '[');
+        for (int i=0;i<v.a->len;i++) { if (i) out_write(o, ", ", 2); out_int(o, v.a->data[i]); }
+        out_char(o, ']');
+    } else {
+        // {"a": 1, 2: "b"}, na ordem dos slots; dentro do mapa strings vão entre aspas
+        int first = 1;
+        out_char(o, '{');
+        for (uint32_t i=0;i<v.m->cap;i++) {
+            if (v.m->ctrl[i] & 0x80) continue;
+            if (!first) out_write(o, ", ", 2);
+            first = 0;
+            for (int kv=0;kv<2;kv++) {
+                Value x = kv ? v.m->slots[i].val : v.m->slots[i].key;
+                if (x.type==V_STRING) out_char(o, '"');
+                print_value(o, x);
+                if (x.type==V_STRING) out_char(o, '"');
+                if (!kv) out_write(o, ": ", 2);
+            }
+        }
+        out_char(o, '}');
+    }
 }
 
-static void print_value(Value v) {
-    if (v.type==V_INT) printf("%d", v.i);
-    else printf("%s", v.s);
+/* a variável passa a ser a única dona do seu array (copia se compartilhado) */
+static Arr* arr_own(Var* v) {
+    Arr* a = v->val.a;
+    if (a->refs > 1) {
+        Arr* c = arr_alloc(a->len);
+        memcpy(c->data, a->data, sizeof(int32_t) * (size_t)a->len);
+        a->refs--;
+        v->val.a = a = c;
+    }
+    return a;
 }
 
-static Value V_int(int x){ Value v; v.type=V_INT; v.i=x; v.s[0]=0; return v; }
-static Value V_str(const char* s){ Value v; v.type=V_STRING; v.i=0; strncpy(v.s,s,sizeof(v.s)-1); v.s[sizeof(v.s)-1]=0; return v; }
+/* o mesmo para mapa: a cópia divide chaves e valores com o original */
+static Map* map_own(Var* v) {
+    Map* m = v->val.m;
+    if (m->refs > 1) {
+        Map* c = map_alloc(m->cap);
+        memcpy(c->ctrl, m->ctrl, m->cap + VEC_GROUP);
+        c->count = m->count; c->used = m->used;
+        for (uint32_t i=0;i<m->cap;i++) {
+            if (m->ctrl[i] & 0x80) continue;
+            c->slots[i] = m->slots[i];
+            val_retain(c->slots[i].key); val_retain(c->slots[i].val);
+        }
+        m->refs--;
+        v->val.m = m = c;
+    }
+    return m;
+}
 
-static Value eval(Node* n); // fwd
-static void exec_block(Node* n);
+static Value eval(Interp* I, const Ast* A, NodeId id); // fwd
+static void exec_block(Interp* I, const Ast* A, NodeId id);
 
 /* Helpers de runtime para tipos */
-static Value bin_num_num(Node* n, Value a, Value b, OpType op) {
+static Value bin_num_num(Error* E, Source* S, uint32_t pos, Value a, Value b, OpType op) {
     if (a.type!=V_INT || b.type!=V_INT) {
-        set_error(ERR_RUNTIME, n->line, n->col, "operator aritimatic is not int");
+        set_error_at(E, ERR_RUNTIME, S, pos, "operator aritimatic is not int");
         return V_int(0);
     }
     switch (op) {
-        case OP_PLUS:  return V_int(a.i + b.i);
-        case OP_MINUS: return V_int(a.i - b.i);
-        case OP_MUL:   return V_int(a.i * b.i);
+        case OP_PLUS:  return V_int(int_add(a.i, b.i));
+        case OP_MINUS: return V_int(int_sub(a.i, b.i));
+        case OP_MUL:   return V_int(int_mul(a.i, b.i));
         case OP_DIV:
-            if (b.i==0) { set_error(ERR_RUNTIME, n->line, n->col, "division by zero"); return V_int(0); }
-            return V_int(a.i / b.i);
+            if (b.i==0) { set_error_at(E, ERR_RUNTIME, S, pos, "division by zero"); return V_int(0); }
+            return V_int(int_div(a.i, b.i));
         default: return V_int(0);
     }
 }
 
-static Value cmp_any(Node* n, Value a, Value b, OpType op) {
+static Value cmp_any(Error* E, Source* S, uint32_t pos, Value a, Value b, OpType op) {
     // Comparações: se ambos inteiros, compare numericamente; se ambos strings, lexicográfico; senão, erro.
     if (a.type==V_INT && b.type==V_INT) {
         int A=a.i, B=b.i, r=0;
@@ -83,141 +541,630 @@ static Value cmp_any(Node* n, Value a, Value b, OpType op) {
         return V_int(r);
     }
     if (a.type==V_STRING && b.type==V_STRING) {
-        int cmp = strcmp(a.s, b.s), r=0;
+        if (op==OP_EQ) return V_int(str_eq(a.s, b.s));
+        if (op==OP_NE) return V_int(!str_eq(a.s, b.s));
+        int cmp = str_cmp(a.s, b.s), r=0;
         switch (op){
-            case OP_EQ: r=(cmp==0); break; case OP_NE: r=(cmp!=0); break;
             case OP_LT: r=(cmp< 0); break; case OP_LE: r=(cmp<=0); break;
             case OP_GT: r=(cmp> 0); break; case OP_GE: r=(cmp>=0); break;
             default: r=0; break;
         }
         return V_int(r);
     }
-    set_error(ERR_RUNTIME, n->line, n->col, "incompatibles");
+    set_error_at(E, ERR_RUNTIME, S, pos, "incompatibles");
     return V_int(0);
 }
 
-static Value add_any(Node* n, Value a, Value b) {
+static Value add_any(Error* E, Source* S, uint32_t pos, Value a, Value b) {
     // Se ambos int -> soma; se qualquer é string -> concatena (coerção simples para int->string)
-    if (a.type==V_INT && b.type==V_INT) return V_int(a.i + b.i);
-    char buf[1024]; buf[0]=0;
-    if (a.type==V_STRING) snprintf(buf, sizeof(buf), "%s", a.s);
-    else snprintf(buf, sizeof(buf), "%d", a.i);
-    size_t len = strlen(buf);
-    if (b.type==V_STRING) snprintf(buf+len, sizeof(buf)-len, "%s", b.s);
-    else snprintf(buf+len, sizeof(buf)-len, "%d", b.i);
-    return V_str(buf);
-}
-
-static Value eval(Node* n) {
-    if (!n || g_error.kind) return V_int(0);
-
-    switch (n->type) {
-        case N_INT:    return V_int(atoi(n->value));
-        case N_STRING: return V_str(n->value);
-        case N_VAR: {
-            Var* v = var_find(n->value);
-            if (!v) { set_error(ERR_RUNTIME, n->line, n->col, "var '%s' not defined", n->value); return V_int(0); }
+    if (a.type==V_INT && b.type==V_INT) return V_int(int_add(a.i, b.i));
+    if (a.type>=V_ARRAY || b.type>=V_ARRAY) {
+        set_error_at(E, ERR_RUNTIME, S, pos, "operator + on %s", type_name(a.type>=V_ARRAY ? a : b));
+        return V_int(0);
+    }
+    char na[16], nb[16];
+    const char *pa = na, *pb = nb;
+    int la, lb;
+    if (a.type==V_STRING) { pa = a.s->data; la = a.s->len; } else la = fmt_int(na, a.i);
+    if (b.type==V_STRING) { pb = b.s->data; lb = b.s->len; } else lb = fmt_int(nb, b.i);
+    Str* s = str_alloc(la + lb);
+    memcpy(s->data, pa, la);
+    memcpy(s->data + la, pb, lb);
+    return V_sobj(s);
+}
+
+/* var = var + x: se a string da variável só é dela, cresce no lugar em vez de
+   copiar o prefixo inteiro a cada volta */
+static void var_append(Error* E, Source* S, uint32_t pos, Var* v, Value x) {
+    if (v->val.type==V_STRING && v->val.s->refs==1 && x.type<=V_STRING) {
+        if (x.type==V_STRING) v->val.s = str_append(v->val.s, x.s->data, x.s->len);
+        else { char nb[16]; v->val.s = str_append(v->val.s, nb, fmt_int(nb, x.i)); }
+        return;
+    }
+    Value r = add_any(E, S, pos, v->val, x);
+    if (E->kind) return;
+    val_release(v->val);
+    v->val = r;
+}
+
+/* =================== Arrays, mapas e built-ins =================== */
+/* Mesmos testes e mensagens no walker e no bytecode; o caminho comum (array,
+   índice int dentro do tamanho) o chamador já testa inline. 0 em erro. */
+static int arr_index_check(Error* E, Source* S, uint32_t pos, Value a, Value i) {
+    if (a.type!=V_ARRAY || i.type!=V_INT) { set_error_at(E, ERR_RUNTIME, S, pos, "indexing needs an array and an int index"); return 0; }
+    if ((uint32_t)i.i >= (uint32_t)a.a->len) { set_error_at(E, ERR_RUNTIME, S, pos, "index %d out of range (len %d)", i.i, a.a->len); return 0; }
+    return 1;
+}
+
+/* var[i] = x */
+static int arr_store_check(Error* E, Source* S, uint32_t pos, const Var* v, Value i, Value x) {
+    if (!v->defined) { set_error_at(E, ERR_RUNTIME, S, pos, "var '%s' not defined", v->name); return 0; }
+    if (!arr_index_check(E, S, pos, v->val, i)) return 0;
+    if (x.type!=V_INT) { set_error_at(E, ERR_RUNTIME, S, pos, "array elements are ints"); return 0; }
+    return 1;
+}
+
+static int map_key_check(Error* E, Source* S, uint32_t pos, Value k) {
+    if (map_key_ok(k)) return 1;
+    set_error_at(E, ERR_RUNTIME, S, pos, "map keys are ints or strings");
+    return 0;
+}
+
+/* a[k] fora do caminho comum: mapa, ou o erro do array. *out é referência própria */
+static int index_value(Error* E, Source* S, uint32_t pos, Value a, Value k, Value* out) {
+    if (a.type==V_MAP) {
+        if (!map_key_check(E, S, pos, k)) return 0;
+        int i = map_find(a.m, k, map_hash(k));
+        if (i < 0) {
+            if (k.type==V_INT) set_error_at(E, ERR_RUNTIME, S, pos, "key %d not found", k.i);
+            else set_error_at(E, ERR_RUNTIME, S, pos, "key \"%.*s\" not found", k.s->len, k.s->data);
+            return 0;
+        }
+        *out = a.m->slots[i].val;
+        val_retain(*out);
+        return 1;
+    }
+    if (!arr_index_check(E, S, pos, a, k)) return 0;
+    *out = V_int(a.a->data[k.i]);
+    return 1;
+}
+
+/* var[k] = x; fica com k e x (em erro continuam do chamador) */
+static int index_store(Error* E, Source* S, uint32_t pos, Var* v, Value k, Value x) {
+    if (v->defined && v->val.type==V_MAP) {
+        if (!map_key_check(E, S, pos, k)) return 0;
+        map_put(map_own(v), k, map_hash(k), x);
+        return 1;
+    }
+    if (!arr_store_check(E, S, pos, v, k, x)) return 0;
+    arr_own(v)->data[k.i] = x.i;
+    return 1;
+}
+
+/* args já avaliados (não são soltos aqui). Nos que mudam o primeiro argumento,
+   dst é a variável dele e args começa no segundo. Os laços sobre os elementos
+   de array são os kernels de vec.h. */
+static Value builtin_call(Error* E, Source* S, uint32_t pos, int b, Var* dst, const Value* args) {
+    const char* name = g_builtins[b].name;
+    if (dst) {
+        if (!dst->defined) { set_error_at(E, ERR_RUNTIME, S, pos, "var '%s' not defined", dst->name); return V_int(0); }
+        if (b==B_DEL) {
+            if (dst->val.type!=V_MAP) { set_error_at(E, ERR_RUNTIME, S, pos, "'del' expects a map"); return V_int(0); }
+            if (!map_key_check(E, S, pos, args[0])) return V_int(0);
+            uint32_t h = map_hash(args[0]);
+            if (map_find(dst->val.m, args[0], h) < 0) return V_int(0); // nada a copiar
+            return V_int(map_del(map_own(dst), args[0], h));
+        }
+        if (dst->val.type!=V_ARRAY) { set_error_at(E, ERR_RUNTIME, S, pos, "'%s' expects an array", name); return V_int(0); }
+        if (args[0].type!=V_INT) { set_error_at(E, ERR_RUNTIME, S, pos, "'%s' expects an int", name); return V_int(0); }
+        Arr* a = arr_own(dst);
+        int32_t k = args[0].i;
+        if (b==B_FILL) vec_fill(a->data, a->len, k);
+        else if (b==B_ADD) vec_add_k(a->data, a->len, k);
+        else vec_mul_k(a->data, a->len, k);
+        return V_int(0);
+    }
+    switch ((Builtin)b) {
+        case B_ARRAY: {
+            if (args[0].type!=V_INT || args[0].i < 0 || args[0].i > ARR_MAX) {
+                set_error_at(E, ERR_RUNTIME, S, pos, "array size must be an int from 0 to %d", ARR_MAX);
+                return V_int(0);
+            }
+            Arr* a = arr_alloc(args[0].i);
+            vec_fill(a->data, a->len, 0);
+            return V_arr(a);
+        }
+        case B_LEN:
+            if (args[0].type==V_ARRAY)  return V_int(args[0].a->len);
+            if (args[0].type==V_STRING) return V_int(args[0].s->len);
+            if (args[0].type==V_MAP)    return V_int((int)args[0].m->count);
+            set_error_at(E, ERR_RUNTIME, S, pos, "'len' expects an array, a map or a string");
+            return V_int(0);
+        case B_HAS: case B_GET: {
+            if (args[0].type!=V_MAP) { set_error_at(E, ERR_RUNTIME, S, pos, "'%s' expects a map", name); return V_int(0); }
+            if (!map_key_check(E, S, pos, args[1])) return V_int(0);
+            int i = map_find(args[0].m, args[1], map_hash(args[1]));
+            if (b==B_HAS) return V_int(i >= 0);
+            Value r = i >= 0 ? args[0].m->slots[i].val : args[2]; // get(m, k, padrão)
+            val_retain(r);
+            return r;
+        }
+        default: break;
+    }
+    const Arr* a = args[0].type==V_ARRAY ? args[0].a : NULL;
+    if (!a || (b==B_DOT && args[1].type!=V_ARRAY)) { set_error_at(E, ERR_RUNTIME, S, pos, "'%s' expects an array", name); return V_int(0); }
+    switch ((Builtin)b) {
+        case B_SUM: return V_int(vec_sum(a->data, a->len));
+        case B_MIN: case B_MAX:
+            if (!a->len) { set_error_at(E, ERR_RUNTIME, S, pos, "'%s' of an empty array", name); return V_int(0); }
+            return V_int(b==B_MIN ? vec_min(a->data, a->len) : vec_max(a->data, a->len));
+        case B_DOT:
+            if (args[1].a->len != a->len) { set_error_at(E, ERR_RUNTIME, S, pos, "'dot' of arrays with different lengths"); return V_int(0); }
+            return V_int(vec_dot(a->data, args[1].a->data, a->len));
+        default: return V_int(0);
+    }
+}
+
+/* x = x + a + b + ...: a espinha esquerda de somas começa na própria variável.
+   Devolve quantos operandos (a, b, ...) há, na ordem, em ops, e a posição da
+   variável em vpos; 0 se não é o formato. O walker e o compilador usam o mesmo
+   reconhecimento: todos os operandos são avaliados antes, e então acrescentados
+   um a um, o que dá o mesmo resultado que ((x + a) + b) sem copiar x. */
+#define APPEND_MAX 8
+static int append_operands(const Ast* A, const Node* n, NodeId* ops, uint32_t* vpos) {
+    NodeId rev[APPEND_MAX], cur = n->left;
+    int k = 0;
+    while (A->nodes[cur].type == N_BINARY && A->nodes[cur].op == OP_PLUS) {
+        if (k == APPEND_MAX) return 0;
+        rev[k++] = A->nodes[cur].right;
+        cur = A->nodes[cur].left;
+    }
+    const Node* l = &A->nodes[cur];
+    if (!k || l->type != N_VAR || l->slot != n->slot) return 0;
+    for (int i=0;i<k;i++) ops[i] = rev[k-1-i];
+    *vpos = l->pos;
+    return k;
+}
+
+/* Erros do walker não voltam por retorno: rt_error grava o erro (o primeiro
+   vale, como em set_error_at) e faz longjmp para exec_program, então eval e
+   exec_block não testam I->err depois de cada nó. Quem segura uma string
+   enquanto avalia outro nó passa por eval_holding, que a solta no caminho. */
+static SUN_NORETURN void rt_raise(Interp* I) { longjmp(*I->unwind, 1); }
+
+static SUN_NORETURN void rt_error(Interp* I, const Ast* A, uint32_t pos, const char* fmt, ...) {
+    if (I->err.kind == ERR_NONE) {
+        int line, col;
+        source_linecol(A->src, pos, &line, &col);
+        va_list ap; va_start(ap, fmt);
+        set_error_v(&I->err, ERR_RUNTIME, line, col, fmt, ap);
+        va_end(ap);
+    }
+    rt_raise(I);
+}
+
+/* eval devolve uma referência própria */
+static Value eval_holding(Interp* I, const Ast* A, NodeId id, Value* held, int nheld);
+
+/* Os casos gordos de eval ficam fora dele (noinline): o quadro de C de eval
+   se repete a cada nível de expressão e de chamada de função. */
+static SUN_NOINLINE Value eval_input(Interp* I, const Ast* A, const Node* n) {
+    Var* slot = &I->scope[n->slot];
+    char buf[512];
+    io_prompt(&I->io);
+    if (!in_line(&I->io, buf, sizeof(buf))) rt_error(I, A, n->pos, "error in len");
+    buf[strcspn(buf,"\n")]=0;
+    val_release(slot->val);
+    slot->val = V_str(buf); slot->defined = 1;
+    val_retain(slot->val);
+    return slot->val;
+}
+
+/* x = x + a + ...: acrescenta no lugar (append_operands); 0 se não é o formato */
+static SUN_NOINLINE int eval_append(Interp* I, const Ast* A, const Node* n, Value* out) {
+    NodeId ops[APPEND_MAX]; uint32_t vpos;
+    int k = append_operands(A, n, ops, &vpos);
+    if (!k) return 0;
+    if (!I->scope[n->slot].defined) rt_error(I, A, vpos, "var '%s' not defined", node_name(A, n));
+    Value xs[APPEND_MAX];
+    int nref = 0; // xs[0..i) tem valor contado: avalia o resto segurando-os
+    for (int i=0;i<k;i++) {
+        xs[i] = nref ? eval_holding(I, A, ops[i], xs, i) : eval(I, A, ops[i]);
+        nref |= xs[i].type!=V_INT;
+    }
+    Var* slot = &I->scope[n->slot]; // depois dos operandos: uma chamada pode ter movido o quadro
+    for (int i=0;i<k;i++) {
+        var_append(&I->err, A->src, n->pos, slot, xs[i]);
+        val_release(xs[i]);
+        if (I->err.kind) { while (++i < k) val_release(xs[i]); rt_raise(I); } // só com array ou mapa
+    }
+    val_retain(slot->val);
+    *out = slot->val;
+    return 1;
+}
+
+static SUN_NOINLINE Value eval_builtin(Interp* I, const Ast* A, const Node* n) {
+    const BuiltinInfo* bi = &g_builtins[n->op];
+    NodeId a = n->extra;
+    Var* dst = NULL;
+    if (bi->mutates) a = A->nodes[a].next;
+    Value args[3] = { V_int(0), V_int(0), V_int(0) };
+    int na = 0, nref = 0; // args[0..na) tem valor contado: avalia o resto segurando-os
+    for (; a; a = A->nodes[a].next, na++) {
+        args[na] = nref ? eval_holding(I, A, a, args, na) : eval(I, A, a);
+        nref |= args[na].type!=V_INT;
+    }
+    if (bi->mutates) dst = &I->scope[A->nodes[n->extra].slot]; // depois dos argumentos, como em eval_append
+    Value r = builtin_call(&I->err, A->src, n->pos, n->op, dst, args);
+    while (na--) val_release(args[na]);
+    if (I->err.kind) rt_raise(I);
+    return r;
+}
+
+/* ---- chamadas ---- */
+/* Quadro = argumentos, avaliados direto no topo de I->locals, e depois os
+   demais locais, indefinidos. A pilha cresce dobrando (nada é alocado por
+   chamada depois de aquecida), então um Var* de I->scope não vale depois de
+   avaliar uma expressão que pode chamar função: quem o segura busca de novo. */
+static void local_push(Interp* I, Value v, const char* name, int defined) {
+    if (I->ltop == I->lcap) {
+        int in = I->scope != I->vars ? (int)(I->scope - I->locals) : -1;
+        I->lcap = I->lcap ? I->lcap*2 : 256;
+        I->locals = (Var*)realloc(I->locals, sizeof(Var)*I->lcap);
+        if (in >= 0) I->scope = I->locals + in;
+    }
+    Var* x = &I->locals[I->ltop++];
+    x->name = name; x->val = v; x->defined = defined;
+}
+
+/* confere nome e aridade e avalia os argumentos no topo de I->locals */
+static const FuncRef* call_args(Interp* I, const Ast* A, const Node* n) {
+    const FuncRef* f = func_lookup(I->funcs, n->lit);
+    if (!f) rt_error(I, A, n->pos, "unknown function '%s'", node_name(A, n));
+    int np = f->fn->nparams, k = 0;
+    if (np != n->op) rt_error(I, A, n->pos, "'%s' takes %d argument%s", node_name(A, n), np, np == 1 ? "" : "s");
+    for (NodeId a = n->extra; a; a = A->nodes[a].next) {
+        Value v = eval(I, A, a);
+        local_push(I, v, I->vars[f->fn->locals[k++]].name, 1);
+    }
+    return f;
+}
+
+/* cada chamada gasta uma unidade de combustível, como uma volta de loop */
+static void call_fuel(Interp* I, const Ast* A, uint32_t pos) {
+    if (I->fuel <= 0 && !fuel_refill(I, FUEL_SLICE)) rt_error(I, A, pos, "out of fuel");
+    I->fuel--;
+}
+
+/* return g(...) não volta aqui: o quadro é reaproveitado e o laço segue em g */
+static Value call_function(Interp* I, const Ast* A, const Node* n) {
+    const FuncRef* f = call_args(I, A, n);
+    call_fuel(I, A, n->pos);
+    if (I->calls >= CALL_MAX || I->depth >= WALK_MAX_DEPTH) rt_error(I, A, n->pos, "stack overflow");
+    int base = I->ltop - n->op;
+    int outer = I->scope != I->vars ? (int)(I->scope - I->locals) : -1;
+    I->calls++; I->depth++;
+    for (;;) {
+        const AstFunc* fn = f->fn;
+        for (int i=fn->nparams;i<fn->nlocals;i++) local_push(I, V_int(0), I->vars[fn->locals[i]].name, 0);
+        I->scope = I->locals + base;
+        exec_block(I, f->A, f->A->nodes[fn->node].extra);
+        if (I->ret != RET_TAIL) break;
+        f = I->tail;
+        int np = f->fn->nparams, top = I->ltop - np;
+        for (int i=base;i<top;i++) val_release(I->locals[i].val);
+        memmove(I->locals + base, I->locals + top, sizeof(Var)*np);
+        I->ltop = base + np;
+        I->ret = RET_NONE;
+    }
+    for (int i=base;i<I->ltop;i++) val_release(I->locals[i].val);
+    I->ltop = base;
+    I->scope = outer >= 0 ? I->locals + outer : I->vars;
+    I->calls--; I->depth--;
+    Value r = I->ret ? I->retval : V_int(0);
+    I->ret = RET_NONE;
+    return r;
+}
+
+static Value eval_node(Interp* I, const Ast* A, NodeId id) {
+    if (!id) return V_int(0);
+    const Node* n = &A->nodes[id];
+
+    switch ((NodeType)n->type) {
+        case N_INT:    return V_int(n->ival);
+        case N_STRING: return V_sobj(A->strs[n->slot]);
+        case N_VAR: case N_GLOBAL: {
+            Var* v = n->type==N_VAR ? &I->scope[n->slot] : &I->vars[n->slot];
+            if (!v->defined) rt_error(I, A, n->pos, "var '%s' not defined", node_name(A, n));
+            val_retain(v->val);
             return v->val;
         }
         case N_UNARY: {
-            Value a = eval(n->left);
-            if (g_error.kind) return V_int(0);
-            switch (n->op) {
-                case OP_NOT:   return V_int(!truthy(a));
-                case OP_MINUS: if (a.type!=V_INT){ set_error(ERR_RUNTIME, n->line,n->col,"- unary is not int"); return V_int(0);} return V_int(-a.i);
-                case OP_PLUS:  if (a.type!=V_INT){ set_error(ERR_RUNTIME, n->line,n->col,"+ unáry is not int"); return V_int(0);} return V_int(+a.i);
-                default: return V_int(0);
+            Value a = eval(I, A, n->left);
+            switch ((OpType)n->op) {
+                case OP_NOT: { int r = !truthy(a); val_release(a); return V_int(r); }
+                case OP_MINUS: if (a.type!=V_INT){ val_release(a); rt_error(I, A, n->pos, "- unary is not int"); } return V_int(int_neg(a.i));
+                case OP_PLUS:  if (a.type!=V_INT){ val_release(a); rt_error(I, A, n->pos, "+ unáry is not int"); } return V_int(+a.i);
+                default: val_release(a); return V_int(0);
             }
         }
         case N_BINARY: {
             // curto-circuito em && e ||
-            if (n->op==OP_AND) {
-                Value L = eval(n->left); if (g_error.kind) return V_int(0);
-                if (!truthy(L)) return V_int(0);
-                Value R = eval(n->right); if (g_error.kind) return V_int(0);
-                return V_int(truthy(R)!=0);
-            }
-            if (n->op==OP_OR) {
-                Value L = eval(n->left); if (g_error.kind) return V_int(0);
-                if (truthy(L)) return V_int(1);
-                Value R = eval(n->right); if (g_error.kind) return V_int(0);
-                return V_int(truthy(R)!=0);
+            if (n->op==OP_AND || n->op==OP_OR) {
+                Value L = eval(I, A, n->left);
+                int l = truthy(L); val_release(L);
+                if (n->op==OP_AND && !l) return V_int(0);
+                if (n->op==OP_OR && l) return V_int(1);
+                Value R = eval(I, A, n->right);
+                int r = truthy(R); val_release(R);
+                return V_int(r!=0);
             }
             // demais binários
-            Value L = eval(n->left);  if (g_error.kind) return V_int(0);
-            Value R = eval(n->right); if (g_error.kind) return V_int(0);
-            switch (n->op) {
-                case OP_PLUS:  return add_any(n, L, R);
-                case OP_MINUS: case OP_MUL: case OP_DIV: return bin_num_num(n, L, R, n->op);
+            Value L = eval(I, A, n->left);
+            Value R = L.type==V_INT ? eval(I, A, n->right) : eval_holding(I, A, n->right, &L, 1);
+            if (L.type==V_INT && R.type==V_INT) {
+                int a = L.i, b = R.i;
+                switch ((OpType)n->op) {
+                    case OP_PLUS:  return V_int(int_add(a, b));
+                    case OP_MINUS: return V_int(int_sub(a, b));
+                    case OP_MUL:   return V_int(int_mul(a, b));
+                    case OP_DIV:   if (!b) rt_error(I, A, n->pos, "division by zero"); return V_int(int_div(a, b));
+                    case OP_EQ: return V_int(a == b); case OP_NE: return V_int(a != b);
+                    case OP_LT: return V_int(a <  b); case OP_LE: return V_int(a <= b);
+                    case OP_GT: return V_int(a >  b); case OP_GE: return V_int(a >= b);
+                    default: return V_int(0);
+                }
+            }
+            Value res = V_int(0);
+            switch ((OpType)n->op) {
+                case OP_PLUS:  res = add_any(&I->err, A->src, n->pos, L, R); break;
+                case OP_MINUS: case OP_MUL: case OP_DIV: res = bin_num_num(&I->err, A->src, n->pos, L, R, (OpType)n->op); break;
                 case OP_EQ: case OP_NE: case OP_LT: case OP_LE: case OP_GT: case OP_GE:
-                    return cmp_any(n, L, R, n->op);
-                default: return V_int(0);
+                    res = cmp_any(&I->err, A->src, n->pos, L, R, (OpType)n->op); break;
+                default: break;
             }
+            val_release(L); val_release(R);
+            if (I->err.kind) rt_raise(I); // só no caminho que não é int/int
+            return res;
         }
         case N_ASSIGN: {
-            Value v = eval(n->left);
-            if (g_error.kind) return V_int(0);
-            Var* slot = var_ensure(n->value);
-            if (!slot) { set_error(ERR_RUNTIME, n->line, n->col, "var limit"); return V_int(0); }
-            slot->val = v;
+            Value v;
+            if (eval_append(I, A, n, &v)) return v;
+            v = eval(I, A, n->left);
+            Var* slot = &I->scope[n->slot];
+            val_release(slot->val);
+            slot->val = v; slot->defined = 1;
+            val_retain(v);
             return v;
         }
         case N_PRINT: {
-            Node* a = n->extra; int first=1;
-            while (a && !g_error.kind) {
-                Value v = eval(a);
-                if (g_error.kind) break;
-                if (!first) printf(" ");
-                print_value(v);
+            NodeId a = n->extra; int first=1;
+            while (a) {
+                Value v = eval(I, A, a);
+                if (!first) out_char(&I->io, ' ');
+                print_value(&I->io, v);
+                val_release(v);
                 first=0;
-                a = a->right;
+                a = A->nodes[a].next;
             }
-            if (!g_error.kind) printf("\n");
+            out_newline(&I->io);
             return V_int(0);
         }
-        case N_INPUT: {
-            Var* slot = var_ensure(n->value);
-            if (!slot) { set_error(ERR_RUNTIME, n->line, n->col, "var limit"); return V_int(0); }
-            char buf[512];
-            printf("> "); fflush(stdout);
-            if (!fgets(buf, sizeof(buf), stdin)) { set_error(ERR_RUNTIME, n->line, n->col, "error in len"); return V_int(0); }
-            buf[strcspn(buf,"\n")]=0;
-            slot->val = V_str(buf);
-            return slot->val;
-        }
+        case N_INPUT: return eval_input(I, A, n);
         case N_IF: {
-            Value c = eval(n->left); if (g_error.kind) return V_int(0);
-            if (truthy(c)) exec_block(n->extra);
-            else if (n->right) exec_block(n->right);
+            Value c = eval(I, A, n->left);
+            int t = truthy(c); val_release(c);
+            if (t) exec_block(I, A, n->extra);
+            else if (n->right) exec_block(I, A, n->right);
             return V_int(0);
         }
         case N_WHILE: {
-            int guard = 1000000; // evita loop infinito acidental
-            while (guard-- > 0) {
-                Value c = eval(n->left);
-                if (g_error.kind) return V_int(0);
-                if (!truthy(c)) break;
-                exec_block(n->extra);
-                if (g_error.kind) return V_int(0);
+            // o walker não suspende: a fatia sempre puxa do orçamento
+            for (;;) {
+                if (I->fuel <= 0 && !fuel_refill(I, FUEL_SLICE)) rt_error(I, A, n->pos, "out of fuel");
+                I->fuel--;
+                Value c = eval(I, A, n->left);
+                int t = truthy(c); val_release(c);
+                if (!t) break;
+                exec_block(I, A, n->extra);
+                if (I->ret) break;
             }
-            if (guard<=0) set_error(ERR_RUNTIME, n->line, n->col, "While error");
             return V_int(0);
         }
         case N_BLOCK: {
-            exec_block(n);
+            exec_block(I, A, id);
+            return V_int(0);
+        }
+        case N_INDEX: {
+            Value a = eval(I, A, n->left);
+            Value i = a.type==V_INT ? eval(I, A, n->right) : eval_holding(I, A, n->right, &a, 1);
+            if (a.type!=V_ARRAY || i.type!=V_INT || (uint32_t)i.i >= (uint32_t)a.a->len) {
+                Value r;
+                int ok = index_value(&I->err, A->src, n->pos, a, i, &r);
+                val_release(a); val_release(i);
+                if (!ok) rt_raise(I);
+                return r;
+            }
+            int r = a.a->data[i.i];
+            val_release(a);
+            return V_int(r);
+        }
+        case N_SET_INDEX: {
+            Value i = eval(I, A, n->left);
+            Value x = i.type==V_INT ? eval(I, A, n->right) : eval_holding(I, A, n->right, &i, 1);
+            if (!index_store(&I->err, A->src, n->pos, &I->scope[n->slot], i, x)) { val_release(i); val_release(x); rt_raise(I); }
+            return V_int(0);
+        }
+        case N_MAP: {
+            // chave e valor na mesma ordem do bytecode: o valor antes de testar a chave
+            Value held[2];
+            held[0] = V_map(map_new((uint32_t)n->ival));
+            for (NodeId k = n->extra; k; k = A->nodes[A->nodes[k].next].next) {
+                held[1] = eval_holding(I, A, k, held, 1);
+                Value x = eval_holding(I, A, A->nodes[k].next, held, 2);
+                if (!map_key_ok(held[1])) {
+                    val_release(held[0]); val_release(held[1]); val_release(x);
+                    rt_error(I, A, A->nodes[k].pos, "map keys are ints or strings");
+                }
+                map_put(held[0].m, held[1], map_hash(held[1]), x);
+            }
+            return held[0];
+        }
+        case N_CALL: return eval_builtin(I, A, n);
+        case N_FCALL: return call_function(I, A, n);
+        case N_RETURN: {
+            const Node* c = &A->nodes[n->left];
+            const FuncRef* f;
+            if (n->left && c->type==N_FCALL && (f = func_lookup(I->funcs, c->lit)) && f->fn->nparams == c->op) {
+                // chamada em cauda: os argumentos sobem e call_function troca o quadro
+                I->tail = call_args(I, A, c);
+                call_fuel(I, A, c->pos);
+                I->ret = RET_TAIL;
+            } else {
+                I->retval = eval(I, A, n->left);
+                I->ret = RET_VALUE;
+            }
             return V_int(0);
         }
+        case N_FUNC: return V_int(0); // já está na tabela de funções
         default: return V_int(0);
     }
 }
 
-static void exec_block(Node* stmt) {
-    Node* cur = (stmt && stmt->type==N_BLOCK)? stmt->extra : stmt;
-    while (cur && !g_error.kind) {
-        (void)eval(cur);
-        cur = cur->right;
+/* Cada nível de eval gasta pilha de C, e uma chamada dentro de uma expressão
+   funda recomeça a contagem de aninhamento do parser (PARSE_MAX_NEST): depth
+   soma os dois e para em WALK_MAX_DEPTH, antes da pilha acabar. */
+static Value eval(Interp* I, const Ast* A, NodeId id) {
+    if (++I->depth > WALK_MAX_DEPTH) rt_error(I, A, A->nodes[id].pos, "stack overflow");
+    Value v = eval_node(I, A, id);
+    I->depth--;
+    return v;
+}
+
+/* eval com held[0..nheld) vivos na pilha de C: se o nó levantar erro, solta-os e
+   repassa o salto. Só o caminho com strings paga o setjmp. */
+static Value eval_holding(Interp* I, const Ast* A, NodeId id, Value* held, int nheld) {
+    jmp_buf here;
+    jmp_buf* volatile outer = I->unwind;
+    volatile NodeId node = id; // -Wclobbered
+    if (setjmp(here)) {
+        I->unwind = outer;
+        for (int i=0;i<nheld;i++) val_release(held[i]);
+        rt_raise(I);
+    }
+    I->unwind = &here;
+    Value v = eval(I, A, node);
+    I->unwind = outer;
+    return v;
+}
+
+/* =================== Resolver =================== */
+/* Liga cada N_VAR/N_ASSIGN/N_INPUT/N_SET_INDEX ao seu slot uma única vez, antes de executar,
+   e interna os literais de string em Ast.strs. Varre o arena linearmente. Os
+   slots em si são criados por interp_reserve em cada Interp.
+   Depois, o corpo de cada função do nível de cima: é local todo nome que é
+   parâmetro ou que o corpo escreve (atribuição, input, a[i] =, primeiro
+   argumento de fill/add/mul/del); os demais leem a global (N_GLOBAL), que de
+   dentro de uma função é só leitura. Rodar de novo sobre a mesma Ast dá o mesmo. */
+static int func_local(const AstFunc* f, uint32_t sym) {
+    for (int i=0;i<f->nlocals;i++) if (f->locals[i]==sym) return i;
+    return -1;
+}
+
+static void func_add_local(AstFunc* f, int* cap, uint32_t sym) {
+    if (func_local(f, sym) >= 0) return;
+    if (f->nlocals == *cap) {
+        *cap = *cap ? *cap*2 : 8;
+        f->locals = (uint32_t*)realloc(f->locals, sizeof(uint32_t) * *cap);
     }
+    f->locals[f->nlocals++] = sym;
 }
 
-#endif
+/* id e os irmãos por next, com os filhos */
+static void func_collect(const Ast* A, AstFunc* f, int* cap, NodeId id) {
+    for (; id; id = A->nodes[id].next) {
+        const Node* n = &A->nodes[id];
+        if (n->type==N_ASSIGN || n->type==N_INPUT || n->type==N_SET_INDEX) func_add_local(f, cap, n->lit);
+        else if (n->type==N_CALL && g_builtins[n->op].mutates) func_add_local(f, cap, A->nodes[n->extra].lit);
+        func_collect(A, f, cap, n->left);
+        func_collect(A, f, cap, n->right);
+        func_collect(A, f, cap, n->extra);
+    }
+}
+
+static void func_bind(Ast* A, const AstFunc* f, NodeId id) {
+    for (; id; id = A->nodes[id].next) {
+        Node* n = &A->nodes[id];
+        if (n->type==N_VAR || n->type==N_GLOBAL) {
+            int l = func_local(f, n->lit);
+            n->type = (uint8_t)(l >= 0 ? N_VAR : N_GLOBAL);
+            n->slot = l >= 0 ? l : (int32_t)n->lit;
+        } else if (n->type==N_ASSIGN || n->type==N_INPUT || n->type==N_SET_INDEX) n->slot = func_local(f, n->lit);
+        func_bind(A, f, n->left);
+        func_bind(A, f, n->right);
+        func_bind(A, f, n->extra);
+    }
+}
 
+static void resolve(Ast* A, NodeId root) {
+    A->nstrs = 0;
+    for (uint32_t i=1;i<A->count;i++) {
+        Node* n = &A->nodes[i];
+        if (n->type==N_VAR || n->type==N_GLOBAL || n->type==N_ASSIGN || n->type==N_INPUT || n->type==N_SET_INDEX) n->slot = (int32_t)n->lit;
+        else if (n->type==N_STRING) {
+            if (A->nstrs >= A->strs_cap) {
+                A->strs_cap = A->strs_cap ? A->strs_cap*2 : 64;
+                A->strs = (Str**)realloc(A->strs, sizeof(Str*)*A->strs_cap);
+            }
+            const char* t = node_text(A, n);
+            A->strs[A->nstrs] = str_intern(A, t, (int)strlen(t));
+            n->slot = (int32_t)A->nstrs++;
+        }
+    }
+
+    for (uint32_t i=0;i<A->nfuncs;i++) free(A->funcs[i].locals);
+    A->nfuncs = 0;
+    uint32_t nf = 0;
+    for (NodeId s = A->nodes[root].extra; s; s = A->nodes[s].next) nf += A->nodes[s].type==N_FUNC;
+    if (nf) A->funcs = (AstFunc*)realloc(A->funcs, sizeof(AstFunc)*nf);
+    for (NodeId s = A->nodes[root].extra; s; s = A->nodes[s].next) {
+        Node* n = &A->nodes[s];
+        if (n->type != N_FUNC) continue;
+        AstFunc* f = &A->funcs[A->nfuncs];
+        n->slot = (int32_t)A->nfuncs++;
+        f->node = s; f->nparams = n->op; f->nlocals = 0; f->locals = NULL;
+        int cap = 0;
+        for (NodeId p = n->left; p; p = A->nodes[p].next) func_add_local(f, &cap, A->nodes[p].lit);
+        func_collect(A, f, &cap, n->extra);
+        func_bind(A, f, n->extra);
+    }
+}
+
+static void exec_block(Interp* I, const Ast* A, NodeId id) {
+    if (!id) return;
+    if (A->nodes[id].type != N_BLOCK) { val_release(eval(I, A, id)); return; }
+    for (NodeId cur = A->nodes[id].extra; cur; cur = A->nodes[cur].next) {
+        val_release(eval(I, A, cur));
+        if (I->ret) return; // return a caminho de call_function
+    }
+}
+
+/* ponto de entrada do walker: o primeiro erro de execução para aqui, em I->err,
+   e desfaz os quadros das chamadas em andamento */
+static void exec_program(Interp* I, const Ast* A, NodeId root, const FuncTab* funcs) {
+    jmp_buf here;
+    jmp_buf* volatile outer = I->unwind;
+    I->scope = I->vars;
+    I->funcs = funcs;
+    if (!setjmp(here)) {
+        I->unwind = &here;
+        exec_block(I, A, root);
+    } else {
+        while (I->ltop) val_release(I->locals[--I->ltop].val);
+        I->calls = I->depth = 0; I->ret = RET_NONE;
+        I->scope = I->vars;
+    }
+    I->unwind = outer;
+}
+
+#endif